@@ -0,0 +1,166 @@
+#include "admission.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define MILLI_CONNECTIONS 1000u
+
+static uint32_t coarse_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u);
+}
+
+static uint32_t hash_ip(uint32_t ip)
+{
+    return (ip * 2654435761u) >> 20; // 12 bits = ADMISSION_TABLE_SIZE
+}
+
+static void decay(const AdmissionTable *table, AdmissionEntry *entry, uint32_t now)
+{
+    uint64_t drained = (uint64_t)(now - entry->last_ms) * table->rate;
+    entry->score = table->rate == 0 || drained >= entry->score ? 0 : entry->score - (uint32_t)drained;
+    entry->last_ms = now;
+}
+
+static bool is_stale(const AdmissionTable *table, const AdmissionEntry *entry, uint32_t now)
+{
+    if (entry->active > 0)
+        return false;
+    return table->rate == 0 || (uint64_t)(now - entry->last_ms) * table->rate >= entry->score;
+}
+
+// Procura o IP nas posições de sondagem; sem achar, devolve uma entrada livre
+// ou vencida em *reusable. Chamar com o mutex travado.
+static AdmissionEntry *find_locked(AdmissionTable *table, uint32_t ip, uint32_t now,
+                                   AdmissionEntry **reusable)
+{
+    uint32_t start = hash_ip(ip);
+    if (reusable)
+        *reusable = NULL;
+
+    for (uint32_t p = 0; p < ADMISSION_MAX_PROBE; p++)
+    {
+        AdmissionEntry *entry = &table->entries[(start + p) & (ADMISSION_TABLE_SIZE - 1)];
+        if (entry->ip == ip)
+            return entry;
+
+        if (reusable && !*reusable && (entry->ip == 0 || is_stale(table, entry, now)))
+            *reusable = entry;
+
+        // Entradas nunca voltam a zero, então o IP não pode estar depois de uma vazia
+        if (entry->ip == 0)
+            break;
+    }
+    return NULL;
+}
+
+int admission_init(AdmissionTable *table)
+{
+    if (!table)
+        return -1;
+
+    memset(table->entries, 0, sizeof(table->entries));
+    table->rate = ADMISSION_DEFAULT_RATE;
+    table->burst = ADMISSION_DEFAULT_BURST;
+    table->max_per_ip = ADMISSION_DEFAULT_MAX_PER_IP;
+    atomic_init(&table->admitted, 0);
+    atomic_init(&table->untracked, 0);
+    atomic_init(&table->rejected_rate, 0);
+    atomic_init(&table->rejected_concurrent, 0);
+
+    return pthread_mutex_init(&table->mutex, NULL) == 0 ? 0 : -1;
+}
+
+int admission_configure_rate(AdmissionTable *table, const char *spec)
+{
+    if (!table || !spec)
+        return -1;
+
+    unsigned int rate, burst;
+    int fields = sscanf(spec, "%u/%u", &rate, &burst);
+    if (fields < 1)
+        return -1;
+    if (fields == 1)
+        burst = rate;
+    if (burst == 0 && rate > 0)
+        burst = 1;
+    if (burst > UINT32_MAX / MILLI_CONNECTIONS)
+        return -1;
+
+    table->rate = rate;
+    table->burst = burst;
+    return 0;
+}
+
+AdmissionResult admission_admit(AdmissionTable *table, uint32_t ip)
+{
+    if (!table || (table->rate == 0 && table->max_per_ip == 0))
+        return ADMISSION_UNTRACKED;
+
+    uint32_t now = coarse_now_ms();
+    AdmissionEntry *reusable;
+
+    pthread_mutex_lock(&table->mutex);
+
+    AdmissionEntry *entry = find_locked(table, ip, now, &reusable);
+    if (!entry)
+    {
+        if (!reusable)
+        {
+            // Tabela saturada nessa região: deixa passar em vez de barrar IPs legítimos
+            pthread_mutex_unlock(&table->mutex);
+            atomic_fetch_add_explicit(&table->untracked, 1, memory_order_relaxed);
+            return ADMISSION_UNTRACKED;
+        }
+        entry = reusable;
+        memset(entry, 0, sizeof(*entry));
+        entry->ip = ip;
+        entry->last_ms = now;
+    }
+
+    decay(table, entry, now);
+
+    AdmissionResult result = ADMISSION_OK;
+    if (table->max_per_ip > 0 && entry->active >= table->max_per_ip)
+        result = ADMISSION_REJECT_CONCURRENT;
+    else if (table->rate > 0 && entry->score + MILLI_CONNECTIONS > table->burst * MILLI_CONNECTIONS)
+        result = ADMISSION_REJECT_RATE;
+    else
+    {
+        entry->score += MILLI_CONNECTIONS;
+        if (entry->active < UINT16_MAX)
+            entry->active++;
+    }
+
+    pthread_mutex_unlock(&table->mutex);
+
+    if (result == ADMISSION_OK)
+        atomic_fetch_add_explicit(&table->admitted, 1, memory_order_relaxed);
+    else if (result == ADMISSION_REJECT_RATE)
+        atomic_fetch_add_explicit(&table->rejected_rate, 1, memory_order_relaxed);
+    else
+        atomic_fetch_add_explicit(&table->rejected_concurrent, 1, memory_order_relaxed);
+    return result;
+}
+
+void admission_release(AdmissionTable *table, uint32_t ip)
+{
+    if (!table)
+        return;
+
+    pthread_mutex_lock(&table->mutex);
+    AdmissionEntry *entry = find_locked(table, ip, 0, NULL);
+    if (entry && entry->active > 0)
+        entry->active--;
+    pthread_mutex_unlock(&table->mutex);
+}
+
+void admission_destroy(AdmissionTable *table)
+{
+    if (!table)
+        return;
+
+    pthread_mutex_destroy(&table->mutex);
+}
@@ -0,0 +1,62 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define ADMISSION_TABLE_SIZE 4096 // Potência de 2
+#define ADMISSION_MAX_PROBE 8     // Posições examinadas por IP
+#define ADMISSION_DEFAULT_RATE 5  // Conexões por segundo por IP
+#define ADMISSION_DEFAULT_BURST 10
+#define ADMISSION_DEFAULT_MAX_PER_IP 8
+
+typedef enum
+{
+    ADMISSION_OK,
+    ADMISSION_UNTRACKED,   // Aceita, mas sem entrada livre na tabela (não conta concorrência)
+    ADMISSION_REJECT_RATE, // Conexões demais em pouco tempo
+    ADMISSION_REJECT_CONCURRENT
+} AdmissionResult;
+
+// 16 bytes por IP. O score é um contador que decai linearmente com o tempo
+// (rate mili-conexões por ms); a entrada pode ser reaproveitada quando não há
+// conexões ativas e o score chegou a zero.
+typedef struct
+{
+    uint32_t ip; // Ordem de rede; 0 = livre
+    uint32_t last_ms;
+    uint32_t score; // Mili-conexões
+    uint16_t active;
+    uint16_t reserved;
+} AdmissionEntry;
+
+typedef struct
+{
+    AdmissionEntry entries[ADMISSION_TABLE_SIZE];
+    uint32_t rate;  // 0 = sem limite de taxa
+    uint32_t burst;
+    uint32_t max_per_ip; // 0 = sem limite de concorrência
+    pthread_mutex_t mutex;
+
+    atomic_uint_fast64_t admitted;
+    atomic_uint_fast64_t untracked;
+    atomic_uint_fast64_t rejected_rate;
+    atomic_uint_fast64_t rejected_concurrent;
+} AdmissionTable;
+
+int admission_init(AdmissionTable *table);
+
+// spec no formato "taxa/rajada", como em rate_limiter_configure
+int admission_configure_rate(AdmissionTable *table, const char *spec);
+
+// Chamada logo após o accept. ip em ordem de rede (sin_addr.s_addr)
+AdmissionResult admission_admit(AdmissionTable *table, uint32_t ip);
+
+// Devolve a vaga de uma conexão que recebeu ADMISSION_OK
+void admission_release(AdmissionTable *table, uint32_t ip);
+
+void admission_destroy(AdmissionTable *table);
+
+#endif
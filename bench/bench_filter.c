@@ -0,0 +1,144 @@
+// Compara o filtro antigo (lowercase + strstr por palavra) com o autômato
+// Aho-Corasick de word_filter.c para listas de 10, 1k e 10k palavras.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "word_filter.h"
+
+#define BUFFER_SIZE 1024
+#define MESSAGE_COUNT 2000
+#define ROUNDS 20
+
+static const char *vocabulary[] = {
+    "ola", "pessoal", "tudo", "bem", "como", "vai", "hoje", "reuniao", "amanha",
+    "projeto", "servidor", "cliente", "mensagem", "obrigado", "certo", "vamos",
+    "almoco", "codigo", "teste", "deploy", "Bom", "Dia", "noite", "chat", NULL};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Implementação original de contains_profanity, parametrizada pela lista
+static int naive_contains(const char *const *words, const char *message)
+{
+    char lower_msg[BUFFER_SIZE];
+    strncpy(lower_msg, message, BUFFER_SIZE - 1);
+    lower_msg[BUFFER_SIZE - 1] = '\0';
+
+    for (int i = 0; lower_msg[i]; i++)
+    {
+        if (lower_msg[i] >= 'A' && lower_msg[i] <= 'Z')
+        {
+            lower_msg[i] = lower_msg[i] + 32;
+        }
+    }
+
+    for (int i = 0; words[i] != NULL; i++)
+    {
+        if (strstr(lower_msg, words[i]) != NULL)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static char **make_words(int count, unsigned int seed)
+{
+    char **words = calloc((size_t)count + 1, sizeof(char *));
+    srand(seed);
+    for (int i = 0; i < count; i++)
+    {
+        int length = 6 + rand() % 7;
+        words[i] = malloc((size_t)length + 1);
+        for (int j = 0; j < length; j++)
+            words[i][j] = (char)('a' + rand() % 26);
+        words[i][length] = '\0';
+    }
+    return words;
+}
+
+static char **make_messages(char **words, int word_count)
+{
+    int vocab = 0;
+    while (vocabulary[vocab])
+        vocab++;
+
+    char **messages = malloc(MESSAGE_COUNT * sizeof(char *));
+    for (int i = 0; i < MESSAGE_COUNT; i++)
+    {
+        char buffer[BUFFER_SIZE] = "";
+        int target = 40 + rand() % 200;
+        while ((int)strlen(buffer) < target)
+        {
+            strcat(buffer, vocabulary[rand() % vocab]);
+            strcat(buffer, " ");
+        }
+        // ~5% das mensagens contêm uma palavra proibida no final
+        if (rand() % 20 == 0)
+            strncat(buffer, words[rand() % word_count], sizeof(buffer) - strlen(buffer) - 1);
+        messages[i] = strdup(buffer);
+    }
+    return messages;
+}
+
+static void run(int word_count)
+{
+    char **words = make_words(word_count, 42u + (unsigned int)word_count);
+    char **messages = make_messages(words, word_count);
+
+    uint64_t start = now_ns();
+    WordFilter *filter = word_filter_create((const char *const *)words, word_count);
+    uint64_t build_ns = now_ns() - start;
+    if (!filter)
+    {
+        fprintf(stderr, "falha ao construir filtro com %d palavras\n", word_count);
+        exit(1);
+    }
+
+    int naive_hits = 0, ac_hits = 0;
+    int naive_rounds = word_count >= 10000 ? 2 : ROUNDS;
+
+    start = now_ns();
+    for (int r = 0; r < naive_rounds; r++)
+        for (int i = 0; i < MESSAGE_COUNT; i++)
+            naive_hits += naive_contains((const char *const *)words, messages[i]);
+    double naive_ns = (double)(now_ns() - start) / ((double)naive_rounds * MESSAGE_COUNT);
+
+    start = now_ns();
+    for (int r = 0; r < ROUNDS; r++)
+        for (int i = 0; i < MESSAGE_COUNT; i++)
+            ac_hits += word_filter_contains(filter, messages[i], strlen(messages[i]));
+    double ac_ns = (double)(now_ns() - start) / ((double)ROUNDS * MESSAGE_COUNT);
+
+    if (naive_hits / naive_rounds != ac_hits / ROUNDS)
+        fprintf(stderr, "AVISO: resultados divergentes (%d vs %d)\n",
+                naive_hits / naive_rounds, ac_hits / ROUNDS);
+
+    printf("%6d palavras | strstr: %10.0f ns/msg | aho-corasick: %6.0f ns/msg | "
+           "speedup %7.1fx | build %.2f ms\n",
+           word_count, naive_ns, ac_ns, naive_ns / ac_ns, (double)build_ns / 1e6);
+
+    word_filter_destroy(filter);
+    for (int i = 0; i < word_count; i++)
+        free(words[i]);
+    free(words);
+    for (int i = 0; i < MESSAGE_COUNT; i++)
+        free(messages[i]);
+    free(messages);
+}
+
+int main(void)
+{
+    printf("=== BENCHMARK DO FILTRO DE PALAVRAS (%d mensagens, pré-filtro %s) ===\n",
+           MESSAGE_COUNT, word_filter_simd_level());
+    run(10);
+    run(1000);
+    run(10000);
+    return 0;
+}
@@ -0,0 +1,291 @@
+// Compara dois arquivos de resultados (linha de base e execução atual) com o
+// teste t de Welch e aponta regressões estatisticamente significativas.
+//
+// Formato, uma métrica por linha ('#' inicia comentário):
+//   <nome> <higher|lower> <unidade> <amostra> <amostra> ...
+//
+//   ./bench/benchcmp bench/baseline.txt resultados.txt
+//   ./bench/benchcmp -a 0.01 -m 5 bench/baseline.txt resultados.txt
+//
+// Sai com 1 se alguma métrica piorou de forma significativa, 2 em erro.
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_METRICS 256
+#define MAX_SAMPLES 64
+#define MAX_NAME 128
+#define LINE_SIZE 4096
+
+typedef struct
+{
+    char name[MAX_NAME];
+    char unit[32];
+    bool higher_is_better;
+    double samples[MAX_SAMPLES];
+    int count;
+} Metric;
+
+typedef struct
+{
+    Metric metrics[MAX_METRICS];
+    int count;
+} ResultSet;
+
+static Metric *find_metric(ResultSet *set, const char *name)
+{
+    for (int i = 0; i < set->count; i++)
+    {
+        if (strcmp(set->metrics[i].name, name) == 0)
+            return &set->metrics[i];
+    }
+    return NULL;
+}
+
+// Linhas repetidas da mesma métrica somam amostras (várias execuções no mesmo arquivo)
+static int load_results(const char *path, ResultSet *set)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        perror(path);
+        return -1;
+    }
+
+    char line[LINE_SIZE];
+    int line_number = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        line_number++;
+        char *saveptr = NULL;
+        char *name = strtok_r(line, " \t\r\n", &saveptr);
+        if (!name || name[0] == '#')
+            continue;
+
+        char *direction = strtok_r(NULL, " \t\r\n", &saveptr);
+        char *unit = strtok_r(NULL, " \t\r\n", &saveptr);
+        if (!direction || !unit || (strcmp(direction, "higher") != 0 && strcmp(direction, "lower") != 0) ||
+            strlen(name) >= MAX_NAME)
+        {
+            fprintf(stderr, "%s:%d: linha inválida\n", path, line_number);
+            fclose(file);
+            return -1;
+        }
+
+        Metric *metric = find_metric(set, name);
+        if (!metric)
+        {
+            if (set->count == MAX_METRICS)
+            {
+                fprintf(stderr, "%s: mais de %d métricas\n", path, MAX_METRICS);
+                fclose(file);
+                return -1;
+            }
+            metric = &set->metrics[set->count++];
+            memset(metric, 0, sizeof(*metric));
+            strcpy(metric->name, name);
+            snprintf(metric->unit, sizeof(metric->unit), "%s", unit);
+            metric->higher_is_better = strcmp(direction, "higher") == 0;
+        }
+
+        for (char *token = strtok_r(NULL, " \t\r\n", &saveptr); token; token = strtok_r(NULL, " \t\r\n", &saveptr))
+        {
+            char *end;
+            double value = strtod(token, &end);
+            if (*end != '\0')
+            {
+                fprintf(stderr, "%s:%d: amostra inválida: %s\n", path, line_number, token);
+                fclose(file);
+                return -1;
+            }
+            if (metric->count < MAX_SAMPLES)
+                metric->samples[metric->count++] = value;
+        }
+    }
+
+    fclose(file);
+    return 0;
+}
+
+static void mean_variance(const Metric *metric, double *mean, double *variance)
+{
+    double sum = 0;
+    for (int i = 0; i < metric->count; i++)
+        sum += metric->samples[i];
+    *mean = sum / metric->count;
+
+    double squares = 0;
+    for (int i = 0; i < metric->count; i++)
+        squares += (metric->samples[i] - *mean) * (metric->samples[i] - *mean);
+    *variance = metric->count > 1 ? squares / (metric->count - 1) : 0.0;
+}
+
+// Fração contínua da beta incompleta regularizada (método de Lentz)
+static double beta_continued_fraction(double a, double b, double x)
+{
+    const double tiny = 1e-300;
+    double c = 1.0;
+    double d = 1.0 - (a + b) * x / (a + 1.0);
+    if (fabs(d) < tiny)
+        d = tiny;
+    d = 1.0 / d;
+    double result = d;
+
+    for (int m = 1; m <= 300; m++)
+    {
+        double m2 = 2.0 * m;
+        double numerator = m * (b - m) * x / ((a + m2 - 1.0) * (a + m2));
+        d = 1.0 + numerator * d;
+        c = 1.0 + numerator / c;
+        if (fabs(d) < tiny)
+            d = tiny;
+        if (fabs(c) < tiny)
+            c = tiny;
+        d = 1.0 / d;
+        result *= d * c;
+
+        numerator = -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1.0));
+        d = 1.0 + numerator * d;
+        c = 1.0 + numerator / c;
+        if (fabs(d) < tiny)
+            d = tiny;
+        if (fabs(c) < tiny)
+            c = tiny;
+        d = 1.0 / d;
+        double delta = d * c;
+        result *= delta;
+        if (fabs(delta - 1.0) < 1e-12)
+            break;
+    }
+    return result;
+}
+
+static double incomplete_beta(double a, double b, double x)
+{
+    if (x <= 0.0)
+        return 0.0;
+    if (x >= 1.0)
+        return 1.0;
+
+    double front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) + b * log(1.0 - x));
+    if (x < (a + 1.0) / (a + b + 2.0))
+        return front * beta_continued_fraction(a, b, x) / a;
+    return 1.0 - front * beta_continued_fraction(b, a, 1.0 - x) / b;
+}
+
+// Valor-p bicaudal do teste t de Welch (variâncias diferentes)
+static double welch_p_value(const Metric *base, const Metric *current)
+{
+    double mean_base, var_base, mean_current, var_current;
+    mean_variance(base, &mean_base, &var_base);
+    mean_variance(current, &mean_current, &var_current);
+
+    double se_base = var_base / base->count;
+    double se_current = var_current / current->count;
+    double se = se_base + se_current;
+    if (se <= 0.0)
+        return mean_base == mean_current ? 1.0 : 0.0;
+
+    double t = (mean_current - mean_base) / sqrt(se);
+    double df = se * se / (se_base * se_base / (base->count - 1) + se_current * se_current / (current->count - 1));
+    return incomplete_beta(df / 2.0, 0.5, df / (df + t * t));
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr,
+            "Uso: %s [-a alfa] [-m mudança%%] BASELINE ATUAL\n"
+            "  -a ALFA   nível de significância (padrão 0.05)\n"
+            "  -m PCT    mudança mínima, em %%, para contar como regressão (padrão 2)\n",
+            program);
+}
+
+int main(int argc, char *argv[])
+{
+    double alpha = 0.05;
+    double min_change = 2.0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "a:m:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'a':
+            alpha = atof(optarg);
+            break;
+        case 'm':
+            min_change = atof(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    if (argc - optind != 2 || alpha <= 0.0 || alpha >= 1.0 || min_change < 0.0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    static ResultSet baseline;
+    static ResultSet current;
+    if (load_results(argv[optind], &baseline) != 0 || load_results(argv[optind + 1], &current) != 0)
+        return 2;
+
+    printf("%-44s %14s %14s %8s %8s  %s\n", "métrica", "base", "atual", "delta", "p", "veredito");
+
+    int regressions = 0;
+    int improvements = 0;
+    for (int i = 0; i < baseline.count; i++)
+    {
+        const Metric *base = &baseline.metrics[i];
+        const Metric *now = find_metric(&current, base->name);
+        if (!now)
+        {
+            printf("%-44s %14s %14s %8s %8s  ausente na execução atual\n", base->name, "-", "-", "-", "-");
+            continue;
+        }
+
+        double mean_base, mean_now, unused;
+        mean_variance(base, &mean_base, &unused);
+        mean_variance(now, &mean_now, &unused);
+        double change = mean_base != 0.0 ? (mean_now - mean_base) / fabs(mean_base) * 100.0 : 0.0;
+
+        const char *verdict = "sem mudança";
+        double p = 1.0;
+        if (base->count < 2 || now->count < 2)
+        {
+            verdict = "amostras insuficientes";
+        }
+        else
+        {
+            p = welch_p_value(base, now);
+            bool worse = base->higher_is_better ? change < 0 : change > 0;
+            if (p < alpha && fabs(change) >= min_change)
+            {
+                verdict = worse ? "REGRESSÃO" : "melhora";
+                if (worse)
+                    regressions++;
+                else
+                    improvements++;
+            }
+        }
+
+        printf("%-44s %14.1f %14.1f %+7.1f%% %8.4f  %s (%s, n=%d/%d)\n", base->name, mean_base, mean_now, change, p,
+               verdict, base->unit, base->count, now->count);
+    }
+
+    for (int i = 0; i < current.count; i++)
+    {
+        if (!find_metric(&baseline, current.metrics[i].name))
+            printf("%-44s %14s %14s %8s %8s  nova (sem linha de base)\n", current.metrics[i].name, "-", "-", "-", "-");
+    }
+
+    printf("\n%d regressão(ões), %d melhora(s) com alfa=%.3g e mudança mínima de %.1f%%\n", regressions, improvements,
+           alpha, min_change);
+    return regressions > 0 ? 1 : 0;
+}
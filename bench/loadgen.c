@@ -0,0 +1,567 @@
+// Gerador de carga: um único processo com epoll abre N conexões, autentica,
+// envia broadcasts a uma taxa fixa (laço aberto) com mistura de tamanhos e
+// mede a latência de entrega em todos os outros clientes da sala.
+//
+// Cada mensagem leva "LG <conexão> <seq> <ns>" com o instante *agendado* de
+// envio, então atrasos do próprio gerador entram na medida (sem omissão
+// coordenada). O servidor precisa estar com limites folgados, por exemplo:
+//   CHAT_RATE_BROADCAST=0 CHAT_ADMISSION_RATE=0 CHAT_ADMISSION_MAX_PER_IP=0 ./server
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include "latency_histogram.h"
+
+#define MAX_CONNECTIONS 1024
+#define IO_BUFFER_SIZE (64 * 1024)
+#define MAX_PAYLOAD 900 // Cabe numa linha do servidor já com o prefixo "[nome]: "
+#define MAX_SIZE_CLASSES 8
+#define DRAIN_NS 2000000000ULL
+
+typedef enum
+{
+    CONN_CONNECTING,
+    CONN_AUTHENTICATING,
+    CONN_READY,
+    CONN_CLOSED
+} ConnState;
+
+typedef struct
+{
+    int fd;
+    int id;
+    ConnState state;
+    uint64_t seq;
+    char in[IO_BUFFER_SIZE];
+    size_t in_length;
+    char out[IO_BUFFER_SIZE];
+    size_t out_length;
+} Connection;
+
+typedef struct
+{
+    int size;
+    int weight;
+} SizeClass;
+
+typedef struct
+{
+    const char *host;
+    int port;
+    int connections;
+    double rate; // Mensagens por segundo, somando todas as conexões
+    double duration;
+    double warmup;
+    const char *password;
+    SizeClass sizes[MAX_SIZE_CLASSES];
+    int size_count;
+    int total_weight;
+    bool json;
+} Options;
+
+typedef struct
+{
+    uint64_t connect_errors;
+    uint64_t auth_failures;
+    uint64_t server_full;
+    uint64_t disconnects;
+    uint64_t rate_limited;
+    uint64_t send_overflows;
+    uint64_t sent;
+    uint64_t sent_measured;
+    uint64_t expected;
+    uint64_t delivered;
+    uint64_t delivered_measured;
+    uint64_t bytes_received;
+} Counters;
+
+static Connection *connections;
+static Options options;
+static Counters counters;
+static LatencyHistogram delivery_latency;
+static int ready_count;
+static int epoll_fd;
+static volatile sig_atomic_t interrupted;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    interrupted = 1;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr,
+            "Uso: %s [opções]\n"
+            "  -H host       servidor (padrão 127.0.0.1)\n"
+            "  -p porta      porta (padrão 8080)\n"
+            "  -c N          conexões (padrão 10)\n"
+            "  -r taxa       mensagens/s no total (padrão 100)\n"
+            "  -d segundos   duração da medição (padrão 10)\n"
+            "  -w segundos   aquecimento descartado (padrão 1)\n"
+            "  -s mistura    tamanhos e pesos, ex.: 32:70,256:25,900:5 (padrão 64:1)\n"
+            "  -P senha      senha do /auth (padrão chat123)\n"
+            "  -j            resultado em JSON\n",
+            program);
+}
+
+static int parse_sizes(const char *spec)
+{
+    options.size_count = 0;
+    options.total_weight = 0;
+
+    char copy[256];
+    strncpy(copy, spec, sizeof(copy) - 1);
+    copy[sizeof(copy) - 1] = '\0';
+
+    for (char *item = strtok(copy, ","); item; item = strtok(NULL, ","))
+    {
+        int size, weight = 1;
+        if (sscanf(item, "%d:%d", &size, &weight) < 1 || size < 32 || size > MAX_PAYLOAD || weight <= 0 ||
+            options.size_count == MAX_SIZE_CLASSES)
+            return -1;
+        options.sizes[options.size_count].size = size;
+        options.sizes[options.size_count].weight = weight;
+        options.size_count++;
+        options.total_weight += weight;
+    }
+    return options.size_count > 0 ? 0 : -1;
+}
+
+static int pick_size(void)
+{
+    int roll = rand() % options.total_weight;
+    for (int i = 0; i < options.size_count; i++)
+    {
+        roll -= options.sizes[i].weight;
+        if (roll < 0)
+            return options.sizes[i].size;
+    }
+    return options.sizes[0].size;
+}
+
+static void close_connection(Connection *conn)
+{
+    if (conn->state == CONN_CLOSED)
+        return;
+    if (conn->state == CONN_READY)
+        ready_count--;
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    conn->state = CONN_CLOSED;
+}
+
+static void update_events(Connection *conn)
+{
+    struct epoll_event event = {.events = EPOLLIN | (conn->out_length > 0 ? EPOLLOUT : 0), .data.ptr = conn};
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &event);
+}
+
+static void flush_output(Connection *conn)
+{
+    size_t offset = 0;
+    while (offset < conn->out_length)
+    {
+        ssize_t sent = send(conn->fd, conn->out + offset, conn->out_length - offset, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                counters.disconnects++;
+                close_connection(conn);
+                return;
+            }
+            break;
+        }
+        offset += (size_t)sent;
+    }
+
+    bool had_pending = conn->out_length > 0;
+    memmove(conn->out, conn->out + offset, conn->out_length - offset);
+    conn->out_length -= offset;
+    if (had_pending != (conn->out_length > 0) || conn->out_length > 0)
+        update_events(conn);
+}
+
+static bool queue_output(Connection *conn, const char *data, size_t length)
+{
+    if (conn->out_length + length > sizeof(conn->out))
+    {
+        counters.send_overflows++;
+        return false;
+    }
+    memcpy(conn->out + conn->out_length, data, length);
+    conn->out_length += length;
+    flush_output(conn);
+    return true;
+}
+
+static void handle_line(Connection *conn, char *line, uint64_t now, uint64_t measure_start)
+{
+    if (strcmp(line, "/ping") == 0)
+    {
+        queue_output(conn, "/pong\n", 6);
+        return;
+    }
+
+    char *marker = strstr(line, "LG ");
+    if (marker)
+    {
+        int sender;
+        unsigned long long seq, stamp;
+        if (sscanf(marker, "LG %d %llu %llu", &sender, &seq, &stamp) == 3)
+        {
+            counters.delivered++;
+            if (stamp >= measure_start)
+            {
+                counters.delivered_measured++;
+                latency_histogram_record(&delivery_latency, now > stamp ? now - stamp : 0);
+            }
+        }
+        return;
+    }
+
+    if (conn->state == CONN_AUTHENTICATING)
+    {
+        if (strstr(line, "Autenticado com sucesso"))
+        {
+            conn->state = CONN_READY;
+            ready_count++;
+        }
+        else if (strstr(line, "Senha incorreta"))
+        {
+            counters.auth_failures++;
+            close_connection(conn);
+        }
+    }
+
+    if (strstr(line, "Muitas mensagens"))
+        counters.rate_limited++;
+    else if (strstr(line, "Servidor lotado"))
+        counters.server_full++;
+}
+
+static void read_input(Connection *conn, uint64_t measure_start)
+{
+    for (;;)
+    {
+        ssize_t received = recv(conn->fd, conn->in + conn->in_length, sizeof(conn->in) - 1 - conn->in_length, 0);
+        if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        {
+            counters.disconnects++;
+            close_connection(conn);
+            return;
+        }
+        if (received < 0)
+            return;
+
+        uint64_t now = now_ns();
+        counters.bytes_received += (uint64_t)received;
+        conn->in_length += (size_t)received;
+
+        char *line = conn->in;
+        char *newline;
+        while ((newline = memchr(line, '\n', conn->in_length - (size_t)(line - conn->in))))
+        {
+            *newline = '\0';
+            handle_line(conn, line, now, measure_start);
+            if (conn->state == CONN_CLOSED)
+                return;
+            line = newline + 1;
+        }
+
+        conn->in_length -= (size_t)(line - conn->in);
+        memmove(conn->in, line, conn->in_length);
+        if (conn->in_length == sizeof(conn->in) - 1)
+            conn->in_length = 0; // Linha gigante: descarta
+    }
+}
+
+static int open_connection(Connection *conn, const struct sockaddr_in *addr)
+{
+    conn->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (conn->fd < 0)
+        return -1;
+
+    int one = 1;
+    setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (connect(conn->fd, (const struct sockaddr *)addr, sizeof(*addr)) != 0 && errno != EINPROGRESS)
+    {
+        close(conn->fd);
+        return -1;
+    }
+
+    conn->state = CONN_CONNECTING;
+    struct epoll_event event = {.events = EPOLLIN | EPOLLOUT, .data.ptr = conn};
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, conn->fd, &event);
+}
+
+static void handle_event(Connection *conn, uint32_t events, uint64_t measure_start)
+{
+    // Fechada por um evento anterior do mesmo epoll_wait: o fd já não é dela
+    if (conn->state == CONN_CLOSED)
+        return;
+
+    if (conn->state == CONN_CONNECTING)
+    {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0 || (events & (EPOLLERR | EPOLLHUP)))
+        {
+            counters.connect_errors++;
+            close_connection(conn);
+            return;
+        }
+
+        char auth[128];
+        int auth_length = snprintf(auth, sizeof(auth), "/auth %s\n", options.password);
+        conn->state = CONN_AUTHENTICATING;
+        queue_output(conn, auth, (size_t)auth_length);
+        update_events(conn);
+        return;
+    }
+
+    if (events & EPOLLIN)
+        read_input(conn, measure_start);
+    if (conn->state != CONN_CLOSED && (events & EPOLLOUT))
+        flush_output(conn);
+}
+
+static void send_message(Connection *conn, uint64_t scheduled_ns, bool measured)
+{
+    char line[MAX_PAYLOAD + 2];
+    int size = pick_size();
+    int length = snprintf(line, sizeof(line), "LG %d %llu %llu ", conn->id,
+                          (unsigned long long)conn->seq++, (unsigned long long)scheduled_ns);
+    while (length < size)
+        line[length++] = 'x';
+    line[length++] = '\n';
+
+    if (queue_output(conn, line, (size_t)length))
+    {
+        counters.sent++;
+        counters.expected += (uint64_t)(ready_count > 0 ? ready_count - 1 : 0);
+        if (measured)
+            counters.sent_measured++;
+    }
+}
+
+static void print_report(double elapsed_s, double measured_s)
+{
+    double loss = counters.expected > 0 ? 1.0 - (double)counters.delivered / (double)counters.expected : 0.0;
+    if (loss < 0)
+        loss = 0;
+
+    double p50 = latency_histogram_percentile(&delivery_latency, 0.50) / 1e3;
+    double p90 = latency_histogram_percentile(&delivery_latency, 0.90) / 1e3;
+    double p99 = latency_histogram_percentile(&delivery_latency, 0.99) / 1e3;
+    double p999 = latency_histogram_percentile(&delivery_latency, 0.999) / 1e3;
+    double max = latency_histogram_max(&delivery_latency) / 1e3;
+    double mean = latency_histogram_mean(&delivery_latency) / 1e3;
+    uint64_t errors = counters.connect_errors + counters.auth_failures + counters.server_full +
+                      counters.disconnects + counters.rate_limited + counters.send_overflows;
+
+    if (options.json)
+    {
+        printf("{\"connections\":%d,\"ready\":%d,\"rate\":%.1f,\"duration_s\":%.3f,\"measured_s\":%.3f,"
+               "\"sent\":%llu,\"expected_deliveries\":%llu,\"delivered\":%llu,\"loss\":%.6f,"
+               "\"send_rate\":%.1f,\"delivery_rate\":%.1f,\"bytes_received\":%llu,"
+               "\"latency_us\":{\"count\":%llu,\"mean\":%.1f,\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,"
+               "\"p999\":%.1f,\"max\":%.1f},"
+               "\"errors\":{\"total\":%llu,\"connect\":%llu,\"auth\":%llu,\"server_full\":%llu,"
+               "\"disconnects\":%llu,\"rate_limited\":%llu,\"send_overflow\":%llu}}\n",
+               options.connections, ready_count, options.rate, elapsed_s, measured_s,
+               (unsigned long long)counters.sent, (unsigned long long)counters.expected,
+               (unsigned long long)counters.delivered, loss,
+               measured_s > 0 ? counters.sent_measured / measured_s : 0.0,
+               measured_s > 0 ? counters.delivered_measured / measured_s : 0.0,
+               (unsigned long long)counters.bytes_received,
+               (unsigned long long)latency_histogram_count(&delivery_latency), mean, p50, p90, p99, p999, max,
+               (unsigned long long)errors, (unsigned long long)counters.connect_errors,
+               (unsigned long long)counters.auth_failures, (unsigned long long)counters.server_full,
+               (unsigned long long)counters.disconnects, (unsigned long long)counters.rate_limited,
+               (unsigned long long)counters.send_overflows);
+        return;
+    }
+
+    printf("=== LOADGEN ===\n");
+    printf("Conexões:        %d pedidas, %d autenticadas\n", options.connections, ready_count);
+    printf("Enviadas:        %llu (%.1f msg/s medidas)\n", (unsigned long long)counters.sent,
+           measured_s > 0 ? counters.sent_measured / measured_s : 0.0);
+    printf("Entregas:        %llu de %llu esperadas (perda %.3f%%), %.1f entregas/s\n",
+           (unsigned long long)counters.delivered, (unsigned long long)counters.expected, loss * 100,
+           measured_s > 0 ? counters.delivered_measured / measured_s : 0.0);
+    printf("Latência (µs):   média %.1f  p50 %.1f  p90 %.1f  p99 %.1f  p999 %.1f  máx %.1f  (%llu amostras)\n",
+           mean, p50, p90, p99, p999, max, (unsigned long long)latency_histogram_count(&delivery_latency));
+    printf("Erros:           conexão %llu, autenticação %llu, lotado %llu, desconexões %llu, "
+           "limite de taxa %llu, buffer cheio %llu\n",
+           (unsigned long long)counters.connect_errors, (unsigned long long)counters.auth_failures,
+           (unsigned long long)counters.server_full, (unsigned long long)counters.disconnects,
+           (unsigned long long)counters.rate_limited, (unsigned long long)counters.send_overflows);
+    printf("Tempo total:     %.2f s\n", elapsed_s);
+}
+
+int main(int argc, char *argv[])
+{
+    options.host = "127.0.0.1";
+    options.port = 8080;
+    options.connections = 10;
+    options.rate = 100;
+    options.duration = 10;
+    options.warmup = 1;
+    options.password = "chat123";
+    parse_sizes("64:1");
+
+    int opt;
+    while ((opt = getopt(argc, argv, "H:p:c:r:d:w:s:P:jh")) != -1)
+    {
+        switch (opt)
+        {
+        case 'H': options.host = optarg; break;
+        case 'p': options.port = atoi(optarg); break;
+        case 'c': options.connections = atoi(optarg); break;
+        case 'r': options.rate = atof(optarg); break;
+        case 'd': options.duration = atof(optarg); break;
+        case 'w': options.warmup = atof(optarg); break;
+        case 'P': options.password = optarg; break;
+        case 'j': options.json = true; break;
+        case 's':
+            if (parse_sizes(optarg) != 0)
+            {
+                fprintf(stderr, "Mistura de tamanhos inválida: %s (tamanhos entre 32 e %d)\n", optarg, MAX_PAYLOAD);
+                return 1;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (options.connections < 1 || options.connections > MAX_CONNECTIONS || options.rate <= 0 ||
+        options.duration <= 0 || options.warmup < 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)options.port);
+    if (inet_pton(AF_INET, options.host, &addr.sin_addr) != 1)
+    {
+        fprintf(stderr, "Endereço inválido: %s\n", options.host);
+        return 1;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+    srand(42);
+    latency_histogram_init(&delivery_latency);
+
+    epoll_fd = epoll_create1(0);
+    connections = calloc((size_t)options.connections, sizeof(Connection));
+    if (epoll_fd < 0 || !connections)
+    {
+        perror("loadgen");
+        return 1;
+    }
+
+    uint64_t started = now_ns();
+    for (int i = 0; i < options.connections; i++)
+    {
+        connections[i].id = i;
+        if (open_connection(&connections[i], &addr) != 0)
+        {
+            counters.connect_errors++;
+            connections[i].state = CONN_CLOSED;
+        }
+    }
+
+    struct epoll_event events[256];
+    uint64_t setup_deadline = started + 5000000000ULL;
+    uint64_t send_start = 0, measure_start = UINT64_MAX, send_end = 0, finish = 0;
+    uint64_t scheduled = 0;
+    int next_conn = 0;
+
+    while (!interrupted)
+    {
+        uint64_t now = now_ns();
+
+        // Começa a enviar quando todas autenticaram (ou no prazo de preparação)
+        if (send_start == 0)
+        {
+            int pending = 0;
+            for (int i = 0; i < options.connections; i++)
+                pending += connections[i].state == CONN_CONNECTING || connections[i].state == CONN_AUTHENTICATING;
+            if (pending == 0 || now >= setup_deadline)
+            {
+                if (ready_count == 0)
+                {
+                    fprintf(stderr, "Nenhuma conexão autenticada\n");
+                    break;
+                }
+                send_start = now;
+                measure_start = send_start + (uint64_t)(options.warmup * 1e9);
+                send_end = measure_start + (uint64_t)(options.duration * 1e9);
+                finish = send_end + DRAIN_NS;
+            }
+        }
+
+        if (send_start != 0)
+        {
+            if (now >= finish)
+                break;
+
+            // Laço aberto: quantas mensagens já deveriam ter saído até agora
+            uint64_t horizon = now < send_end ? now : send_end;
+            uint64_t due = (uint64_t)((double)(horizon - send_start) * options.rate / 1e9);
+            while (scheduled < due && ready_count > 0)
+            {
+                uint64_t scheduled_ns = send_start + (uint64_t)((double)scheduled * 1e9 / options.rate);
+                Connection *conn = &connections[next_conn];
+                next_conn = (next_conn + 1) % options.connections;
+                if (conn->state != CONN_READY)
+                    continue;
+                send_message(conn, scheduled_ns, scheduled_ns >= measure_start);
+                scheduled++;
+            }
+        }
+
+        int count = epoll_wait(epoll_fd, events, 256, 1);
+        for (int i = 0; i < count; i++)
+            handle_event(events[i].data.ptr, events[i].events, measure_start);
+    }
+
+    double elapsed_s = (now_ns() - started) / 1e9;
+    double measured_s = send_end > measure_start ? (send_end - measure_start) / 1e9 : 0.0;
+    print_report(elapsed_s, measured_s);
+
+    for (int i = 0; i < options.connections; i++)
+        close_connection(&connections[i]);
+    free(connections);
+    close(epoll_fd);
+    return 0;
+}
@@ -0,0 +1,792 @@
+// Microbenchmarks das estruturas centrais: fila thread-safe, client manager,
+// filtro de palavras e tslog. Cada caso roda com aquecimento, threads fixadas
+// em CPUs e várias repetições; o relatório traz ops/s (mediana, mínimo e
+// máximo entre repetições) e percentis da latência por operação. Com -o, as
+// amostras de cada repetição vão também para um arquivo de resultados que o
+// bench/benchcmp compara com uma linha de base (ver bench/regress.sh).
+//
+//   make bench
+//   ./bench/microbench -r 10 -t 1,2,4 -c 10,100 -f client_manager
+//   ./bench/microbench -f tsqueue -o resultados.txt
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "thread_safe_queue.h"
+#include "client_manager.h"
+#include "moderation.h"
+#include "latency_histogram.h"
+#include "tslog.h"
+
+#define MAX_REPEATS 64
+#define MAX_LIST 16
+#define LOG_FILE "bench/microbench.log"
+#define LOG_SEGMENT_SIZE (16 * 1024 * 1024)
+#define FILTER_FILE "filter_words.txt"
+#define SAMPLE_MESSAGES 1024
+#define BROADCAST_PAYLOAD 128
+#define PASSWORD "chat123"
+
+typedef void (*BenchOpFn)(void *ctx, int thread, uint64_t i);
+
+typedef struct
+{
+    int repeats;
+    uint64_t iterations; // Por thread
+    uint64_t warmup;     // Por thread
+    int threads[MAX_LIST];
+    int thread_count;
+    int clients[MAX_LIST];
+    int client_count;
+    const char *filter;
+    bool pin;
+    FILE *results; // -o: formato de bench/benchcmp
+} BenchOptions;
+
+typedef struct
+{
+    const char *name;
+    int threads;
+    int clients; // -1 quando o caso não depende da tabela de clientes
+    int fanout;  // Entregas por operação (0 = não se aplica)
+    uint64_t iterations;
+    uint64_t warmup;
+    BenchOpFn op;
+    void *ctx;
+} BenchSpec;
+
+typedef struct
+{
+    double ops_per_sec[MAX_REPEATS];
+    int runs;
+    LatencyHistogram latency; // Todas as repetições somadas
+} BenchResult;
+
+typedef struct
+{
+    const BenchSpec *spec;
+    int thread;
+    pthread_barrier_t *barrier;
+    LatencyHistogram latency;
+    uint64_t start_ns;
+    uint64_t end_ns;
+} OpWorker;
+
+static BenchOptions options = {
+    .repeats = 5,
+    .iterations = 100000,
+    .warmup = 10000,
+    .threads = {1, 2, 4, 8},
+    .thread_count = 4,
+    .clients = {10, 50, MAX_CLIENTS},
+    .client_count = 3,
+    .filter = NULL,
+    .pin = true,
+    .results = NULL,
+};
+
+static int cpu_count = 1;
+
+static const char *vocabulary[] = {
+    "ola", "pessoal", "tudo", "bem", "como", "vai", "hoje", "reuniao", "amanha",
+    "projeto", "servidor", "cliente", "mensagem", "obrigado", "certo", "vamos",
+    "almoco", "codigo", "teste", "deploy", "Bom", "Dia", "noite", "chat", NULL};
+
+static void pin_thread(int index)
+{
+    if (!options.pin)
+        return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(index % cpu_count, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static bool selected(const char *name)
+{
+    return !options.filter || strstr(name, options.filter) != NULL;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Uma linha por métrica: nome, sentido bom (higher/lower), unidade e as
+// amostras de cada repetição
+static void write_samples(const char *name, const char *unit, const BenchResult *result, double scale)
+{
+    fprintf(options.results, "%s higher %s", name, unit);
+    for (int r = 0; r < result->runs; r++)
+        fprintf(options.results, " %.1f", result->ops_per_sec[r] * scale);
+    fprintf(options.results, "\n");
+}
+
+static void write_results(const BenchSpec *spec, const BenchResult *result)
+{
+    char name[128];
+    int length = snprintf(name, sizeof(name), "%s/t%d", spec->name, spec->threads);
+    if (spec->clients >= 0)
+        snprintf(name + length, sizeof(name) - (size_t)length, "/c%d", spec->clients);
+
+    write_samples(name, "ops/s", result, 1.0);
+    if (spec->fanout > 0)
+    {
+        strncat(name, "/fanout", sizeof(name) - strlen(name) - 1);
+        write_samples(name, "deliveries/s", result, spec->fanout);
+    }
+    fflush(options.results);
+}
+
+static void report(const BenchSpec *spec, BenchResult *result)
+{
+    double sorted[MAX_REPEATS];
+    memcpy(sorted, result->ops_per_sec, sizeof(double) * (size_t)result->runs);
+    qsort(sorted, (size_t)result->runs, sizeof(double), compare_double);
+
+    char clients[16] = "-";
+    if (spec->clients >= 0)
+        snprintf(clients, sizeof(clients), "%d", spec->clients);
+
+    printf("%-32s %7d %8s %13.0f %13.0f %13.0f %8llu %8llu %9llu\n",
+           spec->name, spec->threads, clients,
+           sorted[result->runs / 2], sorted[0], sorted[result->runs - 1],
+           (unsigned long long)latency_histogram_percentile(&result->latency, 0.50),
+           (unsigned long long)latency_histogram_percentile(&result->latency, 0.99),
+           (unsigned long long)latency_histogram_percentile(&result->latency, 0.999));
+    fflush(stdout);
+
+    if (options.results)
+        write_results(spec, result);
+}
+
+// Um relógio por operação: o instante do fim de uma é o início da próxima, e
+// o custo de registrar no histograma (local à thread) entra na medida.
+static void *op_worker(void *arg)
+{
+    OpWorker *worker = arg;
+    const BenchSpec *spec = worker->spec;
+    pin_thread(worker->thread);
+
+    for (uint64_t i = 0; i < spec->warmup; i++)
+        spec->op(spec->ctx, worker->thread, i);
+
+    pthread_barrier_wait(worker->barrier);
+
+    uint64_t previous = latency_now_ns();
+    worker->start_ns = previous;
+    for (uint64_t i = 0; i < spec->iterations; i++)
+    {
+        spec->op(spec->ctx, worker->thread, spec->warmup + i);
+        uint64_t now = latency_now_ns();
+        latency_histogram_record(&worker->latency, now - previous);
+        previous = now;
+    }
+    worker->end_ns = previous;
+    return NULL;
+}
+
+static int run_spec(const BenchSpec *spec)
+{
+    if (!selected(spec->name))
+        return 0;
+
+    BenchResult *result = calloc(1, sizeof(BenchResult));
+    OpWorker *workers = calloc((size_t)spec->threads, sizeof(OpWorker));
+    pthread_t *threads = calloc((size_t)spec->threads, sizeof(pthread_t));
+    if (!result || !workers || !threads)
+    {
+        free(result);
+        free(workers);
+        free(threads);
+        return -1;
+    }
+    latency_histogram_init(&result->latency);
+
+    for (int r = 0; r < options.repeats; r++)
+    {
+        pthread_barrier_t barrier;
+        pthread_barrier_init(&barrier, NULL, (unsigned)spec->threads);
+
+        for (int t = 0; t < spec->threads; t++)
+        {
+            workers[t].spec = spec;
+            workers[t].thread = t;
+            workers[t].barrier = &barrier;
+            latency_histogram_init(&workers[t].latency);
+            pthread_create(&threads[t], NULL, op_worker, &workers[t]);
+        }
+
+        // Vazão sobre o intervalo de parede em que alguma thread mediu
+        uint64_t first_start = UINT64_MAX;
+        uint64_t last_end = 0;
+        for (int t = 0; t < spec->threads; t++)
+        {
+            pthread_join(threads[t], NULL);
+            if (workers[t].start_ns < first_start)
+                first_start = workers[t].start_ns;
+            if (workers[t].end_ns > last_end)
+                last_end = workers[t].end_ns;
+            latency_histogram_merge(&result->latency, &workers[t].latency);
+        }
+        pthread_barrier_destroy(&barrier);
+
+        uint64_t elapsed = last_end > first_start ? last_end - first_start : 1;
+        result->ops_per_sec[result->runs++] = (double)spec->iterations * spec->threads * 1e9 / (double)elapsed;
+    }
+
+    report(spec, result);
+    free(result);
+    free(workers);
+    free(threads);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Fila: produtores e consumidores reais; a latência é o tempo de espera na
+// fila (enqueue_ns até a saída), a mesma etapa "queue" medida pelo servidor.
+
+typedef struct
+{
+    ThreadSafeQueue *queue;
+    int thread;
+    uint64_t count;
+    uint64_t warmup;
+    pthread_barrier_t *barrier;
+    LatencyHistogram latency;
+} QueueWorker;
+
+static void *queue_producer(void *arg)
+{
+    QueueWorker *worker = arg;
+    pin_thread(worker->thread);
+
+    Message msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.type = MSG_BROADCAST;
+    snprintf(msg.content, sizeof(msg.content), "mensagem de benchmark da fila");
+
+    for (uint64_t i = 0; i < worker->warmup; i++)
+    {
+        msg.enqueue_ns = latency_now_ns();
+        tsqueue_enqueue(worker->queue, &msg);
+    }
+
+    pthread_barrier_wait(worker->barrier);
+
+    msg.sender_fd = 1; // Marca as mensagens medidas
+    for (uint64_t i = 0; i < worker->count; i++)
+    {
+        msg.enqueue_ns = latency_now_ns();
+        tsqueue_enqueue(worker->queue, &msg);
+    }
+    return NULL;
+}
+
+static void *queue_consumer(void *arg)
+{
+    QueueWorker *worker = arg;
+    pin_thread(worker->thread);
+
+    Message msg;
+    while (tsqueue_dequeue(worker->queue, &msg) == 0 && msg.type != MSG_ERROR)
+    {
+        if (msg.sender_fd == 1)
+            latency_histogram_record(&worker->latency, latency_now_ns() - msg.enqueue_ns);
+    }
+    return NULL;
+}
+
+static int run_queue_pairs(int pairs)
+{
+    BenchSpec spec = {.name = "tsqueue_enqueue_dequeue", .threads = pairs * 2, .clients = -1,
+                      .iterations = options.iterations, .warmup = options.warmup};
+    if (!selected(spec.name))
+        return 0;
+
+    BenchResult *result = calloc(1, sizeof(BenchResult));
+    QueueWorker *workers = calloc((size_t)pairs * 2, sizeof(QueueWorker));
+    pthread_t *threads = calloc((size_t)pairs * 2, sizeof(pthread_t));
+    if (!result || !workers || !threads)
+    {
+        free(result);
+        free(workers);
+        free(threads);
+        return -1;
+    }
+    latency_histogram_init(&result->latency);
+
+    for (int r = 0; r < options.repeats; r++)
+    {
+        ThreadSafeQueue queue;
+        tsqueue_init(&queue);
+        pthread_barrier_t barrier;
+        pthread_barrier_init(&barrier, NULL, (unsigned)pairs + 1);
+
+        for (int t = 0; t < pairs * 2; t++)
+        {
+            workers[t].queue = &queue;
+            workers[t].thread = t;
+            workers[t].count = spec.iterations;
+            workers[t].warmup = spec.warmup;
+            workers[t].barrier = &barrier;
+            latency_histogram_init(&workers[t].latency);
+            pthread_create(&threads[t], NULL, t < pairs ? queue_producer : queue_consumer, &workers[t]);
+        }
+
+        pthread_barrier_wait(&barrier);
+        uint64_t start = latency_now_ns();
+
+        for (int t = 0; t < pairs; t++)
+            pthread_join(threads[t], NULL);
+
+        // Um sentinela por consumidor, depois de todas as mensagens medidas
+        Message stop;
+        memset(&stop, 0, sizeof(stop));
+        stop.type = MSG_ERROR;
+        for (int t = 0; t < pairs; t++)
+            tsqueue_enqueue(&queue, &stop);
+
+        for (int t = pairs; t < pairs * 2; t++)
+        {
+            pthread_join(threads[t], NULL);
+            latency_histogram_merge(&result->latency, &workers[t].latency);
+        }
+        uint64_t elapsed = latency_now_ns() - start;
+
+        pthread_barrier_destroy(&barrier);
+        tsqueue_destroy(&queue);
+
+        result->ops_per_sec[result->runs++] = (double)spec.iterations * pairs * 1e9 / (double)elapsed;
+    }
+
+    report(&spec, result);
+    free(result);
+    free(workers);
+    free(threads);
+    return 0;
+}
+
+// Par try_enqueue + try_dequeue na mesma thread: custo da fila sem espera,
+// com todas as threads disputando o mesmo mutex.
+static void op_queue_try_pair(void *ctx, int thread, uint64_t i)
+{
+    (void)thread;
+    (void)i;
+    ThreadSafeQueue *queue = ctx;
+    static _Thread_local Message msg;
+    tsqueue_try_enqueue(queue, &msg);
+    tsqueue_try_dequeue(queue, &msg);
+}
+
+static int bench_queue(void)
+{
+    for (int n = 0; n < options.thread_count; n++)
+    {
+        if (run_queue_pairs(options.threads[n]) != 0)
+            return -1;
+    }
+
+    ThreadSafeQueue queue;
+    tsqueue_init(&queue);
+    for (int n = 0; n < options.thread_count; n++)
+    {
+        BenchSpec spec = {.name = "tsqueue_try_pair", .threads = options.threads[n], .clients = -1,
+                          .iterations = options.iterations, .warmup = options.warmup,
+                          .op = op_queue_try_pair, .ctx = &queue};
+        if (run_spec(&spec) != 0)
+            break;
+    }
+    tsqueue_destroy(&queue);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Client manager: tabela com N clientes autenticados na sala padrão, cada um
+// num socketpair cuja outra ponta é esvaziada por uma thread de drenagem.
+
+typedef struct
+{
+    ClientManager manager;
+    int count;
+    int fds[MAX_CLIENTS];
+    int peers[MAX_CLIENTS];
+    char usernames[MAX_CLIENTS][MAX_USERNAME_SIZE];
+    char payload[BROADCAST_PAYLOAD];
+    pthread_t drainer;
+    volatile bool draining;
+} ClientTable;
+
+static void *drain_peers(void *arg)
+{
+    ClientTable *table = arg;
+    struct pollfd pfds[MAX_CLIENTS];
+    char buffer[65536];
+
+    for (int i = 0; i < table->count; i++)
+    {
+        pfds[i].fd = table->peers[i];
+        pfds[i].events = POLLIN;
+    }
+
+    while (table->draining)
+    {
+        if (poll(pfds, (nfds_t)table->count, 100) <= 0)
+            continue;
+
+        for (int i = 0; i < table->count; i++)
+        {
+            if (pfds[i].revents & POLLIN)
+            {
+                while (recv(pfds[i].fd, buffer, sizeof(buffer), MSG_DONTWAIT) > 0)
+                    ;
+            }
+        }
+    }
+    return NULL;
+}
+
+static int client_table_init(ClientTable *table, int count)
+{
+    memset(table, 0, sizeof(*table));
+    if (client_manager_init(&table->manager) != 0)
+        return -1;
+
+    for (int i = 0; i < count; i++)
+    {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0)
+            return -1;
+
+        table->fds[i] = pair[0];
+        table->peers[i] = pair[1];
+        table->count++;
+        snprintf(table->usernames[i], MAX_USERNAME_SIZE, "bench%03d", i);
+
+        if (client_manager_add(&table->manager, pair[0], table->usernames[i], "127.0.0.1", 40000 + i) != 0 ||
+            client_manager_authenticate(&table->manager, pair[0], PASSWORD) != 0)
+            return -1;
+    }
+
+    memset(table->payload, 'x', sizeof(table->payload) - 2);
+    table->payload[sizeof(table->payload) - 2] = '\n';
+    table->payload[sizeof(table->payload) - 1] = '\0';
+
+    table->draining = true;
+    if (pthread_create(&table->drainer, NULL, drain_peers, table) != 0)
+    {
+        table->draining = false;
+        return -1;
+    }
+    return 0;
+}
+
+static void client_table_destroy(ClientTable *table)
+{
+    if (table->draining)
+    {
+        table->draining = false;
+        pthread_join(table->drainer, NULL);
+    }
+
+    client_manager_destroy(&table->manager);
+    for (int i = 0; i < table->count; i++)
+    {
+        close(table->fds[i]);
+        close(table->peers[i]);
+    }
+}
+
+static void op_find_by_socket(void *ctx, int thread, uint64_t i)
+{
+    ClientTable *table = ctx;
+    client_manager_find_by_socket(&table->manager, table->fds[(i + (uint64_t)thread) % (uint64_t)table->count]);
+}
+
+static void op_find_by_username(void *ctx, int thread, uint64_t i)
+{
+    ClientTable *table = ctx;
+    client_manager_find_by_username(&table->manager,
+                                    table->usernames[(i + (uint64_t)thread) % (uint64_t)table->count]);
+}
+
+static void op_broadcast_room(void *ctx, int thread, uint64_t i)
+{
+    (void)thread;
+    (void)i;
+    ClientTable *table = ctx;
+    client_manager_broadcast_room(&table->manager, DEFAULT_ROOM_ID, table->payload, -1);
+}
+
+static int bench_client_manager(void)
+{
+    ClientTable *table = malloc(sizeof(ClientTable));
+    if (!table)
+        return -1;
+
+    for (int c = 0; c < options.client_count; c++)
+    {
+        if (client_table_init(table, options.clients[c]) != 0)
+        {
+            fprintf(stderr, "Falha ao montar tabela com %d clientes: %s\n", options.clients[c], strerror(errno));
+            client_table_destroy(table);
+            free(table);
+            return -1;
+        }
+
+        for (int n = 0; n < options.thread_count; n++)
+        {
+            BenchSpec by_socket = {.name = "client_manager_find_by_socket", .threads = options.threads[n],
+                                   .clients = table->count, .iterations = options.iterations,
+                                   .warmup = options.warmup, .op = op_find_by_socket, .ctx = table};
+            BenchSpec by_username = by_socket;
+            by_username.name = "client_manager_find_by_username";
+            by_username.op = op_find_by_username;
+            run_spec(&by_socket);
+            run_spec(&by_username);
+        }
+
+        // O servidor tem um único broadcast_worker; cada operação é um envio
+        // para toda a sala, então poucas iterações bastam
+        BenchSpec broadcast = {.name = "client_manager_broadcast_room", .threads = 1, .clients = table->count,
+                               .fanout = table->count,
+                               .iterations = options.iterations / 10 + 1, .warmup = options.warmup / 10 + 1,
+                               .op = op_broadcast_room, .ctx = table};
+        run_spec(&broadcast);
+
+        client_table_destroy(table);
+    }
+
+    free(table);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Filtro de palavras: mensagens do vocabulário com ~5% contendo uma palavra
+// bloqueada, como no tráfego real do chat.
+
+typedef struct
+{
+    char text[SAMPLE_MESSAGES][160];
+    size_t length[SAMPLE_MESSAGES];
+} MessageSamples;
+
+static void build_samples(MessageSamples *samples)
+{
+    int vocabulary_size = 0;
+    while (vocabulary[vocabulary_size])
+        vocabulary_size++;
+
+    srand(42);
+    for (int m = 0; m < SAMPLE_MESSAGES; m++)
+    {
+        char *text = samples->text[m];
+        size_t length = 0;
+        int words = 4 + rand() % 12;
+        for (int w = 0; w < words; w++)
+        {
+            const char *word = (rand() % 100 < 5 && w == words / 2) ? "SPAM" : vocabulary[rand() % vocabulary_size];
+            length += (size_t)snprintf(text + length, sizeof(samples->text[m]) - length, "%s%s", w ? " " : "", word);
+        }
+        samples->length[m] = length;
+    }
+}
+
+static void op_contains_profanity(void *ctx, int thread, uint64_t i)
+{
+    MessageSamples *samples = ctx;
+    size_t m = (size_t)((i + (uint64_t)thread * 7) % SAMPLE_MESSAGES);
+    moderation_contains_profanity(samples->text[m], samples->length[m]);
+}
+
+static int bench_profanity(void)
+{
+    if (!selected("contains_profanity"))
+        return 0;
+
+    if (moderation_init(FILTER_FILE) != 0)
+    {
+        fprintf(stderr, "Não foi possível carregar %s\n", FILTER_FILE);
+        return -1;
+    }
+
+    MessageSamples *samples = malloc(sizeof(MessageSamples));
+    if (!samples)
+        return -1;
+    build_samples(samples);
+
+    for (int n = 0; n < options.thread_count; n++)
+    {
+        BenchSpec spec = {.name = "contains_profanity", .threads = options.threads[n], .clients = -1,
+                          .iterations = options.iterations, .warmup = options.warmup,
+                          .op = op_contains_profanity, .ctx = samples};
+        run_spec(&spec);
+    }
+
+    free(samples);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// tslog: linhas de tamanho típico no arquivo temporário do benchmark
+
+static void op_tslog_write(void *ctx, int thread, uint64_t i)
+{
+    (void)ctx;
+    (void)thread;
+    (void)i;
+    tslog_write("mensagem de benchmark com o tamanho de uma linha comum de log do chat");
+}
+
+static int bench_tslog(void)
+{
+    for (int n = 0; n < options.thread_count; n++)
+    {
+        BenchSpec spec = {.name = "tslog_write", .threads = options.threads[n], .clients = -1,
+                          .iterations = options.iterations, .warmup = options.warmup,
+                          .op = op_tslog_write, .ctx = NULL};
+        run_spec(&spec);
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+
+static int parse_list(const char *text, int *values, int *count, int max_value)
+{
+    *count = 0;
+    char *copy = strdup(text);
+    if (!copy)
+        return -1;
+
+    char *saveptr = NULL;
+    for (char *token = strtok_r(copy, ",", &saveptr); token; token = strtok_r(NULL, ",", &saveptr))
+    {
+        int value = atoi(token);
+        if (value <= 0 || value > max_value || *count == MAX_LIST)
+        {
+            free(copy);
+            return -1;
+        }
+        values[(*count)++] = value;
+    }
+
+    free(copy);
+    return *count > 0 ? 0 : -1;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr,
+            "Uso: %s [-r repetições] [-n iterações] [-w aquecimento] [-t threads] [-c clientes] [-f filtro] [-P] [-o arquivo]\n"
+            "  -r N      repetições de cada caso (padrão 5, máx %d)\n"
+            "  -n N      iterações medidas por thread (padrão 100000)\n"
+            "  -w N      iterações de aquecimento por thread (padrão 10000)\n"
+            "  -t LISTA  contagens de threads, ex. 1,2,4,8 (padrão)\n"
+            "  -c LISTA  tamanhos da tabela de clientes, ex. 10,50,100 (padrão; máx %d)\n"
+            "  -f TEXTO  roda só os casos cujo nome contém TEXTO\n"
+            "  -P        não fixa threads em CPUs\n"
+            "  -o ARQ    acrescenta as amostras de cada repetição a ARQ (entrada do bench/benchcmp)\n",
+            program, MAX_REPEATS, MAX_CLIENTS);
+}
+
+static uint64_t clock_overhead_ns(void)
+{
+    uint64_t start = latency_now_ns();
+    uint64_t now = start;
+    for (int i = 0; i < 100000; i++)
+        now = latency_now_ns();
+    return (now - start) / 100000;
+}
+
+int main(int argc, char *argv[])
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "r:n:w:t:c:f:o:Ph")) != -1)
+    {
+        switch (opt)
+        {
+        case 'r':
+            options.repeats = atoi(optarg);
+            break;
+        case 'n':
+            options.iterations = strtoull(optarg, NULL, 10);
+            break;
+        case 'w':
+            options.warmup = strtoull(optarg, NULL, 10);
+            break;
+        case 't':
+            if (parse_list(optarg, options.threads, &options.thread_count, 256) != 0)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'c':
+            if (parse_list(optarg, options.clients, &options.client_count, MAX_CLIENTS) != 0)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'f':
+            options.filter = optarg;
+            break;
+        case 'P':
+            options.pin = false;
+            break;
+        case 'o':
+            options.results = fopen(optarg, "a");
+            if (!options.results)
+            {
+                fprintf(stderr, "Não foi possível abrir %s: %s\n", optarg, strerror(errno));
+                return 1;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (options.repeats <= 0 || options.repeats > MAX_REPEATS || options.iterations == 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    cpu_count = online > 0 ? (int)online : 1;
+
+    // Os módulos registram no tslog; tudo vai para um arquivo descartável
+    tslog_init_ex(LOG_FILE, LOG_SEGMENT_SIZE, 1);
+
+    printf("# microbench: %d repetições, %llu iterações/thread (aquecimento %llu), %d CPUs%s, relógio ~%llu ns\n",
+           options.repeats, (unsigned long long)options.iterations, (unsigned long long)options.warmup,
+           cpu_count, options.pin ? " (threads fixadas)" : "", (unsigned long long)clock_overhead_ns());
+    printf("%-32s %7s %8s %13s %13s %13s %8s %8s %9s\n",
+           "caso", "threads", "clientes", "ops/s", "mín ops/s", "máx ops/s", "p50 ns", "p99 ns", "p999 ns");
+
+    int status = 0;
+    if (bench_queue() != 0 || bench_client_manager() != 0 || bench_profanity() != 0 || bench_tslog() != 0)
+        status = 1;
+
+    if (options.results)
+        fclose(options.results);
+    tslog_close();
+    unlink(LOG_FILE);
+    unlink(LOG_FILE ".1");
+    return status;
+}
@@ -0,0 +1,148 @@
+#!/bin/bash
+
+# Resultados de benchmark comparáveis entre versões
+#
+#   bench/regress.sh run [ARQUIVO]               # Mede e grava (padrão bench/results.txt)
+#   bench/regress.sh baseline                    # Mede e grava bench/baseline.txt
+#   bench/regress.sh compare [BASELINE] [ARQUIVO] # Mede e compara; sai com 1 em regressão
+#
+# Mede vazão da fila (bench/microbench), taxa de fan-out do broadcast
+# (microbench e servidor real) e latência ponta a ponta (bench/loadgen contra
+# ./server em loopback). Cada repetição vira uma amostra; bench/benchcmp
+# aplica o teste t de Welch entre a linha de base e a execução atual.
+
+set -u
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+PORT=8080
+
+REPEATS=${REPEATS:-5}
+LG_CONNECTIONS=${LG_CONNECTIONS:-20}
+LG_RATE=${LG_RATE:-1000}
+LG_DURATION=${LG_DURATION:-5}
+ALPHA=${ALPHA:-0.05}
+MIN_CHANGE=${MIN_CHANGE:-2}
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+NC='\033[0m'
+
+print_info() {
+    echo -e "${YELLOW}[INFO]${NC} $1" >&2
+}
+
+print_error() {
+    echo -e "${RED}[ERRO]${NC} $1" >&2
+}
+
+print_success() {
+    echo -e "${GREEN}[SUCESSO]${NC} $1" >&2
+}
+
+server_pid=""
+work_dir=""
+
+cleanup() {
+    if [[ -n "$server_pid" ]]; then
+        kill -INT "$server_pid" 2>/dev/null
+        wait "$server_pid" 2>/dev/null
+    fi
+    [[ -n "$work_dir" ]] && rm -rf "$work_dir"
+}
+trap cleanup EXIT
+
+port_in_use() {
+    (exec 3<>"/dev/tcp/127.0.0.1/$PORT") 2>/dev/null
+}
+
+# Servidor isolado num diretório temporário, sem limites por conexão/IP
+# (mediríamos o rate limiter, não o caminho de broadcast)
+start_server() {
+    if port_in_use; then
+        print_error "Porta $PORT já está em uso; pare o servidor em execução"
+        exit 2
+    fi
+
+    work_dir=$(mktemp -d)
+    (cd "$work_dir" &&
+        CHAT_FILTER_FILE="$ROOT/filter_words.txt" CHAT_METRICS_PORT=0 \
+        CHAT_RATE_BROADCAST=0 CHAT_ADMISSION_RATE=0 CHAT_ADMISSION_MAX_PER_IP=0 \
+        exec "$ROOT/server" > server.out 2>&1) &
+    server_pid=$!
+
+    for _ in {1..50}; do
+        port_in_use && return 0
+        sleep 0.1
+    done
+    print_error "Servidor não respondeu na porta $PORT"
+    exit 2
+}
+
+json_field() {
+    sed -n "s/.*\"$1\":\([0-9.]*\).*/\1/p"
+}
+
+run_benchmarks() {
+    local out="$1"
+    make -C "$ROOT" -s server bench/microbench bench/loadgen bench/benchcmp || exit 2
+
+    {
+        echo "# $(date '+%Y-%m-%d %H:%M:%S') $(uname -srm), $(nproc) CPUs, $REPEATS repetições"
+        echo "# commit $(git -C "$ROOT" rev-parse --short HEAD 2>/dev/null || echo desconhecido)"
+    } > "$out"
+
+    print_info "Microbenchmarks da fila e do broadcast..."
+    (cd "$ROOT" &&
+        ./bench/microbench -r "$REPEATS" -t 1,2,4 -f tsqueue_enqueue_dequeue -o "$out" &&
+        ./bench/microbench -r "$REPEATS" -c 10,100 -f broadcast_room -o "$out") >&2 || exit 2
+
+    print_info "Ponta a ponta: $LG_CONNECTIONS conexões, $LG_RATE msg/s, ${LG_DURATION}s x $REPEATS..."
+    start_server
+
+    local mean="" p99="" delivery=""
+    for ((i = 1; i <= REPEATS; i++)); do
+        local json
+        json=$("$ROOT/bench/loadgen" -p "$PORT" -c "$LG_CONNECTIONS" -r "$LG_RATE" -d "$LG_DURATION" -w 1 -j) || {
+            print_error "loadgen falhou na repetição $i"
+            exit 2
+        }
+        mean+=" $(echo "$json" | json_field mean)"
+        p99+=" $(echo "$json" | json_field p99)"
+        delivery+=" $(echo "$json" | json_field delivery_rate)"
+    done
+
+    {
+        echo "e2e_latency_mean/c$LG_CONNECTIONS/r$LG_RATE lower us$mean"
+        echo "e2e_latency_p99/c$LG_CONNECTIONS/r$LG_RATE lower us$p99"
+        echo "e2e_fanout/c$LG_CONNECTIONS/r$LG_RATE higher deliveries/s$delivery"
+    } >> "$out"
+
+    print_success "Resultados em $out"
+}
+
+case "${1:-}" in
+run)
+    run_benchmarks "$(realpath -m "${2:-$ROOT/bench/results.txt}")"
+    ;;
+baseline)
+    run_benchmarks "$ROOT/bench/baseline.txt"
+    ;;
+compare)
+    baseline=$(realpath -m "${2:-$ROOT/bench/baseline.txt}")
+    current=$(realpath -m "${3:-$ROOT/bench/results.txt}")
+    if [[ ! -f "$baseline" ]]; then
+        print_error "Linha de base $baseline não existe; gere com: $0 baseline"
+        exit 2
+    fi
+    run_benchmarks "$current"
+    "$ROOT/bench/benchcmp" -a "$ALPHA" -m "$MIN_CHANGE" "$baseline" "$current"
+    ;;
+*)
+    echo "Uso: $0 run [ARQUIVO] | baseline | compare [BASELINE] [ARQUIVO]"
+    echo ""
+    echo "Variáveis: REPEATS=$REPEATS LG_CONNECTIONS=$LG_CONNECTIONS LG_RATE=$LG_RATE"
+    echo "           LG_DURATION=$LG_DURATION ALPHA=$ALPHA MIN_CHANGE=$MIN_CHANGE"
+    exit 1
+    ;;
+esac
@@ -0,0 +1,545 @@
+// Reproduz uma captura de tráfego do servidor (CHAT_CAPTURE_FILE) contra um
+// servidor local: cada conexão gravada vira uma conexão nova, e cada linha é
+// reenviada no instante gravado dividido pela velocidade (-x 1, -x 10, -x max).
+//
+// Os /pong da captura eram respostas ao servidor de então e são descartados;
+// o replay responde aos /ping do servidor atual. Tudo o que chega é lido e
+// descartado, para nenhum destinatário virar consumidor lento.
+//
+//   CHAT_CAPTURE_FILE=trafego.cap ./server          # Gravação
+//   ./bench/replay -i trafego.cap                   # Só resume a captura
+//   ./bench/replay -x 10 trafego.cap                # 10x mais rápido
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include "capture.h"
+#include "latency_histogram.h"
+
+#define IO_BUFFER_SIZE (64 * 1024)
+#define DRAIN_NS 5000000000ULL // Espera máxima pelo servidor fechar as conexões no fim
+#define BACKPRESSURE_NS 5000000000ULL // Espera máxima por espaço no buffer de saída
+#define PUMP_EVERY 32                 // Em velocidade máxima, lê os sockets a cada N registros
+#define HEARTBEAT_PING "/ping"
+#define HEARTBEAT_PONG "/pong"
+
+typedef enum
+{
+    CONN_CONNECTING,
+    CONN_OPEN,
+    CONN_CLOSING,  // CLOSE gravado; encerra a escrita quando a saída esvaziar
+    CONN_FINISHED, // Escrita encerrada; lê até o servidor fechar
+    CONN_CLOSED
+} ConnState;
+
+typedef struct
+{
+    int fd;
+    ConnState state;
+    bool close_requested; // CLOSE gravado antes do connect terminar
+    char in[IO_BUFFER_SIZE];
+    size_t in_length;
+    char out[IO_BUFFER_SIZE];
+    size_t out_length;
+} Connection;
+
+typedef struct
+{
+    const char *host;
+    int port;
+    double speed; // 0 = o mais rápido possível
+    bool keep_pongs;
+    bool info_only;
+} Options;
+
+typedef struct
+{
+    uint64_t opened;
+    uint64_t connect_errors;
+    uint64_t server_closed;
+    uint64_t lines;
+    uint64_t bytes_sent;
+    uint64_t pongs_skipped;
+    uint64_t pings_answered;
+    uint64_t overflows;
+    uint64_t bytes_received;
+} Counters;
+
+static Options options = {.host = "127.0.0.1", .port = 8080, .speed = 1.0};
+static Counters counters;
+static LatencyHistogram schedule_lag; // Atraso de cada linha em relação ao agendado
+static Connection **connections;      // Indexado pelo id da captura
+static size_t connection_slots;
+static int active_count;
+static int epoll_fd;
+static struct sockaddr_in server_addr;
+static volatile sig_atomic_t interrupted;
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    interrupted = 1;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr,
+            "Uso: %s [opções] CAPTURA\n"
+            "  -H host       servidor (padrão 127.0.0.1)\n"
+            "  -p porta      porta (padrão 8080)\n"
+            "  -x vel        velocidade: 1 (tempo real, padrão), N (N vezes), max (sem esperas)\n"
+            "  -k            reenvia também os /pong gravados\n"
+            "  -i            só resume a captura, sem conectar\n",
+            program);
+}
+
+static void close_connection(Connection *conn)
+{
+    if (conn->state == CONN_CLOSED)
+        return;
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    conn->state = CONN_CLOSED;
+    active_count--;
+}
+
+static void update_events(Connection *conn)
+{
+    struct epoll_event event = {.events = EPOLLIN | (conn->out_length > 0 ? EPOLLOUT : 0), .data.ptr = conn};
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &event);
+}
+
+static void flush_output(Connection *conn)
+{
+    if (conn->state == CONN_CONNECTING || conn->state == CONN_FINISHED || conn->state == CONN_CLOSED)
+        return;
+
+    size_t offset = 0;
+    while (offset < conn->out_length)
+    {
+        ssize_t sent = send(conn->fd, conn->out + offset, conn->out_length - offset, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                counters.server_closed++;
+                close_connection(conn);
+                return;
+            }
+            break;
+        }
+        offset += (size_t)sent;
+    }
+
+    memmove(conn->out, conn->out + offset, conn->out_length - offset);
+    conn->out_length -= offset;
+    update_events(conn);
+
+    // Fechar com dados não lidos mandaria RST e o servidor perderia as últimas
+    // linhas; encerra só a escrita e espera o EOF dele
+    if (conn->state == CONN_CLOSING && conn->out_length == 0)
+    {
+        shutdown(conn->fd, SHUT_WR);
+        conn->state = CONN_FINISHED;
+    }
+}
+
+static bool queue_output(Connection *conn, const char *data, size_t length)
+{
+    if (conn->state == CONN_FINISHED || conn->out_length + length > sizeof(conn->out))
+        return false;
+    memcpy(conn->out + conn->out_length, data, length);
+    conn->out_length += length;
+    flush_output(conn);
+    return true;
+}
+
+static void read_input(Connection *conn)
+{
+    for (;;)
+    {
+        ssize_t received = recv(conn->fd, conn->in + conn->in_length, sizeof(conn->in) - 1 - conn->in_length, 0);
+        if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        {
+            if (conn->state != CONN_FINISHED)
+                counters.server_closed++;
+            close_connection(conn);
+            return;
+        }
+        if (received < 0)
+            return;
+
+        counters.bytes_received += (uint64_t)received;
+        conn->in_length += (size_t)received;
+
+        char *line = conn->in;
+        char *newline;
+        while ((newline = memchr(line, '\n', conn->in_length - (size_t)(line - conn->in))))
+        {
+            *newline = '\0';
+            if (strcmp(line, HEARTBEAT_PING) == 0 && queue_output(conn, HEARTBEAT_PONG "\n", 6))
+                counters.pings_answered++;
+            if (conn->state == CONN_CLOSED)
+                return;
+            line = newline + 1;
+        }
+
+        conn->in_length -= (size_t)(line - conn->in);
+        memmove(conn->in, line, conn->in_length);
+        if (conn->in_length == sizeof(conn->in) - 1)
+            conn->in_length = 0; // Linha gigante: descarta
+    }
+}
+
+static void handle_event(Connection *conn, uint32_t events)
+{
+    // Fechada por um evento anterior do mesmo epoll_wait: o fd já não é dela
+    if (conn->state == CONN_CLOSED)
+        return;
+
+    if (conn->state == CONN_CONNECTING)
+    {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0 || (events & (EPOLLERR | EPOLLHUP)))
+        {
+            counters.connect_errors++;
+            close_connection(conn);
+            return;
+        }
+        conn->state = conn->close_requested ? CONN_CLOSING : CONN_OPEN;
+        flush_output(conn);
+        return;
+    }
+
+    if (events & EPOLLIN)
+        read_input(conn);
+    if (conn->state != CONN_CLOSED && (events & EPOLLOUT))
+        flush_output(conn);
+}
+
+static void pump(int timeout_ms)
+{
+    struct epoll_event events[256];
+    int count = epoll_wait(epoll_fd, events, 256, timeout_ms);
+    for (int i = 0; i < count; i++)
+        handle_event(events[i].data.ptr, events[i].events);
+}
+
+static void wait_until(uint64_t deadline)
+{
+    for (;;)
+    {
+        uint64_t now = latency_now_ns();
+        if (now >= deadline || interrupted)
+            return;
+        // Abaixo de 1 ms o epoll não espera; gira lendo os sockets
+        pump((int)((deadline - now) / 1000000));
+    }
+}
+
+static Connection *lookup(uint32_t id)
+{
+    return id < connection_slots ? connections[id] : NULL;
+}
+
+static void open_recorded(uint32_t id)
+{
+    if (id >= connection_slots)
+    {
+        size_t slots = connection_slots ? connection_slots : 256;
+        while (slots <= id)
+            slots *= 2;
+        Connection **grown = realloc(connections, slots * sizeof(Connection *));
+        if (!grown)
+            return;
+        memset(grown + connection_slots, 0, (slots - connection_slots) * sizeof(Connection *));
+        connections = grown;
+        connection_slots = slots;
+    }
+
+    Connection *conn = calloc(1, sizeof(Connection));
+    if (!conn)
+        return;
+    connections[id] = conn;
+    conn->state = CONN_CLOSED;
+
+    conn->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (conn->fd < 0)
+    {
+        counters.connect_errors++;
+        return;
+    }
+
+    int one = 1;
+    setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(conn->fd, (const struct sockaddr *)&server_addr, sizeof(server_addr)) != 0 && errno != EINPROGRESS)
+    {
+        counters.connect_errors++;
+        close(conn->fd);
+        return;
+    }
+
+    conn->state = CONN_CONNECTING;
+    struct epoll_event event = {.events = EPOLLIN | EPOLLOUT, .data.ptr = conn};
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, conn->fd, &event);
+    active_count++;
+    counters.opened++;
+}
+
+static void send_recorded(Connection *conn, const CaptureRecord *record)
+{
+    char line[CAPTURE_MAX_LINE + 1];
+    memcpy(line, record->data, record->length);
+    line[record->length] = '\n';
+
+    // Servidor sem ler: espera espaço em vez de perder a linha
+    uint64_t deadline = latency_now_ns() + BACKPRESSURE_NS;
+    while (!queue_output(conn, line, record->length + 1))
+    {
+        if (conn->state == CONN_CLOSED || interrupted || latency_now_ns() >= deadline)
+        {
+            counters.overflows++;
+            return;
+        }
+        pump(1);
+    }
+    counters.lines++;
+    counters.bytes_sent += record->length + 1;
+}
+
+static void apply_record(const CaptureRecord *record, uint64_t due_ns)
+{
+    if (record->type == CAPTURE_OPEN)
+    {
+        open_recorded(record->connection);
+        return;
+    }
+
+    Connection *conn = lookup(record->connection);
+    if (!conn || conn->close_requested || conn->state == CONN_CLOSED)
+        return;
+
+    if (record->type == CAPTURE_CLOSE)
+    {
+        // Fecha depois de enviar o que já está na fila de saída
+        conn->close_requested = true;
+        if (conn->state == CONN_OPEN)
+        {
+            conn->state = CONN_CLOSING;
+            flush_output(conn);
+        }
+        return;
+    }
+
+    if (!options.keep_pongs && record->length == strlen(HEARTBEAT_PONG) &&
+        memcmp(record->data, HEARTBEAT_PONG, record->length) == 0)
+    {
+        counters.pongs_skipped++;
+        return;
+    }
+
+    uint64_t now = latency_now_ns();
+    latency_histogram_record(&schedule_lag, now > due_ns ? now - due_ns : 0);
+    send_recorded(conn, record);
+}
+
+typedef struct
+{
+    uint64_t connections;
+    uint64_t lines;
+    uint64_t bytes;
+    uint64_t duration_us;
+    size_t valid_bytes;
+} CaptureSummary;
+
+static void summarize(const char *data, size_t size, CaptureSummary *summary)
+{
+    memset(summary, 0, sizeof(*summary));
+    size_t offset = CAPTURE_HEADER_SIZE;
+    CaptureRecord record;
+    size_t used;
+    while ((used = capture_read_record(data + offset, size - offset, &record)) > 0)
+    {
+        summary->duration_us += record.delta_us;
+        if (record.type == CAPTURE_OPEN)
+            summary->connections++;
+        else if (record.type == CAPTURE_LINE)
+        {
+            summary->lines++;
+            summary->bytes += record.length;
+        }
+        offset += used;
+    }
+    summary->valid_bytes = offset;
+}
+
+static void print_report(const char *path, const CaptureSummary *summary, double elapsed_s)
+{
+    double recorded_s = summary->duration_us / 1e6;
+    printf("=== REPLAY ===\n");
+    printf("Captura:         %s (%llu conexões, %llu linhas, %.2f s gravados)\n", path,
+           (unsigned long long)summary->connections, (unsigned long long)summary->lines, recorded_s);
+    if (options.speed > 0)
+        printf("Velocidade:      %gx\n", options.speed);
+    else
+        printf("Velocidade:      máxima\n");
+    printf("Conexões:        %llu abertas, %llu falhas, %llu fechadas pelo servidor\n",
+           (unsigned long long)counters.opened, (unsigned long long)counters.connect_errors,
+           (unsigned long long)counters.server_closed);
+    printf("Linhas:          %llu enviadas (%llu bytes), %llu /pong gravados ignorados, %llu sem espaço\n",
+           (unsigned long long)counters.lines, (unsigned long long)counters.bytes_sent,
+           (unsigned long long)counters.pongs_skipped, (unsigned long long)counters.overflows);
+    printf("Recebido:        %llu bytes, %llu /ping respondidos\n", (unsigned long long)counters.bytes_received,
+           (unsigned long long)counters.pings_answered);
+    printf("Duração:         %.3f s (%.1f linhas/s)\n", elapsed_s, elapsed_s > 0 ? counters.lines / elapsed_s : 0.0);
+    printf("Atraso (µs):     p50 %.1f  p99 %.1f  máx %.1f em relação ao agendado\n",
+           latency_histogram_percentile(&schedule_lag, 0.50) / 1000.0,
+           latency_histogram_percentile(&schedule_lag, 0.99) / 1000.0,
+           latency_histogram_max(&schedule_lag) / 1000.0);
+}
+
+int main(int argc, char *argv[])
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "H:p:x:kih")) != -1)
+    {
+        switch (opt)
+        {
+        case 'H': options.host = optarg; break;
+        case 'p': options.port = atoi(optarg); break;
+        case 'x':
+            options.speed = strcmp(optarg, "max") == 0 ? 0.0 : atof(optarg);
+            if (options.speed <= 0 && strcmp(optarg, "max") != 0)
+            {
+                fprintf(stderr, "Velocidade inválida: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'k': options.keep_pongs = true; break;
+        case 'i': options.info_only = true; break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (argc - optind != 1)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    const char *path = argv[optind];
+
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        perror(path);
+        return 1;
+    }
+
+    size_t size = (size_t)st.st_size;
+    const char *data = size > 0 ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    uint64_t started_ns;
+    if (!data || data == MAP_FAILED || capture_read_header(data, size, &started_ns) != 0)
+    {
+        fprintf(stderr, "%s não é uma captura válida\n", path);
+        return 1;
+    }
+
+    CaptureSummary summary;
+    summarize(data, size, &summary);
+    if (summary.valid_bytes < size)
+        fprintf(stderr, "Aviso: %zu bytes finais incompletos ignorados\n", size - summary.valid_bytes);
+
+    if (options.info_only)
+    {
+        time_t started = (time_t)(started_ns / 1000000000ULL);
+        char when[64];
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&started));
+        printf("Captura:   %s (iniciada em %s)\n", path, when);
+        printf("Conexões:  %llu\n", (unsigned long long)summary.connections);
+        printf("Linhas:    %llu (%llu bytes; arquivo com %zu bytes)\n", (unsigned long long)summary.lines,
+               (unsigned long long)summary.bytes, size);
+        printf("Duração:   %.2f s\n", summary.duration_us / 1e6);
+        return 0;
+    }
+
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons((uint16_t)options.port);
+    if (inet_pton(AF_INET, options.host, &server_addr.sin_addr) != 1)
+    {
+        fprintf(stderr, "Endereço inválido: %s\n", options.host);
+        return 1;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    epoll_fd = epoll_create1(0);
+    latency_histogram_init(&schedule_lag);
+
+    uint64_t start = latency_now_ns();
+    uint64_t recorded_us = 0;
+    size_t offset = CAPTURE_HEADER_SIZE;
+    uint64_t applied = 0;
+    CaptureRecord record;
+    size_t used;
+    while (!interrupted && (used = capture_read_record(data + offset, size - offset, &record)) > 0)
+    {
+        offset += used;
+        recorded_us += record.delta_us;
+
+        uint64_t due = start;
+        if (options.speed > 0)
+        {
+            due += (uint64_t)(recorded_us * 1000.0 / options.speed);
+            wait_until(due);
+        }
+        else if (++applied % PUMP_EVERY == 0)
+        {
+            pump(0);
+        }
+        apply_record(&record, options.speed > 0 ? due : latency_now_ns());
+    }
+
+    // Dá tempo para as últimas linhas saírem e as respostas chegarem
+    uint64_t drain_end = latency_now_ns() + DRAIN_NS;
+    while (!interrupted && active_count > 0 && latency_now_ns() < drain_end)
+        pump(10);
+
+    double elapsed_s = (latency_now_ns() - start) / 1e9;
+    print_report(path, &summary, elapsed_s);
+
+    for (size_t i = 0; i < connection_slots; i++)
+    {
+        if (connections[i])
+        {
+            close_connection(connections[i]);
+            free(connections[i]);
+        }
+    }
+    free(connections);
+    munmap((void *)data, size);
+    close(epoll_fd);
+    return 0;
+}
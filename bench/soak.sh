@@ -0,0 +1,228 @@
+#!/bin/bash
+
+# Cenário de soak com consumidores lentos
+#
+#   bench/soak.sh                       # 20 remetentes, 5 clientes que não leem, 5 min
+#   SENDERS=40 SLOW=10 DURATION=1800 bench/soak.sh
+#   CHAT_HEARTBEAT_INTERVAL=10 bench/soak.sh   # Variáveis CHAT_* seguem para o servidor
+#
+# Sobe ./server isolado em loopback e, enquanto SENDERS conexões do
+# bench/loadgen conversam, mantém SLOW clientes autenticados que nunca leem o
+# socket. Grava duas séries temporais no diretório de saída:
+#   servidor.tsv  a cada SAMPLE s: RSS, threads, fds, clientes e profundidade das filas
+#   latencia.tsv  a cada janela de INTERVAL s: latência de entrega nos clientes saudáveis
+# e imprime um resumo ao final.
+
+set -u
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+PORT=8080
+
+SENDERS=${SENDERS:-20}
+RATE=${RATE:-200}
+SLOW=${SLOW:-5}
+DURATION=${DURATION:-300}
+INTERVAL=${INTERVAL:-10}
+SAMPLE=${SAMPLE:-1}
+METRICS_PORT=${METRICS_PORT:-9100}
+OUT_DIR=${OUT_DIR:-$ROOT/bench/soak-$(date +%Y%m%d-%H%M%S)}
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+BLUE='\033[0;34m'
+NC='\033[0m'
+
+print_info() {
+    echo -e "${YELLOW}[INFO]${NC} $1"
+}
+
+print_error() {
+    echo -e "${RED}[ERRO]${NC} $1"
+}
+
+print_success() {
+    echo -e "${GREEN}[SUCESSO]${NC} $1"
+}
+
+server_pid=""
+sampler_pid=""
+work_dir=""
+slow_fds=()
+
+cleanup() {
+    [[ -n "$sampler_pid" ]] && kill "$sampler_pid" 2>/dev/null
+    for fd in "${slow_fds[@]}"; do
+        exec {fd}>&-
+    done
+    if [[ -n "$server_pid" ]]; then
+        kill -INT "$server_pid" 2>/dev/null
+        wait "$server_pid" 2>/dev/null
+    fi
+    [[ -n "$work_dir" ]] && rm -rf "$work_dir"
+}
+trap cleanup EXIT
+trap 'exit 130' INT TERM
+
+port_in_use() {
+    (exec 3<>"/dev/tcp/127.0.0.1/$1") 2>/dev/null
+}
+
+start_server() {
+    for port in "$PORT" "$METRICS_PORT"; do
+        if port_in_use "$port"; then
+            print_error "Porta $port já está em uso; pare o servidor em execução"
+            exit 2
+        fi
+    done
+
+    work_dir=$(mktemp -d)
+    (cd "$work_dir" &&
+        CHAT_FILTER_FILE="$ROOT/filter_words.txt" CHAT_METRICS_PORT="$METRICS_PORT" \
+        CHAT_RATE_BROADCAST=0 CHAT_ADMISSION_RATE=0 CHAT_ADMISSION_MAX_PER_IP=0 \
+        exec "$ROOT/server" > server.out 2>&1) &
+    server_pid=$!
+
+    for _ in {1..50}; do
+        port_in_use "$PORT" && return 0
+        sleep 0.1
+    done
+    print_error "Servidor não respondeu na porta $PORT"
+    exit 2
+}
+
+# Lê /metrics pelo próprio bash, sem depender de curl
+fetch_metrics() {
+    local fd
+    exec {fd}<>"/dev/tcp/127.0.0.1/$METRICS_PORT" 2>/dev/null || return 1
+    printf 'GET /metrics HTTP/1.0\r\n\r\n' >&"$fd"
+    timeout 2 cat <&"$fd"
+    exec {fd}>&-
+}
+
+metric_value() {
+    awk -v name="$1" '$1 == name { print $2; found = 1 } END { if (!found) print "-" }'
+}
+
+proc_status() {
+    awk -v key="$1:" '$1 == key { print $2 }' "/proc/$server_pid/status" 2>/dev/null
+}
+
+sample_server() {
+    local started=$1
+    echo -e "t_s\trss_kb\tthreads\tfds\tclientes\tautenticados\tfila_moderacao\tfila_broadcast\tenviadas\tdescartes_envio"
+    while kill -0 "$server_pid" 2>/dev/null; do
+        local metrics
+        metrics=$(fetch_metrics)
+        local fds
+        fds=$(ls "/proc/$server_pid/fd" 2>/dev/null | wc -l)
+        echo -e "$(($(date +%s) - started))\t$(proc_status VmRSS)\t$(proc_status Threads)\t$fds\t$(
+            echo "$metrics" | metric_value 'chat_clients{state="connected"}')\t$(
+            echo "$metrics" | metric_value 'chat_clients{state="authenticated"}')\t$(
+            echo "$metrics" | metric_value 'chat_queue_depth{queue="moderation"}')\t$(
+            echo "$metrics" | metric_value 'chat_queue_depth{queue="broadcast"}')\t$(
+            echo "$metrics" | metric_value chat_messages_sent_total)\t$(
+            echo "$metrics" | metric_value 'chat_messages_dropped_total{reason="send_error"}')"
+        sleep "$SAMPLE"
+    done
+}
+
+# Autentica e nunca lê: o buffer do socket enche e o servidor passa a
+# bloquear (ou descartar) nos envios para ele
+open_slow_clients() {
+    for ((i = 0; i < SLOW; i++)); do
+        local fd
+        if ! exec {fd}<>"/dev/tcp/127.0.0.1/$PORT"; then
+            print_error "Falha ao conectar o cliente lento $i"
+            continue
+        fi
+        printf '/auth chat123\n' >&"$fd"
+        slow_fds+=("$fd")
+    done
+    print_info "${#slow_fds[@]} clientes lentos conectados (não leem nada)"
+}
+
+json_field() {
+    sed -n "s/.*\"$1\":\([0-9.]*\).*/\1/p"
+}
+
+summarize() {
+    echo ""
+    echo -e "${BLUE}=== RESUMO DO SOAK ===${NC}"
+    awk -F'\t' 'NR == 2 { first = $2 }
+        NR > 1 && $2 != "" {
+            last = $2
+            if ($2 > rss) rss = $2
+            if ($3 > threads) threads = $3
+            if ($4 > fds) fds = $4
+            if ($7 != "-" && $7 > qm) qm = $7
+            if ($8 != "-" && $8 > qb) qb = $8
+            if ($10 != "-") drops = $10
+        }
+        END {
+            printf "RSS:             inicial %d kB, final %d kB, pico %d kB\n", first, last, rss
+            printf "Threads/fds:     pico %d threads, %d fds\n", threads, fds
+            printf "Filas:           pico moderação %s, broadcast %s\n", qm + 0, qb + 0
+            printf "Descartes envio: %d\n", drops
+        }' "$OUT_DIR/servidor.tsv"
+    awk -F'\t' 'NR > 1 {
+            windows++
+            if ($3 > p99) { p99 = $3; worst = $1 }
+            if ($6 > loss) loss = $6
+            if (NR == 2) base = $3
+        }
+        END {
+            printf "Latência p99:    primeira janela %.1f µs, pior %.1f µs (t=%s s)\n", base, p99, worst
+            printf "Perda:           pior janela %.3f%% em %d janelas\n", loss * 100, windows
+        }' "$OUT_DIR/latencia.tsv"
+    echo "Séries em $OUT_DIR"
+}
+
+if [[ "${1:-}" == "-h" ]] || [[ "${1:-}" == "--help" ]]; then
+    sed -n '3,14p' "$0" | sed 's/^# \{0,1\}//'
+    echo ""
+    echo "Variáveis: SENDERS=$SENDERS RATE=$RATE SLOW=$SLOW DURATION=$DURATION INTERVAL=$INTERVAL"
+    echo "           SAMPLE=$SAMPLE METRICS_PORT=$METRICS_PORT OUT_DIR=<bench/soak-data-hora>"
+    exit 0
+fi
+
+make -C "$ROOT" -s server bench/loadgen || exit 2
+mkdir -p "$OUT_DIR" || exit 2
+
+print_info "Soak: $SENDERS remetentes a $RATE msg/s, $SLOW clientes lentos, ${DURATION}s em janelas de ${INTERVAL}s"
+start_server
+started=$(date +%s)
+sample_server "$started" > "$OUT_DIR/servidor.tsv" &
+sampler_pid=$!
+
+# A primeira janela roda sem clientes lentos, como referência
+echo -e "t_s\tp50_us\tp99_us\tp999_us\tmax_us\tperda\tentregas_s\terros\tlentos" > "$OUT_DIR/latencia.tsv"
+window=0
+while (($(date +%s) - started < DURATION)); do
+    if ((window == 1)); then
+        open_slow_clients
+    fi
+
+    if ! kill -0 "$server_pid" 2>/dev/null; then
+        print_error "Servidor terminou durante o soak"
+        exit 1
+    fi
+
+    json=$("$ROOT/bench/loadgen" -p "$PORT" -c "$SENDERS" -r "$RATE" -d "$INTERVAL" -w 0 -j 2>/dev/null)
+    t=$(($(date +%s) - started))
+    if [[ -z "$json" ]]; then
+        echo -e "$t\t-\t-\t-\t-\t1\t0\t-\t${#slow_fds[@]}" >> "$OUT_DIR/latencia.tsv"
+        print_error "t=${t}s: janela sem resultado do loadgen"
+    else
+        p99=$(echo "$json" | json_field p99)
+        loss=$(echo "$json" | json_field loss)
+        echo -e "$t\t$(echo "$json" | json_field p50)\t$p99\t$(echo "$json" | json_field p999)\t$(
+            echo "$json" | json_field max)\t$loss\t$(echo "$json" | json_field delivery_rate)\t$(
+            echo "$json" | json_field total)\t${#slow_fds[@]}" >> "$OUT_DIR/latencia.tsv"
+        print_info "t=${t}s: p99 ${p99} µs, perda $loss, RSS $(proc_status VmRSS) kB, threads $(proc_status Threads)"
+    fi
+    window=$((window + 1))
+done
+
+summarize
+print_success "Soak concluído"
@@ -0,0 +1,234 @@
+#include "capture.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#define VARINT_MAX_SIZE 10
+#define RECORD_OVERHEAD (1 + 3 * VARINT_MAX_SIZE + 4)
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static size_t put_varint(char *out, uint64_t value)
+{
+    size_t length = 0;
+    while (value >= 0x80)
+    {
+        out[length++] = (char)(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (char)value;
+    return length;
+}
+
+static size_t get_varint(const char *buffer, size_t available, uint64_t *value)
+{
+    uint64_t result = 0;
+    for (size_t i = 0; i < available && i < VARINT_MAX_SIZE; i++)
+    {
+        uint8_t byte = (uint8_t)buffer[i];
+        result |= (uint64_t)(byte & 0x7F) << (7 * i);
+        if (!(byte & 0x80))
+        {
+            *value = result;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+// Chamada com o mutex: escreve o buffer inteiro no arquivo
+static void flush_locked(TrafficCapture *capture)
+{
+    size_t offset = 0;
+    while (offset < capture->used)
+    {
+        ssize_t written = write(capture->fd, capture->buffer + offset, capture->used - offset);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+        {
+            atomic_fetch_add_explicit(&capture->write_errors, 1, memory_order_relaxed);
+            break;
+        }
+        offset += (size_t)written;
+    }
+    atomic_fetch_add_explicit(&capture->bytes, offset, memory_order_relaxed);
+    capture->used = 0;
+}
+
+static void append_record(TrafficCapture *capture, CaptureRecordType type, uint32_t connection,
+                          uint32_t ip, const char *line, size_t length)
+{
+    char header[RECORD_OVERHEAD];
+
+    pthread_mutex_lock(&capture->mutex);
+    if (!atomic_load_explicit(&capture->enabled, memory_order_relaxed))
+    {
+        pthread_mutex_unlock(&capture->mutex); // capture_close já passou
+        return;
+    }
+
+    // O instante é tomado sob o mutex para os intervalos nunca serem negativos
+    uint64_t now = monotonic_ns();
+    size_t header_length = 0;
+    header[header_length++] = (char)type;
+    header_length += put_varint(header + header_length, (now - capture->last_ns) / 1000);
+    header_length += put_varint(header + header_length, connection);
+    if (type == CAPTURE_OPEN)
+    {
+        memcpy(header + header_length, &ip, sizeof(ip));
+        header_length += sizeof(ip);
+    }
+    else if (type == CAPTURE_LINE)
+    {
+        header_length += put_varint(header + header_length, length);
+    }
+
+    // Avança o relógio só pelos µs já gravados, para não acumular arredondamento
+    capture->last_ns += (now - capture->last_ns) / 1000 * 1000;
+
+    if (capture->used + header_length + length > sizeof(capture->buffer))
+        flush_locked(capture);
+    memcpy(capture->buffer + capture->used, header, header_length);
+    capture->used += header_length;
+    if (length > 0)
+    {
+        memcpy(capture->buffer + capture->used, line, length);
+        capture->used += length;
+    }
+
+    pthread_mutex_unlock(&capture->mutex);
+}
+
+int capture_open(TrafficCapture *capture, const char *path)
+{
+    memset(capture, 0, sizeof(*capture));
+    capture->fd = -1;
+    atomic_store(&capture->next_connection, 1);
+    if (!path || !path[0])
+        return 0;
+
+    capture->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (capture->fd < 0)
+        return -1;
+
+    pthread_mutex_init(&capture->mutex, NULL);
+    capture->last_ns = monotonic_ns();
+
+    struct timespec wall;
+    clock_gettime(CLOCK_REALTIME, &wall);
+    uint64_t started_ns = (uint64_t)wall.tv_sec * 1000000000ULL + (uint64_t)wall.tv_nsec;
+    memcpy(capture->buffer, CAPTURE_MAGIC, CAPTURE_MAGIC_SIZE);
+    memcpy(capture->buffer + CAPTURE_MAGIC_SIZE, &started_ns, sizeof(started_ns));
+    capture->used = CAPTURE_HEADER_SIZE;
+
+    atomic_store(&capture->enabled, true);
+    return 0;
+}
+
+uint32_t capture_connection_open(TrafficCapture *capture, uint32_t ip)
+{
+    if (!atomic_load_explicit(&capture->enabled, memory_order_relaxed))
+        return 0;
+
+    uint32_t connection = (uint32_t)atomic_fetch_add_explicit(&capture->next_connection, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&capture->connections, 1, memory_order_relaxed);
+    append_record(capture, CAPTURE_OPEN, connection, ip, NULL, 0);
+    return connection;
+}
+
+void capture_line(TrafficCapture *capture, uint32_t connection, const char *line, size_t length)
+{
+    if (!atomic_load_explicit(&capture->enabled, memory_order_relaxed) || connection == 0)
+        return;
+
+    if (length > CAPTURE_MAX_LINE)
+        length = CAPTURE_MAX_LINE;
+    atomic_fetch_add_explicit(&capture->lines, 1, memory_order_relaxed);
+    append_record(capture, CAPTURE_LINE, connection, 0, line, length);
+}
+
+void capture_connection_close(TrafficCapture *capture, uint32_t connection)
+{
+    if (!atomic_load_explicit(&capture->enabled, memory_order_relaxed) || connection == 0)
+        return;
+
+    append_record(capture, CAPTURE_CLOSE, connection, 0, NULL, 0);
+}
+
+void capture_close(TrafficCapture *capture)
+{
+    if (!atomic_load_explicit(&capture->enabled, memory_order_relaxed))
+        return;
+
+    // O mutex fica vivo: threads de clientes ainda podem chamar e verão a flag
+    pthread_mutex_lock(&capture->mutex);
+    flush_locked(capture);
+    atomic_store(&capture->enabled, false);
+    close(capture->fd);
+    capture->fd = -1;
+    pthread_mutex_unlock(&capture->mutex);
+}
+
+int capture_read_header(const char *buffer, size_t available, uint64_t *started_ns)
+{
+    if (!buffer || available < CAPTURE_HEADER_SIZE || memcmp(buffer, CAPTURE_MAGIC, CAPTURE_MAGIC_SIZE) != 0)
+        return -1;
+
+    if (started_ns)
+        memcpy(started_ns, buffer + CAPTURE_MAGIC_SIZE, sizeof(*started_ns));
+    return 0;
+}
+
+size_t capture_read_record(const char *buffer, size_t available, CaptureRecord *record)
+{
+    if (!buffer || available < 3)
+        return 0;
+
+    uint8_t type = (uint8_t)buffer[0];
+    if (type < CAPTURE_OPEN || type > CAPTURE_CLOSE)
+        return 0;
+
+    size_t offset = 1;
+    uint64_t delta_us, connection;
+    size_t used = get_varint(buffer + offset, available - offset, &delta_us);
+    if (used == 0)
+        return 0;
+    offset += used;
+    used = get_varint(buffer + offset, available - offset, &connection);
+    if (used == 0 || connection == 0 || connection > UINT32_MAX)
+        return 0;
+    offset += used;
+
+    CaptureRecord parsed = {.type = (CaptureRecordType)type, .delta_us = delta_us,
+                            .connection = (uint32_t)connection};
+    if (type == CAPTURE_OPEN)
+    {
+        if (available - offset < sizeof(parsed.ip))
+            return 0;
+        memcpy(&parsed.ip, buffer + offset, sizeof(parsed.ip));
+        offset += sizeof(parsed.ip);
+    }
+    else if (type == CAPTURE_LINE)
+    {
+        uint64_t length;
+        used = get_varint(buffer + offset, available - offset, &length);
+        if (used == 0 || length > CAPTURE_MAX_LINE || length > available - offset - used)
+            return 0;
+        offset += used;
+        parsed.data = buffer + offset;
+        parsed.length = (size_t)length;
+        offset += (size_t)length;
+    }
+
+    if (record)
+        *record = parsed;
+    return offset;
+}
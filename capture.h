@@ -0,0 +1,71 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define CAPTURE_MAGIC "CHATCAP1"
+#define CAPTURE_MAGIC_SIZE 8
+#define CAPTURE_HEADER_SIZE (CAPTURE_MAGIC_SIZE + 8) // magic + início (ns desde a época)
+#define CAPTURE_BUFFER_SIZE (64 * 1024)
+#define CAPTURE_MAX_LINE (16 * 1024) // Bem menor que o buffer: um registro sempre cabe
+
+// Registro: tipo (1 byte) e varints com o intervalo em µs desde o registro
+// anterior e o id da conexão; OPEN traz o IPv4 (4 bytes, ordem de rede) e
+// LINE traz o tamanho (varint) e os bytes da linha, sem o '\n'.
+typedef enum
+{
+    CAPTURE_OPEN = 1,
+    CAPTURE_LINE = 2,
+    CAPTURE_CLOSE = 3
+} CaptureRecordType;
+
+typedef struct
+{
+    CaptureRecordType type;
+    uint64_t delta_us;
+    uint32_t connection;
+    uint32_t ip; // Só em OPEN
+    const char *data; // Só em LINE
+    size_t length;
+} CaptureRecord;
+
+// Registros vão para um buffer sob mutex e saem num write quando ele enche
+// (ou no capture_close). Desligada, cada chamada custa um teste de flag.
+typedef struct
+{
+    atomic_bool enabled;
+    int fd;
+    pthread_mutex_t mutex;
+    char buffer[CAPTURE_BUFFER_SIZE];
+    size_t used;
+    uint64_t last_ns;
+
+    atomic_uint_fast32_t next_connection;
+    atomic_uint_fast64_t connections;
+    atomic_uint_fast64_t lines;
+    atomic_uint_fast64_t bytes; // Gravados no arquivo
+    atomic_uint_fast64_t write_errors;
+} TrafficCapture;
+
+// path NULL ou vazio deixa a captura desligada (retorna 0). Trunca o arquivo.
+int capture_open(TrafficCapture *capture, const char *path);
+
+// Retorna o id da nova conexão na captura; 0 com a captura desligada
+uint32_t capture_connection_open(TrafficCapture *capture, uint32_t ip);
+void capture_line(TrafficCapture *capture, uint32_t connection, const char *line, size_t length);
+void capture_connection_close(TrafficCapture *capture, uint32_t connection);
+
+// Grava o que estiver pendente e fecha o arquivo
+void capture_close(TrafficCapture *capture);
+
+// Leitura (bench/replay). Retorna 0 se o cabeçalho é válido e preenche o início.
+int capture_read_header(const char *buffer, size_t available, uint64_t *started_ns);
+
+// Retorna o tamanho do registro, 0 se não há registro completo e válido
+size_t capture_read_record(const char *buffer, size_t available, CaptureRecord *record);
+
+#endif
@@ -38,14 +38,34 @@ void signal_handler(int sig)
     exit(0);
 }
 
+// Responde aos pings de heartbeat do servidor e os remove do que será exibido.
+// line_start diz se buffer começa no início de uma linha.
+static void answer_heartbeats(char *buffer, int line_start)
+{
+    char *ping = buffer;
+    while ((ping = strstr(ping, "/ping\n")) != NULL)
+    {
+        if (ping == buffer ? !line_start : ping[-1] != '\n')
+        {
+            ping++;
+            continue;
+        }
+
+        send(sock, "/pong\n", 6, MSG_NOSIGNAL);
+        memmove(ping, ping + 6, strlen(ping + 6) + 1);
+    }
+}
+
 void *receive_messages(void *arg)
 {
     char buffer[BUFFER_SIZE];
+    size_t pending = 0;     // Começo de um possível /ping guardado do recv anterior
+    int line_start = 1;     // O que já foi exibido terminou em '\n'
     int bytes;
 
     while (client_running && sock >= 0)
     {
-        bytes = recv(sock, buffer, sizeof(buffer) - 1, 0);
+        bytes = recv(sock, buffer + pending, sizeof(buffer) - 1 - pending, 0);
 
         if (bytes <= 0)
         {
@@ -61,15 +81,39 @@ void *receive_messages(void *arg)
             break;
         }
 
-        buffer[bytes] = '\0';
+        buffer[pending + (size_t)bytes] = '\0';
 
-        printf("\r\033[K%s", buffer);
+        // O que sobrou do recv anterior sempre começa uma linha
+        answer_heartbeats(buffer, line_start || pending > 0);
 
-        if (client_running)
+        // Um final de linha que ainda pode virar "/ping\n" espera o próximo recv
+        char *tail = strrchr(buffer, '\n');
+        tail = tail ? tail + 1 : buffer;
+        size_t tail_length = strlen(tail);
+        int tail_at_line_start = tail != buffer || line_start || pending > 0;
+        char saved[sizeof("/ping")];
+        pending = 0;
+        if (tail_at_line_start && tail_length > 0 && tail_length < sizeof(saved) &&
+            strncmp(tail, "/ping", tail_length) == 0)
         {
-            printf("> ");
-            fflush(stdout);
+            pending = tail_length;
+            memcpy(saved, tail, pending);
+            *tail = '\0';
         }
+
+        if (buffer[0] != '\0')
+        {
+            line_start = buffer[strlen(buffer) - 1] == '\n';
+            printf("\r\033[K%s", buffer);
+
+            if (client_running)
+            {
+                printf("> ");
+                fflush(stdout);
+            }
+        }
+
+        memcpy(buffer, saved, pending);
     }
 
     return NULL;
@@ -154,7 +198,16 @@ int send_message(const char *message)
         return -1;
     }
 
-    ssize_t bytes_sent = send(sock, message, strlen(message), MSG_NOSIGNAL);
+    // O servidor separa as mensagens por linha
+    char line[BUFFER_SIZE + 1];
+    int length = snprintf(line, sizeof(line), "%s\n", message);
+    if (length >= (int)sizeof(line))
+    {
+        length = sizeof(line) - 1;
+        line[length - 1] = '\n';
+    }
+
+    ssize_t bytes_sent = send(sock, line, (size_t)length, MSG_NOSIGNAL);
     if (bytes_sent < 0)
     {
         if (errno == EPIPE || errno == ECONNRESET)
@@ -1,5 +1,8 @@
 #include "client_manager.h"
 #include "tslog.h"
+#include "metrics.h"
+#include "probes.h"
+#include "flight_recorder.h"
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -9,6 +12,120 @@
 
 #define DEFAULT_PASSWORD "chat123"
 
+static uint32_t name_hash(const char *name)
+{
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++)
+    {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// As funções *_locked assumem manager->mutex já adquirido
+static int find_username_locked(ClientManager *manager, const char *username)
+{
+    uint32_t slot = name_hash(username) & (USERNAME_INDEX_SIZE - 1);
+    while (manager->username_index[slot] != -1)
+    {
+        int index = manager->username_index[slot];
+        if (strcmp(manager->clients[index].username, username) == 0)
+            return index;
+        slot = (slot + 1) & (USERNAME_INDEX_SIZE - 1);
+    }
+    return -1;
+}
+
+static void index_username_locked(ClientManager *manager, int client_index)
+{
+    uint32_t slot = name_hash(manager->clients[client_index].username) & (USERNAME_INDEX_SIZE - 1);
+    while (manager->username_index[slot] != -1)
+        slot = (slot + 1) & (USERNAME_INDEX_SIZE - 1);
+    manager->username_index[slot] = (int16_t)client_index;
+}
+
+// Sondagem linear sem marcadores de remoção: depois de liberar o slot, os
+// elementos seguintes do mesmo agrupamento são reinseridos
+static void unindex_username_locked(ClientManager *manager, int client_index)
+{
+    uint32_t mask = USERNAME_INDEX_SIZE - 1;
+    uint32_t slot = name_hash(manager->clients[client_index].username) & mask;
+    while (manager->username_index[slot] != client_index)
+    {
+        if (manager->username_index[slot] == -1)
+            return;
+        slot = (slot + 1) & mask;
+    }
+
+    manager->username_index[slot] = -1;
+    for (slot = (slot + 1) & mask; manager->username_index[slot] != -1; slot = (slot + 1) & mask)
+    {
+        int moved = manager->username_index[slot];
+        manager->username_index[slot] = -1;
+        index_username_locked(manager, moved);
+    }
+}
+
+static int find_room_locked(ClientManager *manager, const char *name)
+{
+    uint32_t slot = name_hash(name) & (ROOM_INDEX_SIZE - 1);
+    while (manager->room_index[slot] != -1)
+    {
+        int id = manager->room_index[slot];
+        if (strcmp(manager->rooms[id].name, name) == 0)
+            return id;
+        slot = (slot + 1) & (ROOM_INDEX_SIZE - 1);
+    }
+    return -1;
+}
+
+static int create_room_locked(ClientManager *manager, const char *name)
+{
+    if (manager->room_count >= MAX_ROOMS)
+        return -1;
+
+    int id = manager->room_count++;
+    ChatRoom *room = &manager->rooms[id];
+    strncpy(room->name, name, MAX_ROOM_NAME_SIZE - 1);
+    room->name[MAX_ROOM_NAME_SIZE - 1] = '\0';
+    room->member_count = 0;
+
+    uint32_t slot = name_hash(room->name) & (ROOM_INDEX_SIZE - 1);
+    while (manager->room_index[slot] != -1)
+        slot = (slot + 1) & (ROOM_INDEX_SIZE - 1);
+    manager->room_index[slot] = (int16_t)id;
+
+    TSLOG_INFO(TSLOG_CAT_MANAGER, "Sala criada: %s (id=%d)", room->name, id);
+    return id;
+}
+
+static void room_add_member_locked(ClientManager *manager, int room_id, int client_index)
+{
+    ChatRoom *room = &manager->rooms[room_id];
+    ClientInfo *client = &manager->clients[client_index];
+
+    client->room_id = room_id;
+    client->room_slot = room->member_count;
+    room->members[room->member_count++] = client_index;
+}
+
+// Remoção O(1): o último membro ocupa a posição liberada
+static void room_remove_member_locked(ClientManager *manager, int client_index)
+{
+    ClientInfo *client = &manager->clients[client_index];
+    if (client->room_id < 0)
+        return;
+
+    ChatRoom *room = &manager->rooms[client->room_id];
+    int last = room->members[--room->member_count];
+    room->members[client->room_slot] = last;
+    manager->clients[last].room_slot = client->room_slot;
+
+    client->room_id = -1;
+    client->room_slot = -1;
+}
+
 int client_manager_init(ClientManager *manager)
 {
     if (!manager)
@@ -16,6 +133,7 @@ int client_manager_init(ClientManager *manager)
 
     manager->count = 0;
     manager->max_clients = MAX_CLIENTS;
+    manager->next_connection_id = 0;
     memset(manager->clients, 0, sizeof(manager->clients));
 
     if (pthread_mutex_init(&manager->mutex, NULL) != 0)
@@ -36,6 +154,13 @@ int client_manager_init(ClientManager *manager)
         return -1;
     }
 
+    manager->room_count = 0;
+    for (int i = 0; i < ROOM_INDEX_SIZE; i++)
+        manager->room_index[i] = -1;
+    for (int i = 0; i < USERNAME_INDEX_SIZE; i++)
+        manager->username_index[i] = -1;
+    create_room_locked(manager, DEFAULT_ROOM_NAME);
+
     return 0;
 }
 
@@ -80,17 +205,18 @@ int client_manager_add(ClientManager *manager, int socket_fd, const char *userna
             manager->clients[i].connect_time = time(NULL);
             manager->clients[i].last_activity = time(NULL);
             manager->clients[i].thread_id = pthread_self();
+            manager->clients[i].room_id = -1;
+            manager->clients[i].room_slot = -1;
+            manager->clients[i].connection_id = ++manager->next_connection_id;
+            index_username_locked(manager, i);
 
             manager->count++;
 
             pthread_cond_signal(&manager->client_connected);
 
-            char log_msg[256];
-            snprintf(log_msg, sizeof(log_msg),
-                     "Cliente adicionado: %s (%s:%d) socket=%d",
-                     manager->clients[i].username, ip_address ? ip_address : "unknown",
-                     port, socket_fd);
-            tslog_write(log_msg);
+            TSLOG_INFO(TSLOG_CAT_MANAGER, "Cliente adicionado: %s (%s:%d) socket=%d",
+                       manager->clients[i].username, ip_address ? ip_address : "unknown",
+                       port, socket_fd);
 
             break;
         }
@@ -111,12 +237,11 @@ int client_manager_remove(ClientManager *manager, int socket_fd)
     {
         if (manager->clients[i].socket_fd == socket_fd)
         {
-            char log_msg[256];
-            snprintf(log_msg, sizeof(log_msg),
-                     "Cliente removido: %s (socket=%d)",
-                     manager->clients[i].username, socket_fd);
-            tslog_write(log_msg);
+            TSLOG_INFO(TSLOG_CAT_MANAGER, "Cliente removido: %s (socket=%d)",
+                       manager->clients[i].username, socket_fd);
 
+            room_remove_member_locked(manager, i);
+            unindex_username_locked(manager, i);
             memset(&manager->clients[i], 0, sizeof(ClientInfo));
             manager->count--;
 
@@ -157,17 +282,8 @@ ClientInfo *client_manager_find_by_username(ClientManager *manager, const char *
 
     pthread_mutex_lock(&manager->mutex);
 
-    ClientInfo *result = NULL;
-    for (int i = 0; i < MAX_CLIENTS; i++)
-    {
-        if (manager->clients[i].socket_fd != 0 &&
-            manager->clients[i].active &&
-            strcmp(manager->clients[i].username, username) == 0)
-        {
-            result = &manager->clients[i];
-            break;
-        }
-    }
+    int index = find_username_locked(manager, username);
+    ClientInfo *result = index >= 0 && manager->clients[index].active ? &manager->clients[index] : NULL;
 
     pthread_mutex_unlock(&manager->mutex);
     return result;
@@ -187,20 +303,16 @@ int client_manager_authenticate(ClientManager *manager, int socket_fd, const cha
         {
             if (strcmp(password, DEFAULT_PASSWORD) == 0)
             {
+                if (!manager->clients[i].authenticated)
+                    room_add_member_locked(manager, DEFAULT_ROOM_ID, i);
                 manager->clients[i].authenticated = true;
                 result = 0;
 
-                char log_msg[256];
-                snprintf(log_msg, sizeof(log_msg),
-                         "Cliente autenticado: %s", manager->clients[i].username);
-                tslog_write(log_msg);
+                TSLOG_INFO(TSLOG_CAT_AUTH, "Cliente autenticado: %s", manager->clients[i].username);
             }
             else
             {
-                char log_msg[256];
-                snprintf(log_msg, sizeof(log_msg),
-                         "Falha na autenticação: %s", manager->clients[i].username);
-                tslog_write(log_msg);
+                TSLOG_WARN(TSLOG_CAT_AUTH, "Falha na autenticação: %s", manager->clients[i].username);
             }
             break;
         }
@@ -270,21 +382,38 @@ bool client_manager_username_exists(ClientManager *manager, const char *username
         return false;
 
     pthread_mutex_lock(&manager->mutex);
+    bool exists = find_username_locked(manager, username) >= 0;
+    pthread_mutex_unlock(&manager->mutex);
 
-    bool exists = false;
-    for (int i = 0; i < MAX_CLIENTS; i++)
+    return exists;
+}
+
+int client_manager_rename(ClientManager *manager, int socket_fd, const char *new_username)
+{
+    if (!manager || socket_fd < 0 || !new_username)
+        return -1;
+
+    pthread_mutex_lock(&manager->mutex);
+
+    int result = -1;
+    if (find_username_locked(manager, new_username) < 0)
     {
-        if (manager->clients[i].socket_fd != 0 &&
-            manager->clients[i].active &&
-            strcmp(manager->clients[i].username, username) == 0)
+        for (int i = 0; i < MAX_CLIENTS; i++)
         {
-            exists = true;
-            break;
+            if (manager->clients[i].socket_fd == socket_fd)
+            {
+                unindex_username_locked(manager, i);
+                strncpy(manager->clients[i].username, new_username, MAX_USERNAME_SIZE - 1);
+                manager->clients[i].username[MAX_USERNAME_SIZE - 1] = '\0';
+                index_username_locked(manager, i);
+                result = 0;
+                break;
+            }
         }
     }
 
     pthread_mutex_unlock(&manager->mutex);
-    return exists;
+    return result;
 }
 
 void client_manager_update_activity(ClientManager *manager, int socket_fd)
@@ -379,43 +508,179 @@ int client_manager_broadcast(ClientManager *manager, const char *message, int se
     return sent_count;
 }
 
-int client_manager_send_private(ClientManager *manager, const char *from_user,
-                                const char *to_user, const char *message)
+int client_manager_broadcast_room(ClientManager *manager, int room_id, const char *message, int sender_fd)
 {
-    if (!manager || !from_user || !to_user || !message)
+    if (!manager || !message)
         return -1;
 
     pthread_mutex_lock(&manager->mutex);
 
-    int result = -1;
-    ClientInfo *target = NULL;
+    if (room_id < 0 || room_id >= manager->room_count)
+    {
+        pthread_mutex_unlock(&manager->mutex);
+        return -1;
+    }
 
+    ChatRoom *room = &manager->rooms[room_id];
+    size_t length = strlen(message);
+    int sent_count = 0;
+    CHAT_PROBE3(broadcast_start, room_id, length, room->member_count);
+    for (int i = 0; i < room->member_count; i++)
+    {
+        int fd = manager->clients[room->members[i]].socket_fd;
+        if (fd == sender_fd)
+            continue;
+
+        ssize_t sent = send(fd, message, length, MSG_NOSIGNAL);
+        CHAT_PROBE2(broadcast_send, fd, sent);
+        if (sent > 0)
+        {
+            sent_count++;
+            metrics_inc(METRIC_MESSAGES_OUT);
+            metrics_add(METRIC_BYTES_OUT, (uint64_t)sent);
+        }
+        else
+        {
+            metrics_inc(METRIC_DROPS_SEND);
+            flight_record(FLIGHT_SEND_ERROR, fd, (uint64_t)errno, 0);
+        }
+    }
+    CHAT_PROBE2(broadcast_end, room_id, sent_count);
+    flight_record(FLIGHT_BROADCAST, sender_fd, (uint64_t)room_id, (uint64_t)sent_count);
+
+    pthread_mutex_unlock(&manager->mutex);
+    return sent_count;
+}
+
+int client_manager_join_room(ClientManager *manager, int socket_fd, const char *room_name)
+{
+    if (!manager || socket_fd < 0 || !room_name || !room_name[0])
+        return -1;
+
+    pthread_mutex_lock(&manager->mutex);
+
+    int result = -1;
     for (int i = 0; i < MAX_CLIENTS; i++)
     {
-        if (manager->clients[i].socket_fd != 0 &&
-            manager->clients[i].active &&
-            manager->clients[i].authenticated &&
-            strcmp(manager->clients[i].username, to_user) == 0)
+        if (manager->clients[i].socket_fd == socket_fd)
         {
-            target = &manager->clients[i];
+            if (!manager->clients[i].authenticated)
+                break;
+
+            int room_id = find_room_locked(manager, room_name);
+            if (room_id < 0)
+                room_id = create_room_locked(manager, room_name);
+            if (room_id < 0)
+            {
+                TSLOG_WARN(TSLOG_CAT_MANAGER, "Limite de salas atingido (%d)", MAX_ROOMS);
+                break;
+            }
+
+            if (manager->clients[i].room_id != room_id)
+            {
+                room_remove_member_locked(manager, i);
+                room_add_member_locked(manager, room_id, i);
+            }
+            result = room_id;
             break;
         }
     }
 
-    if (target)
+    pthread_mutex_unlock(&manager->mutex);
+    return result;
+}
+
+int client_manager_find_room(ClientManager *manager, const char *room_name)
+{
+    if (!manager || !room_name)
+        return -1;
+
+    pthread_mutex_lock(&manager->mutex);
+    int room_id = find_room_locked(manager, room_name);
+    pthread_mutex_unlock(&manager->mutex);
+
+    return room_id;
+}
+
+int client_manager_get_or_create_room(ClientManager *manager, const char *room_name)
+{
+    if (!manager || !room_name || !room_name[0])
+        return -1;
+
+    pthread_mutex_lock(&manager->mutex);
+    int room_id = find_room_locked(manager, room_name);
+    if (room_id < 0)
+        room_id = create_room_locked(manager, room_name);
+    pthread_mutex_unlock(&manager->mutex);
+
+    return room_id;
+}
+
+const char *client_manager_room_name(ClientManager *manager, int room_id)
+{
+    if (!manager || room_id < 0 || room_id >= MAX_ROOMS)
+        return NULL;
+
+    pthread_mutex_lock(&manager->mutex);
+    const char *name = room_id < manager->room_count ? manager->rooms[room_id].name : NULL;
+    pthread_mutex_unlock(&manager->mutex);
+
+    return name;
+}
+
+int client_manager_send_private(ClientManager *manager, const char *from_user,
+                                const char *to_user, const char *message)
+{
+    if (!manager || !from_user || !to_user || !message)
+        return -1;
+
+    char private_msg[1024];
+    int length = snprintf(private_msg, sizeof(private_msg),
+                          "[PRIVADA de %s]: %s\n", from_user, message);
+    if (length >= (int)sizeof(private_msg))
+        length = sizeof(private_msg) - 1;
+
+    pthread_mutex_lock(&manager->mutex);
+
+    int result = -1;
+    int index = find_username_locked(manager, to_user);
+    if (index >= 0 && manager->clients[index].active && manager->clients[index].authenticated &&
+        send(manager->clients[index].socket_fd, private_msg, (size_t)length, MSG_NOSIGNAL) > 0)
+    {
+        result = 0;
+    }
+
+    pthread_mutex_unlock(&manager->mutex);
+
+    if (result == 0)
     {
-        char private_msg[1024];
-        snprintf(private_msg, sizeof(private_msg),
-                 "[PRIVADA de %s]: %s\n", from_user, message);
+        metrics_inc(METRIC_MESSAGES_OUT);
+        metrics_add(METRIC_BYTES_OUT, (uint64_t)length);
+        TSLOG_DEBUG(TSLOG_CAT_BROADCAST, "Mensagem privada: %s -> %s", from_user, to_user);
+    }
 
-        if (send(target->socket_fd, private_msg, strlen(private_msg), MSG_NOSIGNAL) > 0)
-        {
-            result = 0;
+    return result;
+}
+
+int client_manager_send_to(ClientManager *manager, int socket_fd, uint64_t connection_id,
+                           const char *message)
+{
+    if (!manager || socket_fd <= 0 || !message)
+        return -1;
 
-            char log_msg[512];
-            snprintf(log_msg, sizeof(log_msg),
-                     "Mensagem privada: %s -> %s", from_user, to_user);
-            tslog_write(log_msg);
+    size_t length = strlen(message);
+
+    pthread_mutex_lock(&manager->mutex);
+
+    int result = -1;
+    for (int i = 0; i < MAX_CLIENTS; i++)
+    {
+        if (manager->clients[i].socket_fd == socket_fd)
+        {
+            if (manager->clients[i].connection_id == connection_id &&
+                send(socket_fd, message, length, MSG_NOSIGNAL) > 0)
+                result = 0;
+            break;
         }
     }
 
@@ -447,5 +712,5 @@ void client_manager_destroy(ClientManager *manager)
     pthread_cond_destroy(&manager->client_connected);
     pthread_mutex_destroy(&manager->mutex);
 
-    tslog_write("Client manager destruído");
+    TSLOG_INFO(TSLOG_CAT_MANAGER, "Client manager destruído");
 }
\ No newline at end of file
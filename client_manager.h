@@ -3,6 +3,7 @@
 
 #include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <time.h>
 #include <netinet/in.h>
 
@@ -10,6 +11,13 @@
 #define MAX_USERNAME_SIZE 50
 #define MAX_PASSWORD_SIZE 64
 
+#define MAX_ROOMS 64
+#define MAX_ROOM_NAME_SIZE 32
+#define ROOM_INDEX_SIZE 128 // Potência de 2, ao menos 2x MAX_ROOMS
+#define DEFAULT_ROOM_ID 0
+#define DEFAULT_ROOM_NAME "geral"
+#define USERNAME_INDEX_SIZE 256 // Potência de 2, ao menos 2x MAX_CLIENTS
+
 typedef struct
 {
     int socket_fd;
@@ -21,8 +29,19 @@ typedef struct
     time_t connect_time;
     time_t last_activity;
     pthread_t thread_id;
+    int room_id;   // -1 enquanto não autenticado
+    int room_slot; // Posição em rooms[room_id].members
+    uint64_t connection_id; // Único na vida do processo, ao contrário do fd
 } ClientInfo;
 
+// Salas nunca são removidas: o id (índice em rooms[]) vale pela vida do processo
+typedef struct
+{
+    char name[MAX_ROOM_NAME_SIZE];
+    int members[MAX_CLIENTS]; // Índices em clients[]
+    int member_count;
+} ChatRoom;
+
 typedef struct
 {
     ClientInfo clients[MAX_CLIENTS];
@@ -31,6 +50,12 @@ typedef struct
     pthread_mutex_t mutex;
     pthread_cond_t slot_available;
     pthread_cond_t client_connected;
+
+    ChatRoom rooms[MAX_ROOMS];
+    int room_count;
+    int16_t room_index[ROOM_INDEX_SIZE]; // Hash do nome -> id (-1 = vazio)
+    int16_t username_index[USERNAME_INDEX_SIZE]; // Hash do username -> índice em clients[]
+    uint64_t next_connection_id;
 } ClientManager;
 
 int client_manager_init(ClientManager *manager);
@@ -54,6 +79,9 @@ int client_manager_get_authenticated_clients(ClientManager *manager, int *socket
 
 bool client_manager_username_exists(ClientManager *manager, const char *username);
 
+// Troca o nome atomicamente; -1 se o novo nome já estiver em uso
+int client_manager_rename(ClientManager *manager, int socket_fd, const char *new_username);
+
 void client_manager_update_activity(ClientManager *manager, int socket_fd);
 
 bool client_manager_has_available_slots(ClientManager *manager);
@@ -63,9 +91,25 @@ int client_manager_get_authenticated_count(ClientManager *manager);
 
 int client_manager_broadcast(ClientManager *manager, const char *message, int sender_fd);
 
+int client_manager_broadcast_room(ClientManager *manager, int room_id, const char *message, int sender_fd);
+
+// Move o cliente para a sala (criada se não existir). Retorna o id da sala ou -1
+int client_manager_join_room(ClientManager *manager, int socket_fd, const char *room_name);
+
+int client_manager_find_room(ClientManager *manager, const char *room_name);
+
+// Retorna o id da sala, criando-a se necessário (-1 se o limite foi atingido)
+int client_manager_get_or_create_room(ClientManager *manager, const char *room_name);
+
+const char *client_manager_room_name(ClientManager *manager, int room_id);
+
 int client_manager_send_private(ClientManager *manager, const char *from_user,
                                 const char *to_user, const char *message);
 
+// Envia só se o fd ainda pertence à mesma conexão; -1 se ela já saiu
+int client_manager_send_to(ClientManager *manager, int socket_fd, uint64_t connection_id,
+                           const char *message);
+
 void client_manager_destroy(ClientManager *manager);
 
 #endif
\ No newline at end of file
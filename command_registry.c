@@ -0,0 +1,141 @@
+#include "command_registry.h"
+#include "tslog.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SEED_ATTEMPTS 4096
+
+static uint32_t hash_name(const char *name, size_t length, uint32_t seed)
+{
+    uint32_t h = 2166136261u ^ seed;
+    for (size_t i = 0; i < length; i++)
+    {
+        h ^= (unsigned char)name[i];
+        h *= 16777619u;
+    }
+    h ^= h >> 15;
+    h *= 0x2c1b3c6du;
+    h ^= h >> 12;
+    return h;
+}
+
+static int slot_of(const CommandRegistry *registry, const char *name, size_t length)
+{
+    uint32_t h = hash_name(name, length, registry->seed);
+    return (int)(h >> (32 - registry->table_bits));
+}
+
+int command_registry_init(CommandRegistry *registry)
+{
+    if (!registry)
+        return -1;
+
+    memset(registry, 0, sizeof(*registry));
+    return 0;
+}
+
+int command_registry_register(CommandRegistry *registry, CommandSpec *spec)
+{
+    if (!registry || !spec || !spec->name || !spec->handler || registry->slots ||
+        registry->count >= COMMAND_MAX_COMMANDS)
+        return -1;
+
+    for (int i = 0; i < registry->count; i++)
+    {
+        if (strcmp(registry->commands[i]->name, spec->name) == 0)
+            return -1;
+    }
+
+    atomic_init(&spec->calls, 0);
+    latency_histogram_init(&spec->latency);
+    registry->commands[registry->count++] = spec;
+    return 0;
+}
+
+static bool try_seed(CommandRegistry *registry, int16_t *slots, size_t table_size)
+{
+    for (size_t i = 0; i < table_size; i++)
+        slots[i] = -1;
+
+    for (int c = 0; c < registry->count; c++)
+    {
+        const char *name = registry->commands[c]->name;
+        int slot = slot_of(registry, name, strlen(name));
+        if (slots[slot] != -1)
+            return false;
+        slots[slot] = (int16_t)c;
+    }
+    return true;
+}
+
+int command_registry_build(CommandRegistry *registry)
+{
+    if (!registry || registry->slots)
+        return -1;
+
+    // Começa com uma tabela ~2x maior que o número de comandos e cresce se
+    // nenhuma semente produzir um hash sem colisões
+    int bits = 1;
+    while ((1 << bits) < registry->count * 2)
+        bits++;
+
+    for (; bits <= COMMAND_MAX_TABLE_BITS; bits++)
+    {
+        size_t table_size = (size_t)1 << bits;
+        int16_t *slots = malloc(table_size * sizeof(int16_t));
+        if (!slots)
+            return -1;
+
+        registry->table_bits = bits;
+        for (uint32_t seed = 0; seed < SEED_ATTEMPTS; seed++)
+        {
+            registry->seed = seed;
+            if (try_seed(registry, slots, table_size))
+            {
+                registry->slots = slots;
+                TSLOG_DEBUG(TSLOG_CAT_GENERAL, "Tabela de comandos: %d comandos, %zu slots, semente %u",
+                            registry->count, table_size, seed);
+                return 0;
+            }
+        }
+        free(slots);
+    }
+
+    return -1;
+}
+
+CommandSpec *command_registry_lookup(const CommandRegistry *registry, const char *name, size_t length)
+{
+    if (!registry || !registry->slots || !name)
+        return NULL;
+
+    int index = registry->slots[slot_of(registry, name, length)];
+    if (index < 0)
+        return NULL;
+
+    CommandSpec *spec = registry->commands[index];
+    if (strncmp(spec->name, name, length) != 0 || spec->name[length] != '\0')
+        return NULL;
+
+    return spec;
+}
+
+int command_registry_execute(CommandSpec *spec, int client_sock, ClientInfo *client, char *args)
+{
+    uint64_t start = latency_now_ns();
+    int result = spec->handler(client_sock, client, args);
+
+    atomic_fetch_add_explicit(&spec->calls, 1, memory_order_relaxed);
+    latency_histogram_record(&spec->latency, latency_now_ns() - start);
+    return result;
+}
+
+void command_registry_destroy(CommandRegistry *registry)
+{
+    if (!registry)
+        return;
+
+    free(registry->slots);
+    registry->slots = NULL;
+    registry->count = 0;
+}
@@ -0,0 +1,57 @@
+#ifndef COMMAND_REGISTRY_H
+#define COMMAND_REGISTRY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "client_manager.h"
+#include "latency_histogram.h"
+
+#define COMMAND_MAX_COMMANDS 32
+#define COMMAND_MAX_TABLE_BITS 10
+
+// Retorna 1 se tratou o comando, -1 para desconectar o cliente e
+// 0 se os argumentos não correspondem ao comando (não reconhecido)
+typedef int (*CommandHandler)(int client_sock, ClientInfo *client, char *args);
+
+typedef struct
+{
+    const char *name;        // "/auth"
+    const char *usage;       // "/auth <senha>" (exibido no /help)
+    const char *description;
+    CommandHandler handler;
+    bool takes_args;         // "/nome <args>" ou apenas "/nome"
+    bool optional_args;      // Aceita as duas formas
+    bool requires_auth;
+
+    atomic_uint_fast64_t calls;
+    LatencyHistogram latency;
+} CommandSpec;
+
+// Hash perfeito sobre os nomes registrados: a semente e o tamanho da tabela são
+// escolhidos em command_registry_build() para que não haja nenhuma colisão, então
+// cada busca custa um hash e uma única comparação de string.
+typedef struct
+{
+    CommandSpec *commands[COMMAND_MAX_COMMANDS];
+    int count;
+    uint32_t seed;
+    int table_bits;
+    int16_t *slots;
+} CommandRegistry;
+
+int command_registry_init(CommandRegistry *registry);
+
+int command_registry_register(CommandRegistry *registry, CommandSpec *spec);
+
+int command_registry_build(CommandRegistry *registry);
+
+CommandSpec *command_registry_lookup(const CommandRegistry *registry, const char *name, size_t length);
+
+// Executa o handler registrando contagem de chamadas e latência
+int command_registry_execute(CommandSpec *spec, int client_sock, ClientInfo *client, char *args);
+
+void command_registry_destroy(CommandRegistry *registry);
+
+#endif
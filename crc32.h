@@ -0,0 +1,10 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-32 (IEEE 802.3). Para encadear, passe o resultado anterior em crc (0 no início).
+uint32_t crc32_update(uint32_t crc, const void *data, size_t length);
+
+#endif
@@ -0,0 +1,251 @@
+#include "flight_recorder.h"
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#define DUMP_BUFFER_SIZE 4096
+
+static const char *event_names[FLIGHT_EVENT_COUNT] = {
+    "accept", "reject", "auth", "ingest", "enqueue", "dequeue",
+    "broadcast", "send_error", "disconnect", "error",
+};
+
+static const int fatal_signals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+static FlightRing *_Atomic rings[FLIGHT_MAX_THREADS];
+_Thread_local FlightRing *flight_local_ring;
+
+static pthread_mutex_t claim_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+
+static char dump_path[PATH_MAX] = FLIGHT_DEFAULT_PATH;
+static atomic_flag dumping = ATOMIC_FLAG_INIT;
+
+// Par de referência (ticks, ns) tomado na inicialização; o dump toma outro e
+// interpola, sem precisar calibrar o TSC com espera
+static uint64_t base_ticks;
+static uint64_t base_ns;
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void release_ring(void *value)
+{
+    FlightRing *ring = value;
+    atomic_store_explicit(&ring->in_use, 0, memory_order_release);
+}
+
+static void create_ring_key(void)
+{
+    pthread_key_create(&ring_key, release_ring);
+}
+
+// Anéis nunca são liberados: os eventos de threads que já terminaram continuam
+// no dump até outra thread reaproveitar o anel.
+FlightRing *flight_claim_ring(void)
+{
+    pthread_once(&ring_key_once, create_ring_key);
+    pthread_mutex_lock(&claim_mutex);
+
+    FlightRing *claimed = NULL;
+    for (int i = 0; i < FLIGHT_MAX_THREADS && !claimed; i++)
+    {
+        FlightRing *ring = atomic_load(&rings[i]);
+        if (!ring)
+        {
+            ring = calloc(1, sizeof(FlightRing));
+            if (!ring)
+                break;
+            atomic_store(&rings[i], ring);
+        }
+
+        if (!atomic_load(&ring->in_use))
+        {
+            atomic_store(&ring->in_use, 1);
+            atomic_store(&ring->owner_tid, (int)syscall(SYS_gettid));
+            claimed = ring;
+        }
+    }
+
+    pthread_mutex_unlock(&claim_mutex);
+
+    if (claimed)
+    {
+        pthread_setspecific(ring_key, claimed);
+        flight_local_ring = claimed;
+    }
+    return claimed;
+}
+
+// Escrita do dump só com funções seguras em tratador de sinal
+typedef struct
+{
+    int fd;
+    size_t length;
+    char data[DUMP_BUFFER_SIZE];
+} DumpWriter;
+
+static void writer_flush(DumpWriter *writer)
+{
+    size_t offset = 0;
+    while (offset < writer->length)
+    {
+        ssize_t written = write(writer->fd, writer->data + offset, writer->length - offset);
+        if (written <= 0)
+            break;
+        offset += (size_t)written;
+    }
+    writer->length = 0;
+}
+
+static void writer_str(DumpWriter *writer, const char *text)
+{
+    for (; *text; text++)
+    {
+        if (writer->length == sizeof(writer->data))
+            writer_flush(writer);
+        writer->data[writer->length++] = *text;
+    }
+}
+
+static void writer_u64(DumpWriter *writer, uint64_t value)
+{
+    char digits[21];
+    int position = sizeof(digits) - 1;
+    digits[position] = '\0';
+    do
+    {
+        digits[--position] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    writer_str(writer, digits + position);
+}
+
+static void writer_i64(DumpWriter *writer, int64_t value)
+{
+    if (value < 0)
+    {
+        writer_str(writer, "-");
+        writer_u64(writer, (uint64_t)0 - (uint64_t)value);
+    }
+    else
+    {
+        writer_u64(writer, (uint64_t)value);
+    }
+}
+
+int flight_recorder_dump(int signal_number)
+{
+    if (atomic_flag_test_and_set(&dumping))
+        return -1;
+
+    int fd = open(dump_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        atomic_flag_clear(&dumping);
+        return -1;
+    }
+
+    uint64_t now_ticks = flight_ticks();
+    uint64_t now_ns = monotonic_ns();
+    double ns_per_tick = now_ticks > base_ticks ? (double)(now_ns - base_ns) / (double)(now_ticks - base_ticks) : 1.0;
+
+    DumpWriter writer = {.fd = fd, .length = 0};
+    writer_str(&writer, "# flight recorder: sinal ");
+    writer_i64(&writer, signal_number);
+    writer_str(&writer, ", instante ");
+    writer_u64(&writer, now_ns);
+    writer_str(&writer, " ns (CLOCK_MONOTONIC)\n# ns tid evento fd a b\n");
+
+    for (int i = 0; i < FLIGHT_MAX_THREADS; i++)
+    {
+        FlightRing *ring = atomic_load_explicit(&rings[i], memory_order_acquire);
+        if (!ring)
+            break;
+
+        uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        uint64_t count = head < FLIGHT_RING_EVENTS ? head : FLIGHT_RING_EVENTS;
+        int tid = atomic_load_explicit(&ring->owner_tid, memory_order_relaxed);
+
+        for (uint64_t n = head - count; n < head; n++)
+        {
+            const FlightEvent *event = &ring->events[n & (FLIGHT_RING_EVENTS - 1)];
+            int64_t delta = (int64_t)(event->ticks - base_ticks);
+            uint64_t ns = base_ns + (uint64_t)(int64_t)((double)delta * ns_per_tick);
+
+            writer_u64(&writer, ns);
+            writer_str(&writer, " ");
+            writer_i64(&writer, tid);
+            writer_str(&writer, " ");
+            writer_str(&writer, event->type < FLIGHT_EVENT_COUNT ? event_names[event->type] : "?");
+            writer_str(&writer, " ");
+            writer_i64(&writer, event->fd);
+            writer_str(&writer, " ");
+            writer_u64(&writer, event->a);
+            writer_str(&writer, " ");
+            writer_u64(&writer, event->b);
+            writer_str(&writer, "\n");
+        }
+    }
+
+    writer_flush(&writer);
+    fsync(fd);
+    close(fd);
+
+    atomic_flag_clear(&dumping);
+    return 0;
+}
+
+static void dump_signal_handler(int sig)
+{
+    int saved_errno = errno;
+    flight_recorder_dump(sig);
+    errno = saved_errno;
+}
+
+static void fatal_signal_handler(int sig)
+{
+    flight_recorder_dump(sig);
+    // SA_RESETHAND já restaurou a ação padrão: o processo termina como terminaria
+    raise(sig);
+}
+
+int flight_recorder_init(const char *path)
+{
+    if (path && path[0])
+    {
+        strncpy(dump_path, path, sizeof(dump_path) - 1);
+        dump_path[sizeof(dump_path) - 1] = '\0';
+    }
+
+    base_ticks = flight_ticks();
+    base_ns = monotonic_ns();
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    sigemptyset(&action.sa_mask);
+    action.sa_handler = dump_signal_handler;
+    action.sa_flags = SA_RESTART;
+    if (sigaction(SIGUSR1, &action, NULL) != 0)
+        return -1;
+
+    action.sa_handler = fatal_signal_handler;
+    action.sa_flags = SA_RESETHAND;
+    for (size_t i = 0; i < sizeof(fatal_signals) / sizeof(fatal_signals[0]); i++)
+    {
+        if (sigaction(fatal_signals[i], &action, NULL) != 0)
+            return -1;
+    }
+    return 0;
+}
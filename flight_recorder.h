@@ -0,0 +1,83 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#define FLIGHT_DEFAULT_PATH "flight.dump"
+#define FLIGHT_RING_EVENTS 1024 // Por thread (potência de 2)
+#define FLIGHT_MAX_THREADS 256
+
+typedef enum
+{
+    FLIGHT_ACCEPT,     // fd, ip
+    FLIGHT_REJECT,     // fd, ip, motivo
+    FLIGHT_AUTH,       // fd, ok
+    FLIGHT_INGEST,     // fd, bytes
+    FLIGHT_ENQUEUE,    // fila, tamanho
+    FLIGHT_DEQUEUE,    // fila, tamanho
+    FLIGHT_BROADCAST,  // sala, enviados
+    FLIGHT_SEND_ERROR, // fd, errno
+    FLIGHT_DISCONNECT, // fd, motivo (0 normal, 1 sem autenticação, 2 inatividade, 3 sem resposta ao ping)
+    FLIGHT_ERROR,      // fd, errno
+    FLIGHT_EVENT_COUNT
+} FlightEventType;
+
+typedef struct
+{
+    uint64_t ticks; // TSC (x86-64) ou ns monotônicos; convertido na gravação do dump
+    uint32_t type;
+    int32_t fd;
+    uint64_t a;
+    uint64_t b;
+} FlightEvent;
+
+// Um anel por thread: só a dona escreve, então gravar é um punhado de stores.
+// Quem lê é o tratador de sinal, sem sincronizar; um evento pode sair rasgado.
+typedef struct
+{
+    atomic_uint_fast64_t head; // Total de eventos já gravados
+    atomic_int owner_tid;
+    atomic_int in_use;
+    FlightEvent events[FLIGHT_RING_EVENTS];
+} FlightRing;
+
+extern _Thread_local FlightRing *flight_local_ring;
+FlightRing *flight_claim_ring(void);
+
+static inline uint64_t flight_ticks(void)
+{
+#if defined(__x86_64__)
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static inline void flight_record(FlightEventType type, int fd, uint64_t a, uint64_t b)
+{
+    FlightRing *ring = flight_local_ring;
+    if (!ring && !(ring = flight_claim_ring()))
+        return;
+
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    FlightEvent *event = &ring->events[head & (FLIGHT_RING_EVENTS - 1)];
+    event->ticks = flight_ticks();
+    event->type = type;
+    event->fd = fd;
+    event->a = a;
+    event->b = b;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+// Instala os tratadores: SIGUSR1 grava o dump e segue; SIGSEGV, SIGBUS,
+// SIGFPE, SIGILL e SIGABRT gravam e então deixam o sinal seguir seu curso.
+int flight_recorder_init(const char *path);
+
+// Grava o dump agora. Seguro para chamar de dentro de um tratador de sinal.
+int flight_recorder_dump(int signal_number);
+
+#endif
@@ -0,0 +1,610 @@
+#define _GNU_SOURCE
+#include "journal.h"
+#include "tslog.h"
+#include "crc32.h"
+#include "flight_recorder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define JOURNAL_PUNCH_ALIGN 4096
+
+static uint32_t record_crc(const JournalRecordHeader *header, const char *room, const char *data)
+{
+    uint32_t crc = crc32_update(0, &header->timestamp,
+                                sizeof(*header) - offsetof(JournalRecordHeader, timestamp));
+    crc = crc32_update(crc, room, header->room_length);
+    return crc32_update(crc, data, header->data_length);
+}
+
+size_t journal_read_record(const char *buffer, size_t available, uint64_t offset, JournalRecord *record)
+{
+    JournalRecordHeader header;
+    if (!buffer || available < sizeof(header))
+        return 0;
+
+    memcpy(&header, buffer, sizeof(header));
+    size_t total = sizeof(header) + header.room_length + (size_t)header.data_length;
+    if (header.magic != JOURNAL_MAGIC || total > JOURNAL_MAX_RECORD_SIZE || total > available)
+        return 0;
+
+    const char *room = buffer + sizeof(header);
+    const char *data = room + header.room_length;
+    if (record_crc(&header, room, data) != header.crc)
+        return 0;
+
+    if (record)
+    {
+        record->timestamp = header.timestamp;
+        record->room = room;
+        record->room_length = header.room_length;
+        record->data = data;
+        record->length = header.data_length;
+        record->offset = offset;
+    }
+    return total;
+}
+
+static uint32_t checkpoint_crc(const JournalCheckpoint *checkpoint)
+{
+    return crc32_update(0, &checkpoint->replay_offset,
+                        sizeof(*checkpoint) - offsetof(JournalCheckpoint, replay_offset));
+}
+
+// Checkpoint que não confere com o arquivo (journal apagado ou trocado) é ignorado
+static bool read_checkpoint(const char *path, uint64_t size, JournalCheckpoint *checkpoint)
+{
+    memset(checkpoint, 0, sizeof(*checkpoint));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    JournalCheckpoint stored;
+    bool valid = read(fd, &stored, sizeof(stored)) == (ssize_t)sizeof(stored) &&
+                 stored.magic == JOURNAL_CHECKPOINT_MAGIC && stored.crc == checkpoint_crc(&stored) &&
+                 stored.first_offset <= stored.replay_offset && stored.replay_offset <= size;
+    close(fd);
+
+    if (!valid)
+    {
+        TSLOG_WARN(TSLOG_CAT_GENERAL, "Checkpoint %s inválido; journal lido do início", path);
+        return false;
+    }
+
+    *checkpoint = stored;
+    return true;
+}
+
+static int write_all(int fd, const char *data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t written = write(fd, data, length);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+    return 0;
+}
+
+// O rename só vale depois do fsync do diretório: sem ele uma queda pode
+// trazer de volta um checkpoint anterior a buracos já abertos no journal
+static int sync_parent_dir(const char *path)
+{
+    char dir[PATH_MAX];
+    const char *slash = strrchr(path, '/');
+    if (!slash)
+        strcpy(dir, ".");
+    else if (slash == path)
+        strcpy(dir, "/");
+    else
+        snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path), path);
+
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+        return -1;
+
+    int result = fsync(fd);
+    close(fd);
+    return result;
+}
+
+static int write_checkpoint(const char *path, uint64_t replay_offset, uint64_t first_offset)
+{
+    JournalCheckpoint checkpoint = {.magic = JOURNAL_CHECKPOINT_MAGIC,
+                                    .replay_offset = replay_offset,
+                                    .first_offset = first_offset};
+    checkpoint.crc = checkpoint_crc(&checkpoint);
+
+    char tmp_path[PATH_MAX + 16];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+
+    int result = write_all(fd, (const char *)&checkpoint, sizeof(checkpoint));
+    if (result == 0)
+        result = fdatasync(fd);
+    close(fd);
+
+    if (result == 0)
+        result = rename(tmp_path, path);
+    if (result != 0)
+    {
+        unlink(tmp_path);
+        return result;
+    }
+    return sync_parent_dir(path);
+}
+
+// Próximo registro válido depois de bytes que não formam um (zeros de um
+// buraco, registro rasgado); size se não houver mais nenhum
+static size_t find_next_record(const char *map, size_t map_start, size_t offset, size_t size)
+{
+    const uint32_t magic = JOURNAL_MAGIC;
+    while (offset < size)
+    {
+        const char *found = memmem(map + (offset - map_start), size - offset, &magic, sizeof(magic));
+        if (!found)
+            return size;
+
+        offset = map_start + (size_t)(found - map);
+        if (journal_read_record(found, size - offset, offset, NULL) > 0)
+            return offset;
+        offset++;
+    }
+    return size;
+}
+
+int journal_recover(const char *path, JournalReplayFn fn, void *ctx)
+{
+    int fd = open(path, O_RDWR);
+    if (fd < 0)
+        return errno == ENOENT ? 0 : -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    char checkpoint_path[PATH_MAX + 8];
+    snprintf(checkpoint_path, sizeof(checkpoint_path), "%s.ckpt", path);
+
+    size_t size = (size_t)st.st_size;
+    JournalCheckpoint checkpoint;
+    bool have_checkpoint = read_checkpoint(checkpoint_path, size, &checkpoint);
+
+    // Sem checkpoint o começo pode ser buraco de uma retenção anterior: pula
+    // direto para os primeiros dados
+    size_t start = (size_t)checkpoint.replay_offset;
+    if (!have_checkpoint)
+    {
+        off_t data = lseek(fd, 0, SEEK_DATA);
+        if (data > 0)
+            start = (size_t)data;
+        else if (data < 0 && errno == ENXIO)
+            start = size;
+    }
+    if (start == size)
+    {
+        close(fd);
+        return 0;
+    }
+
+    // O mapeamento começa numa página; o que vem antes do checkpoint nem é tocado
+    size_t map_start = start & ~((size_t)sysconf(_SC_PAGESIZE) - 1);
+    char *map = mmap(NULL, size - map_start, PROT_READ, MAP_PRIVATE, fd, (off_t)map_start);
+    if (map == MAP_FAILED)
+    {
+        close(fd);
+        return -1;
+    }
+
+    // Bytes inválidos no meio são pulados; só o que vem depois do último
+    // registro válido é tratado como final rasgado
+    int count = 0;
+    size_t offset = start;
+    size_t first_valid = start;
+    size_t valid_end = start;
+    size_t skipped = 0;
+    JournalRecord record;
+    while (offset < size)
+    {
+        size_t length = journal_read_record(map + (offset - map_start), size - offset, offset, &record);
+        if (length == 0)
+        {
+            size_t next = find_next_record(map, map_start, offset + 1, size);
+            if (next == size)
+                break;
+            skipped += next - offset;
+            offset = next;
+            continue;
+        }
+
+        if (count == 0)
+            first_valid = offset;
+        if (fn)
+            fn(&record, ctx);
+        offset += length;
+        valid_end = offset;
+        count++;
+    }
+
+    munmap(map, size - map_start);
+
+    if (skipped > 0)
+        TSLOG_WARN(TSLOG_CAT_GENERAL, "Journal %s: %zu bytes inválidos ou liberados ignorados", path, skipped);
+
+    if (valid_end < size)
+    {
+        TSLOG_WARN(TSLOG_CAT_GENERAL, "Journal %s: %zu bytes inválidos no fim descartados (offset %zu)",
+                   path, size - valid_end, valid_end);
+        if (ftruncate(fd, (off_t)valid_end) != 0)
+        {
+            close(fd);
+            return -1;
+        }
+    }
+
+    // Checkpoint ausente ou anterior a um buraco (rename perdido numa queda):
+    // o que vem antes do primeiro registro lido não existe mais
+    size_t resume = count > 0 ? first_valid : valid_end;
+    if (resume != checkpoint.replay_offset && write_checkpoint(checkpoint_path, resume, resume) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    close(fd);
+    TSLOG_INFO(TSLOG_CAT_GENERAL, "Journal %s: %d registros recuperados a partir do offset %zu",
+               path, count, resume);
+    return count;
+}
+
+// Um lote entra inteiro ou não entra: a cada falha o arquivo volta para
+// durable_offset e o lote é regravado, para que os offsets já entregues por
+// journal_append continuem batendo com o arquivo. Se não houver jeito o
+// journal para de aceitar registros.
+static void flush_batch(Journal *journal, const char *data, size_t length)
+{
+    if (atomic_load_explicit(&journal->failed, memory_order_relaxed))
+        return;
+
+    uint64_t started = latency_now_ns();
+    uint64_t durable = atomic_load_explicit(&journal->durable_offset, memory_order_relaxed);
+
+    for (int attempt = 1; write_all(journal->fd, data, length) != 0 || fdatasync(journal->fd) != 0; attempt++)
+    {
+        int error = errno;
+        flight_record(FLIGHT_ERROR, journal->fd, (uint64_t)error, length);
+        atomic_fetch_add_explicit(&journal->write_errors, 1, memory_order_relaxed);
+        TSLOG_ERROR(TSLOG_CAT_GENERAL, "Falha ao gravar journal (%zu bytes, tentativa %d): %s",
+                    length, attempt, strerror(error));
+
+        if (ftruncate(journal->fd, (off_t)durable) != 0 || attempt == JOURNAL_WRITE_ATTEMPTS)
+        {
+            atomic_store_explicit(&journal->failed, true, memory_order_relaxed);
+            TSLOG_ERROR(TSLOG_CAT_GENERAL, "Journal %s desativado em %llu bytes; novas mensagens não serão gravadas",
+                        journal->path, (unsigned long long)durable);
+            return;
+        }
+        usleep(JOURNAL_RETRY_DELAY_MS * 1000);
+    }
+
+    latency_histogram_record(&journal->flush_latency, latency_now_ns() - started);
+    atomic_fetch_add_explicit(&journal->flushes, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&journal->durable_offset, length, memory_order_release);
+}
+
+static void add_mark(Journal *journal, uint64_t offset)
+{
+    if (journal->mark_count > 0 && journal->marks[journal->mark_count - 1] >= offset)
+        return;
+
+    if (journal->mark_count == JOURNAL_MAX_MARKS)
+    {
+        memmove(journal->marks, journal->marks + 1, (JOURNAL_MAX_MARKS - 1) * sizeof(journal->marks[0]));
+        journal->mark_count--;
+    }
+    journal->marks[journal->mark_count++] = offset;
+}
+
+// Grava onde a próxima inicialização começa e libera o que passou da retenção.
+// Os limites só caem em marcas (fim de um lote), que são fronteiras de registro.
+static void take_checkpoint(Journal *journal)
+{
+    uint64_t durable = atomic_load_explicit(&journal->durable_offset, memory_order_acquire);
+    add_mark(journal, durable);
+    journal->last_checkpoint = durable;
+
+    uint64_t replay = atomic_load_explicit(&journal->replay_offset, memory_order_relaxed);
+    if (replay > durable)
+        replay = durable;
+
+    // Uma sala parada prenderia o começo da releitura para sempre
+    for (int i = 0; replay + JOURNAL_MAX_REPLAY_BYTES < durable && i < journal->mark_count; i++)
+    {
+        if (journal->marks[i] > replay && journal->marks[i] + JOURNAL_MAX_REPLAY_BYTES >= durable)
+            replay = journal->marks[i];
+    }
+
+    uint64_t first = atomic_load_explicit(&journal->first_offset, memory_order_relaxed);
+    uint64_t new_first = first;
+    for (int i = journal->mark_count - 1; journal->retain_bytes > 0 && i >= 0; i--)
+    {
+        if (journal->marks[i] + journal->retain_bytes <= durable)
+        {
+            new_first = journal->marks[i] < replay ? journal->marks[i] : replay;
+            break;
+        }
+    }
+    if (new_first < first)
+        new_first = first;
+
+    // O checkpoint vai antes do buraco: a recuperação nunca começa em bytes zerados
+    if (write_checkpoint(journal->checkpoint_path, replay, new_first) != 0)
+    {
+        TSLOG_WARN(TSLOG_CAT_GENERAL, "Falha ao gravar checkpoint %s: %s",
+                   journal->checkpoint_path, strerror(errno));
+        return;
+    }
+    if (new_first == first)
+        return;
+
+    atomic_store_explicit(&journal->first_offset, new_first, memory_order_relaxed);
+
+    int drop = 0;
+    while (drop < journal->mark_count && journal->marks[drop] < new_first)
+        drop++;
+    memmove(journal->marks, journal->marks + drop, (size_t)(journal->mark_count - drop) * sizeof(journal->marks[0]));
+    journal->mark_count -= drop;
+
+    off_t punch_from = (off_t)(first & ~(uint64_t)(JOURNAL_PUNCH_ALIGN - 1));
+    off_t punch_to = (off_t)(new_first & ~(uint64_t)(JOURNAL_PUNCH_ALIGN - 1));
+    if (journal->punch_unsupported || punch_to <= punch_from)
+        return;
+
+    if (fallocate(journal->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, punch_from, punch_to - punch_from) != 0)
+    {
+        journal->punch_unsupported = true;
+        TSLOG_WARN(TSLOG_CAT_GENERAL, "Journal %s: sistema de arquivos não libera o início (%s); uso de disco não será limitado",
+                   journal->path, strerror(errno));
+        return;
+    }
+
+    TSLOG_INFO(TSLOG_CAT_GENERAL, "Journal %s: %llu bytes iniciais liberados, releitura a partir de %llu",
+               journal->path, (unsigned long long)new_first, (unsigned long long)replay);
+}
+
+static void *flush_worker(void *arg)
+{
+    Journal *journal = arg;
+
+    pthread_mutex_lock(&journal->mutex);
+    while (journal->running || journal->used > 0)
+    {
+        if (journal->used == 0)
+        {
+            pthread_cond_wait(&journal->data_ready, &journal->mutex);
+            continue;
+        }
+
+        uint64_t deadline = journal->batch_started_ns + journal->flush_interval_ns;
+        if (journal->running && journal->used < journal->flush_bytes && latency_now_ns() < deadline)
+        {
+            struct timespec ts = {.tv_sec = (time_t)(deadline / 1000000000ULL),
+                                  .tv_nsec = (long)(deadline % 1000000000ULL)};
+            pthread_cond_timedwait(&journal->data_ready, &journal->mutex, &ts);
+            continue;
+        }
+
+        // Troca os buffers: novos appends seguem no outro enquanto este é gravado
+        char *batch = journal->buffers[journal->active];
+        size_t length = journal->used;
+        journal->active ^= 1;
+        journal->used = 0;
+
+        pthread_mutex_unlock(&journal->mutex);
+        flush_batch(journal, batch, length);
+        if (atomic_load_explicit(&journal->durable_offset, memory_order_relaxed) - journal->last_checkpoint >=
+            journal->checkpoint_interval)
+            take_checkpoint(journal);
+        pthread_mutex_lock(&journal->mutex);
+
+        pthread_cond_broadcast(&journal->space_available);
+    }
+    pthread_mutex_unlock(&journal->mutex);
+
+    return NULL;
+}
+
+int journal_open(Journal *journal, const char *path, int flush_interval_ms, size_t flush_bytes,
+                 uint64_t retain_bytes)
+{
+    if (!journal)
+        return -1;
+
+    memset(journal, 0, sizeof(*journal));
+
+    strncpy(journal->path, path ? path : JOURNAL_DEFAULT_PATH, sizeof(journal->path) - 1);
+    journal->flush_interval_ns = (uint64_t)(flush_interval_ms > 0 ? flush_interval_ms : JOURNAL_DEFAULT_FLUSH_MS) *
+                                 1000000ULL;
+    journal->flush_bytes = flush_bytes > 0 ? flush_bytes : JOURNAL_DEFAULT_FLUSH_BYTES;
+    journal->capacity = journal->flush_bytes * 4;
+    if (journal->capacity < JOURNAL_MAX_RECORD_SIZE)
+        journal->capacity = JOURNAL_MAX_RECORD_SIZE;
+    snprintf(journal->checkpoint_path, sizeof(journal->checkpoint_path), "%s.ckpt", journal->path);
+
+    // Metade das marcas cobre a retenção inteira
+    journal->retain_bytes = retain_bytes;
+    journal->checkpoint_interval = JOURNAL_CHECKPOINT_BYTES;
+    if (retain_bytes / (JOURNAL_MAX_MARKS / 2) > journal->checkpoint_interval)
+        journal->checkpoint_interval = retain_bytes / (JOURNAL_MAX_MARKS / 2);
+
+    journal->fd = open(journal->path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (journal->fd < 0)
+        return -1;
+
+    struct stat st;
+    uint64_t size = fstat(journal->fd, &st) == 0 ? (uint64_t)st.st_size : 0;
+    JournalCheckpoint checkpoint;
+    read_checkpoint(journal->checkpoint_path, size, &checkpoint);
+
+    atomic_init(&journal->appended_offset, size);
+    atomic_init(&journal->durable_offset, size);
+    atomic_init(&journal->replay_offset, checkpoint.replay_offset);
+    atomic_init(&journal->first_offset, checkpoint.first_offset);
+    atomic_init(&journal->failed, false);
+    journal->last_checkpoint = size;
+    add_mark(journal, checkpoint.first_offset);
+    add_mark(journal, checkpoint.replay_offset);
+    add_mark(journal, size);
+
+    journal->buffers[0] = malloc(journal->capacity);
+    journal->buffers[1] = malloc(journal->capacity);
+    latency_histogram_init(&journal->flush_latency);
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+    if (!journal->buffers[0] || !journal->buffers[1] ||
+        pthread_mutex_init(&journal->mutex, NULL) != 0 ||
+        pthread_cond_init(&journal->data_ready, &attr) != 0 ||
+        pthread_cond_init(&journal->space_available, NULL) != 0)
+    {
+        pthread_condattr_destroy(&attr);
+        free(journal->buffers[0]);
+        free(journal->buffers[1]);
+        close(journal->fd);
+        return -1;
+    }
+    pthread_condattr_destroy(&attr);
+
+    journal->running = true;
+    if (pthread_create(&journal->thread, NULL, flush_worker, journal) != 0)
+    {
+        journal->running = false;
+        pthread_cond_destroy(&journal->data_ready);
+        pthread_cond_destroy(&journal->space_available);
+        pthread_mutex_destroy(&journal->mutex);
+        free(journal->buffers[0]);
+        free(journal->buffers[1]);
+        close(journal->fd);
+        return -1;
+    }
+
+    TSLOG_INFO(TSLOG_CAT_GENERAL, "Journal %s aberto (flush a cada %d ms ou %zu bytes, retenção %llu bytes)",
+               journal->path, (int)(journal->flush_interval_ns / 1000000ULL), journal->flush_bytes,
+               (unsigned long long)journal->retain_bytes);
+    return 0;
+}
+
+int journal_append(Journal *journal, const char *room, uint64_t timestamp,
+                   const char *data, size_t length, uint64_t *offset)
+{
+    if (!journal || !room || !data)
+        return -1;
+
+    JournalRecordHeader header;
+    header.magic = JOURNAL_MAGIC;
+    header.timestamp = timestamp;
+    header.data_length = (uint32_t)length;
+    header.room_length = (uint16_t)strnlen(room, UINT16_MAX);
+    header.reserved = 0;
+
+    size_t total = sizeof(header) + header.room_length + length;
+    if (total > JOURNAL_MAX_RECORD_SIZE)
+        return -1;
+
+    header.crc = record_crc(&header, room, data);
+
+    pthread_mutex_lock(&journal->mutex);
+
+    while (journal->running && journal->used + total > journal->capacity)
+        pthread_cond_wait(&journal->space_available, &journal->mutex);
+
+    if (!journal->running || atomic_load_explicit(&journal->failed, memory_order_relaxed))
+    {
+        pthread_mutex_unlock(&journal->mutex);
+        return -1;
+    }
+
+    char *dest = journal->buffers[journal->active] + journal->used;
+    memcpy(dest, &header, sizeof(header));
+    memcpy(dest + sizeof(header), room, header.room_length);
+    memcpy(dest + sizeof(header) + header.room_length, data, length);
+
+    if (journal->used == 0)
+    {
+        journal->batch_started_ns = latency_now_ns();
+        pthread_cond_signal(&journal->data_ready);
+    }
+    journal->used += total;
+    if (journal->used >= journal->flush_bytes)
+        pthread_cond_signal(&journal->data_ready);
+
+    uint64_t position = atomic_load_explicit(&journal->appended_offset, memory_order_relaxed);
+    atomic_store_explicit(&journal->appended_offset, position + total, memory_order_relaxed);
+    if (offset)
+        *offset = position;
+
+    pthread_mutex_unlock(&journal->mutex);
+
+    atomic_fetch_add_explicit(&journal->records, 1, memory_order_relaxed);
+    return 0;
+}
+
+void journal_set_replay_offset(Journal *journal, uint64_t offset)
+{
+    if (!journal)
+        return;
+
+    uint64_t appended = atomic_load_explicit(&journal->appended_offset, memory_order_relaxed);
+    atomic_store_explicit(&journal->replay_offset, offset < appended ? offset : appended,
+                          memory_order_relaxed);
+}
+
+void journal_close(Journal *journal)
+{
+    if (!journal || !journal->running)
+        return;
+
+    pthread_mutex_lock(&journal->mutex);
+    journal->running = false;
+    pthread_cond_signal(&journal->data_ready);
+    pthread_cond_broadcast(&journal->space_available);
+    pthread_mutex_unlock(&journal->mutex);
+
+    pthread_join(journal->thread, NULL);
+    take_checkpoint(journal);
+
+    TSLOG_INFO(TSLOG_CAT_GENERAL, "Journal: %llu registros em %llu lotes, flush p50/p99 %llu/%llu ns, %llu erros",
+               (unsigned long long)atomic_load(&journal->records),
+               (unsigned long long)atomic_load(&journal->flushes),
+               (unsigned long long)latency_histogram_percentile(&journal->flush_latency, 0.50),
+               (unsigned long long)latency_histogram_percentile(&journal->flush_latency, 0.99),
+               (unsigned long long)atomic_load(&journal->write_errors));
+
+    close(journal->fd);
+    pthread_cond_destroy(&journal->data_ready);
+    pthread_cond_destroy(&journal->space_available);
+    pthread_mutex_destroy(&journal->mutex);
+    free(journal->buffers[0]);
+    free(journal->buffers[1]);
+    journal->buffers[0] = journal->buffers[1] = NULL;
+}
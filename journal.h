@@ -0,0 +1,131 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <limits.h>
+#include "latency_histogram.h"
+
+#define JOURNAL_DEFAULT_PATH "chat.journal"
+#define JOURNAL_DEFAULT_FLUSH_MS 20
+#define JOURNAL_DEFAULT_FLUSH_BYTES (64 * 1024)
+#define JOURNAL_MAX_RECORD_SIZE (64 * 1024)
+#define JOURNAL_MAGIC 0x4C4E524Au // "JRNL"
+#define JOURNAL_CHECKPOINT_MAGIC 0x54504B43u // "CKPT"
+#define JOURNAL_CHECKPOINT_BYTES (4 * 1024 * 1024) // Intervalo mínimo entre checkpoints
+#define JOURNAL_MAX_REPLAY_BYTES (64 * 1024 * 1024) // Teto do que a inicialização relê
+#define JOURNAL_DEFAULT_RETAIN_BYTES (1024ULL * 1024 * 1024)
+#define JOURNAL_MAX_MARKS 128
+#define JOURNAL_WRITE_ATTEMPTS 3 // Por lote, antes de desativar o journal
+#define JOURNAL_RETRY_DELAY_MS 100
+
+// Registro no arquivo: cabeçalho fixo + nome da sala + bytes da mensagem.
+// O CRC32 cobre tudo a partir de timestamp até o fim da mensagem.
+typedef struct
+{
+    uint32_t magic;
+    uint32_t crc;
+    uint64_t timestamp;
+    uint32_t data_length;
+    uint16_t room_length;
+    uint16_t reserved;
+} JournalRecordHeader;
+
+typedef struct
+{
+    uint64_t timestamp;
+    const char *room;
+    size_t room_length;
+    const char *data;
+    size_t length;
+    uint64_t offset; // Posição do registro no arquivo
+} JournalRecord;
+
+// Arquivo <journal>.ckpt, trocado por rename. Os dois offsets são fronteiras
+// de registro: a recuperação começa em replay_offset e nada antes de
+// first_offset existe mais no disco (virou buraco no arquivo).
+typedef struct
+{
+    uint32_t magic;
+    uint32_t crc;
+    uint64_t replay_offset;
+    uint64_t first_offset;
+} JournalCheckpoint;
+
+typedef void (*JournalReplayFn)(const JournalRecord *record, void *ctx);
+
+// Commit em grupo: journal_append só copia para o buffer ativo; a thread de
+// flush troca os buffers e faz um write + fdatasync quando o lote atinge
+// flush_bytes ou quando o registro mais antigo espera flush_interval_ms.
+// Os offsets nunca mudam (o índice de busca aponta para eles): em vez de
+// rotacionar, o começo que já não é retido é liberado com FALLOC_FL_PUNCH_HOLE.
+typedef struct
+{
+    int fd;
+    char path[PATH_MAX];
+    char checkpoint_path[PATH_MAX + 8];
+
+    char *buffers[2];
+    size_t used;      // Bytes no buffer ativo
+    int active;
+    size_t capacity;  // Por buffer; append espera se o ativo encher
+    size_t flush_bytes;
+    uint64_t flush_interval_ns;
+    uint64_t batch_started_ns;
+
+    bool running;
+    pthread_mutex_t mutex;
+    pthread_cond_t data_ready;
+    pthread_cond_t space_available;
+    pthread_t thread;
+
+    atomic_uint_fast64_t appended_offset; // Fim lógico, incluindo o que ainda está nos buffers
+    atomic_uint_fast64_t durable_offset; // Tudo antes disso já passou por fdatasync
+    atomic_uint_fast64_t replay_offset;  // Registro mais antigo que o histórico ainda usa
+    atomic_uint_fast64_t first_offset;   // Registros antes disso foram descartados
+    atomic_bool failed;                  // Lote não gravado: append passa a falhar
+
+    // Só a thread de flush (ou journal_close, depois dela) mexe nestes
+    uint64_t retain_bytes;       // 0 = guarda tudo
+    uint64_t checkpoint_interval;
+    uint64_t last_checkpoint;    // durable_offset no último checkpoint
+    uint64_t marks[JOURNAL_MAX_MARKS]; // Fronteiras de lote conhecidas, crescentes
+    int mark_count;
+    bool punch_unsupported;
+
+    atomic_uint_fast64_t records;
+    atomic_uint_fast64_t flushes;
+    atomic_uint_fast64_t write_errors;
+    LatencyHistogram flush_latency; // write + fdatasync de cada lote
+} Journal;
+
+// Lê o arquivo a partir do checkpoint (ou do início, se não houver) chamando
+// fn para cada registro válido. Um final corrompido ou incompleto (queda no
+// meio de uma escrita) é truncado.
+// Retorna o número de registros lidos ou -1 em erro de E/S.
+int journal_recover(const char *path, JournalReplayFn fn, void *ctx);
+
+// Lê um registro a partir de offset; usado também por quem acompanha o arquivo.
+// Retorna o tamanho total do registro, 0 se não há registro completo e válido.
+size_t journal_read_record(const char *buffer, size_t available, uint64_t offset, JournalRecord *record);
+
+// retain_bytes limita quanto do fim do arquivo fica no disco (0 = tudo)
+int journal_open(Journal *journal, const char *path, int flush_interval_ms, size_t flush_bytes,
+                 uint64_t retain_bytes);
+
+// offset (opcional) recebe a posição do registro no arquivo. -1 se o registro
+// é grande demais ou se o journal foi desativado por falha de gravação.
+int journal_append(Journal *journal, const char *room, uint64_t timestamp,
+                   const char *data, size_t length, uint64_t *offset);
+
+// Informa o registro mais antigo ainda necessário na inicialização;
+// UINT64_MAX = nenhum. Vai para o disco no próximo checkpoint.
+void journal_set_replay_offset(Journal *journal, uint64_t offset);
+
+// Grava o que estiver pendente e encerra a thread de flush
+void journal_close(Journal *journal);
+
+#endif
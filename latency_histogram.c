@@ -0,0 +1,122 @@
+#include "latency_histogram.h"
+
+static int bucket_index(uint64_t value)
+{
+    if (value < LATENCY_SUB_BUCKETS)
+        return (int)value;
+
+    int exponent = 63 - __builtin_clzll(value);
+    int sub = (int)((value >> (exponent - LATENCY_SUB_BUCKET_BITS)) & (LATENCY_SUB_BUCKETS - 1));
+    return (exponent - LATENCY_SUB_BUCKET_BITS + 1) * LATENCY_SUB_BUCKETS + sub;
+}
+
+static uint64_t bucket_upper_bound(int index)
+{
+    if (index < LATENCY_SUB_BUCKETS)
+        return (uint64_t)index;
+
+    int exponent = index / LATENCY_SUB_BUCKETS + LATENCY_SUB_BUCKET_BITS - 1;
+    uint64_t sub = (uint64_t)(index % LATENCY_SUB_BUCKETS);
+    int shift = exponent - LATENCY_SUB_BUCKET_BITS;
+    uint64_t low = (1ULL << exponent) + (sub << shift);
+    return low + ((1ULL << shift) - 1);
+}
+
+void latency_histogram_init(LatencyHistogram *hist)
+{
+    if (!hist)
+        return;
+
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+        atomic_init(&hist->counts[i], 0);
+    atomic_init(&hist->total, 0);
+    atomic_init(&hist->sum, 0);
+    atomic_init(&hist->max, 0);
+}
+
+void latency_histogram_record(LatencyHistogram *hist, uint64_t value)
+{
+    if (!hist)
+        return;
+
+    atomic_fetch_add_explicit(&hist->counts[bucket_index(value)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->total, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->sum, value, memory_order_relaxed);
+
+    uint64_t current = atomic_load_explicit(&hist->max, memory_order_relaxed);
+    while (value > current &&
+           !atomic_compare_exchange_weak_explicit(&hist->max, &current, value,
+                                                  memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+uint64_t latency_histogram_count(const LatencyHistogram *hist)
+{
+    return hist ? atomic_load_explicit(&hist->total, memory_order_relaxed) : 0;
+}
+
+uint64_t latency_histogram_max(const LatencyHistogram *hist)
+{
+    return hist ? atomic_load_explicit(&hist->max, memory_order_relaxed) : 0;
+}
+
+double latency_histogram_mean(const LatencyHistogram *hist)
+{
+    uint64_t count = latency_histogram_count(hist);
+    if (count == 0)
+        return 0.0;
+    return (double)atomic_load_explicit(&hist->sum, memory_order_relaxed) / (double)count;
+}
+
+uint64_t latency_histogram_percentile(const LatencyHistogram *hist, double q)
+{
+    uint64_t count = latency_histogram_count(hist);
+    if (count == 0)
+        return 0;
+
+    if (q < 0.0)
+        q = 0.0;
+    if (q > 1.0)
+        q = 1.0;
+
+    uint64_t target = (uint64_t)(q * (double)count + 0.5);
+    if (target == 0)
+        target = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+    {
+        seen += atomic_load_explicit(&hist->counts[i], memory_order_relaxed);
+        if (seen >= target)
+        {
+            uint64_t bound = bucket_upper_bound(i);
+            uint64_t max = latency_histogram_max(hist);
+            return bound < max ? bound : max;
+        }
+    }
+    return latency_histogram_max(hist);
+}
+
+void latency_histogram_merge(LatencyHistogram *dest, const LatencyHistogram *src)
+{
+    if (!dest || !src)
+        return;
+
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+    {
+        uint64_t c = atomic_load_explicit(&src->counts[i], memory_order_relaxed);
+        if (c)
+            atomic_fetch_add_explicit(&dest->counts[i], c, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&dest->total, atomic_load_explicit(&src->total, memory_order_relaxed),
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&dest->sum, atomic_load_explicit(&src->sum, memory_order_relaxed),
+                              memory_order_relaxed);
+
+    uint64_t src_max = atomic_load_explicit(&src->max, memory_order_relaxed);
+    uint64_t current = atomic_load_explicit(&dest->max, memory_order_relaxed);
+    while (src_max > current &&
+           !atomic_compare_exchange_weak_explicit(&dest->max, &current, src_max,
+                                                  memory_order_relaxed, memory_order_relaxed))
+        ;
+}
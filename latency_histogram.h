@@ -0,0 +1,43 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+// Histograma log-linear (estilo HDR): cada potência de 2 é dividida em
+// 2^LATENCY_SUB_BUCKET_BITS sub-faixas, erro relativo máximo de ~6%.
+#define LATENCY_SUB_BUCKET_BITS 4
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_HISTOGRAM_BUCKETS ((64 - LATENCY_SUB_BUCKET_BITS + 1) * LATENCY_SUB_BUCKETS)
+
+typedef struct
+{
+    atomic_uint_fast64_t counts[LATENCY_HISTOGRAM_BUCKETS];
+    atomic_uint_fast64_t total;
+    atomic_uint_fast64_t sum;
+    atomic_uint_fast64_t max;
+} LatencyHistogram;
+
+static inline uint64_t latency_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void latency_histogram_init(LatencyHistogram *hist);
+
+// Sem travas: pode ser chamado por várias threads ao mesmo tempo
+void latency_histogram_record(LatencyHistogram *hist, uint64_t value);
+
+uint64_t latency_histogram_count(const LatencyHistogram *hist);
+uint64_t latency_histogram_max(const LatencyHistogram *hist);
+double latency_histogram_mean(const LatencyHistogram *hist);
+
+// q em [0, 1]; retorna o limite superior da faixa que contém o quantil
+uint64_t latency_histogram_percentile(const LatencyHistogram *hist, double q);
+
+void latency_histogram_merge(LatencyHistogram *dest, const LatencyHistogram *src);
+
+#endif
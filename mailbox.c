@@ -0,0 +1,711 @@
+#include "mailbox.h"
+#include "crc32.h"
+#include "tslog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <crypt.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define MAIL_RECORD_DEPOSIT 1
+#define MAIL_RECORD_CLEAR 2 // Remove da caixa tudo com id <= record.id
+#define MAIL_RECORD_OWNER 3 // Dono do nome: from = IP, texto = crypt(3) da chave
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t crc;
+    uint64_t id;
+    int64_t timestamp;
+    uint32_t text_length;
+    uint8_t type;
+    uint8_t to_length;
+    uint8_t from_length;
+    uint8_t reserved;
+} MailRecordHeader;
+
+static uint32_t name_hash(const char *name)
+{
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++)
+    {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Formato antigo do registro de dono (FNV-1a de usuário + chave, 8 bytes).
+// Só serve para conferir caixas criadas antes do crypt(3).
+static uint64_t legacy_key_hash(const char *user, const char *key)
+{
+    uint64_t h = 1469598103934665603ULL;
+    for (const unsigned char *p = (const unsigned char *)user; *p; p++)
+        h = (h ^ *p) * 1099511628211ULL;
+    h = (h ^ 0xFF) * 1099511628211ULL; // Separador: "ab"+"c" != "a"+"bc"
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++)
+        h = (h ^ *p) * 1099511628211ULL;
+    return h;
+}
+
+// Hash lento com sal aleatório por usuário: quem lê o log não consegue testar
+// chaves em massa. Chamado sem o mutex (leva dezenas de milissegundos).
+static bool hash_key(const char *key, char *out)
+{
+    char salt[CRYPT_GENSALT_OUTPUT_SIZE];
+    if (!crypt_gensalt_rn(NULL, 0, NULL, 0, salt, sizeof(salt)))
+        return false;
+
+    struct crypt_data *data = calloc(1, sizeof(*data));
+    if (!data)
+        return false;
+
+    const char *hashed = crypt_r(key, salt, data);
+    bool ok = hashed && hashed[0] != '*' && strlen(hashed) < MAILBOX_KEY_HASH_SIZE;
+    if (ok)
+        strcpy(out, hashed);
+    free(data);
+    return ok;
+}
+
+static bool verify_key(const char *key, const char *stored)
+{
+    struct crypt_data *data = calloc(1, sizeof(*data));
+    if (!data)
+        return false;
+
+    const char *hashed = crypt_r(key, stored, data);
+    bool ok = hashed && hashed[0] != '*' && strcmp(hashed, stored) == 0;
+    free(data);
+    return ok;
+}
+
+static uint32_t record_crc(const MailRecordHeader *header, const char *payload)
+{
+    uint32_t crc = crc32_update(0, &header->id, sizeof(*header) - offsetof(MailRecordHeader, id));
+    return crc32_update(crc, payload,
+                        (size_t)header->to_length + header->from_length + header->text_length);
+}
+
+// As funções *_locked assumem store->mutex já adquirido
+static int find_box_locked(MailboxStore *store, const char *user)
+{
+    uint32_t slot = name_hash(user) & (MAILBOX_INDEX_SIZE - 1);
+    while (store->index[slot] != -1)
+    {
+        int box = store->index[slot];
+        if (strcmp(store->boxes[box].user, user) == 0)
+            return box;
+        slot = (slot + 1) & (MAILBOX_INDEX_SIZE - 1);
+    }
+    return -1;
+}
+
+static void index_box_locked(MailboxStore *store, int box)
+{
+    uint32_t slot = name_hash(store->boxes[box].user) & (MAILBOX_INDEX_SIZE - 1);
+    while (store->index[slot] != -1)
+        slot = (slot + 1) & (MAILBOX_INDEX_SIZE - 1);
+    store->index[slot] = (int16_t)box;
+}
+
+// Sondagem linear não aceita remoção simples; reconstruir é barato (2048 slots)
+static void rebuild_index_locked(MailboxStore *store)
+{
+    for (int i = 0; i < MAILBOX_INDEX_SIZE; i++)
+        store->index[i] = -1;
+    for (int b = 0; b < store->box_count; b++)
+    {
+        if (store->boxes[b].user[0])
+            index_box_locked(store, b);
+    }
+}
+
+// Cria a caixa do usuário (que não pode existir ainda); NULL com a tabela cheia
+static Mailbox *create_box_locked(MailboxStore *store, const char *user)
+{
+    int box;
+    if (store->free_count > 0)
+        box = store->free_boxes[--store->free_count];
+    else if (store->box_count < MAILBOX_MAX_USERS)
+        box = store->box_count++;
+    else
+        return NULL;
+
+    Mailbox *mailbox = &store->boxes[box];
+    memset(mailbox, 0, sizeof(*mailbox));
+    strncpy(mailbox->user, user, MAILBOX_NAME_SIZE - 1);
+    index_box_locked(store, box);
+    return mailbox;
+}
+
+static void release_box_locked(MailboxStore *store, int box)
+{
+    memset(&store->boxes[box], 0, sizeof(store->boxes[box]));
+    store->free_boxes[store->free_count++] = (int16_t)box;
+}
+
+static void push_item(Mailbox *mailbox, MailItem *item)
+{
+    item->next = NULL;
+    if (mailbox->tail)
+        mailbox->tail->next = item;
+    else
+        mailbox->head = item;
+    mailbox->tail = item;
+    mailbox->count++;
+    mailbox->bytes += item->length;
+}
+
+static MailItem *pop_item(Mailbox *mailbox)
+{
+    MailItem *item = mailbox->head;
+    mailbox->head = item->next;
+    if (!mailbox->head)
+        mailbox->tail = NULL;
+    mailbox->count--;
+    mailbox->bytes -= item->length;
+    return item;
+}
+
+// Itens estão em ordem de chegada, então os expirados ficam no começo
+static void expire_box(Mailbox *mailbox, time_t ttl, time_t now)
+{
+    while (mailbox->head && now - mailbox->head->timestamp > ttl)
+        free(pop_item(mailbox));
+}
+
+static bool box_idle(const Mailbox *mailbox, time_t ttl, time_t now)
+{
+    return mailbox->count == 0 && now - mailbox->last_seen > ttl;
+}
+
+// Libera caixas vazias cujo dono sumiu há mais que o TTL; retorna quantas
+static int reclaim_boxes_locked(MailboxStore *store, time_t now)
+{
+    int reclaimed = 0;
+    for (int b = 0; b < store->box_count; b++)
+    {
+        Mailbox *mailbox = &store->boxes[b];
+        if (!mailbox->user[0])
+            continue;
+        expire_box(mailbox, store->ttl, now);
+        if (box_idle(mailbox, store->ttl, now))
+        {
+            release_box_locked(store, b);
+            reclaimed++;
+        }
+    }
+    if (reclaimed > 0)
+        rebuild_index_locked(store);
+    return reclaimed;
+}
+
+static MailItem *item_create(uint64_t id, time_t timestamp, const char *from, size_t from_length,
+                             const char *text, size_t length)
+{
+    MailItem *item = malloc(sizeof(MailItem) + length + 1);
+    if (!item)
+        return NULL;
+
+    item->next = NULL;
+    item->id = id;
+    item->timestamp = timestamp;
+    if (from_length > MAILBOX_NAME_SIZE - 1)
+        from_length = MAILBOX_NAME_SIZE - 1;
+    memcpy(item->from, from, from_length);
+    item->from[from_length] = '\0';
+    item->length = length;
+    memcpy(item->text, text, length);
+    item->text[length] = '\0';
+    return item;
+}
+
+static int write_all(int fd, const char *data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t written = write(fd, data, length);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+    return 0;
+}
+
+static int append_record(int fd, uint8_t type, uint64_t id, time_t timestamp, const char *to,
+                         const char *from, const char *text, size_t length, bool sync)
+{
+    MailRecordHeader header;
+    header.magic = MAILBOX_MAGIC;
+    header.id = id;
+    header.timestamp = (int64_t)timestamp;
+    header.text_length = (uint32_t)length;
+    header.type = type;
+    header.to_length = (uint8_t)strnlen(to, MAILBOX_NAME_SIZE - 1);
+    header.from_length = (uint8_t)strnlen(from, MAILBOX_NAME_SIZE - 1);
+    header.reserved = 0;
+
+    char record[sizeof(MailRecordHeader) + 2 * MAILBOX_NAME_SIZE + MAILBOX_MAX_TEXT_SIZE];
+    char *payload = record + sizeof(header);
+    memcpy(payload, to, header.to_length);
+    memcpy(payload + header.to_length, from, header.from_length);
+    memcpy(payload + header.to_length + header.from_length, text, length);
+    header.crc = record_crc(&header, payload);
+    memcpy(record, &header, sizeof(header));
+
+    size_t total = sizeof(header) + header.to_length + header.from_length + length;
+    if (write_all(fd, record, total) != 0)
+        return -1;
+    return sync ? fdatasync(fd) : 0;
+}
+
+static void replay_log(MailboxStore *store, const char *map, size_t size)
+{
+    size_t offset = 0;
+    while (offset + sizeof(MailRecordHeader) <= size)
+    {
+        MailRecordHeader header;
+        memcpy(&header, map + offset, sizeof(header));
+
+        size_t payload_length = (size_t)header.to_length + header.from_length + header.text_length;
+        if (header.magic != MAILBOX_MAGIC || header.text_length > MAILBOX_MAX_TEXT_SIZE ||
+            header.to_length >= MAILBOX_NAME_SIZE || header.from_length >= MAILBOX_NAME_SIZE ||
+            offset + sizeof(header) + payload_length > size)
+            break;
+
+        const char *payload = map + offset + sizeof(header);
+        if (record_crc(&header, payload) != header.crc)
+            break;
+
+        char to[MAILBOX_NAME_SIZE];
+        memcpy(to, payload, header.to_length);
+        to[header.to_length] = '\0';
+
+        // Depósitos só valem para nomes com dono registrado antes no log
+        int box = find_box_locked(store, to);
+        Mailbox *mailbox = box >= 0 ? &store->boxes[box] : NULL;
+        if (header.type == MAIL_RECORD_OWNER &&
+            (header.text_length == sizeof(uint64_t) || header.text_length < MAILBOX_KEY_HASH_SIZE))
+        {
+            if (!mailbox)
+                mailbox = create_box_locked(store, to);
+            if (mailbox)
+            {
+                const char *key = payload + header.to_length + header.from_length;
+                if (header.text_length == sizeof(uint64_t))
+                {
+                    memcpy(&mailbox->legacy_key, key, sizeof(mailbox->legacy_key));
+                    mailbox->owner_key[0] = '\0';
+                }
+                else
+                {
+                    memcpy(mailbox->owner_key, key, header.text_length);
+                    mailbox->owner_key[header.text_length] = '\0';
+                    mailbox->legacy_key = 0;
+                }
+                memcpy(mailbox->owner_ip, payload + header.to_length, header.from_length);
+                mailbox->owner_ip[header.from_length] = '\0';
+                mailbox->last_seen = (time_t)header.timestamp;
+            }
+        }
+        else if (mailbox && header.type == MAIL_RECORD_DEPOSIT)
+        {
+            MailItem *item = item_create(header.id, (time_t)header.timestamp,
+                                         payload + header.to_length, header.from_length,
+                                         payload + header.to_length + header.from_length,
+                                         header.text_length);
+            if (item)
+                push_item(mailbox, item);
+        }
+        else if (mailbox && header.type == MAIL_RECORD_CLEAR)
+        {
+            while (mailbox->head && mailbox->head->id <= header.id)
+                free(pop_item(mailbox));
+        }
+
+        if (header.id >= store->next_id)
+            store->next_id = header.id + 1;
+        offset += sizeof(header) + payload_length;
+    }
+
+    if (offset < size)
+        TSLOG_WARN(TSLOG_CAT_GENERAL, "Mailbox %s: %zu bytes inválidos no fim descartados",
+                   store->path, size - offset);
+}
+
+static int load_existing(MailboxStore *store)
+{
+    int fd = open(store->path, O_RDONLY);
+    if (fd < 0)
+        return errno == ENOENT ? 0 : -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    if (st.st_size > 0)
+    {
+        char *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            close(fd);
+            return -1;
+        }
+        replay_log(store, map, (size_t)st.st_size);
+        munmap(map, (size_t)st.st_size);
+    }
+
+    close(fd);
+    return 0;
+}
+
+static int append_owner_record(int fd, const Mailbox *mailbox, bool sync)
+{
+    if (mailbox->owner_key[0])
+        return append_record(fd, MAIL_RECORD_OWNER, 0, mailbox->last_seen, mailbox->user, mailbox->owner_ip,
+                             mailbox->owner_key, strlen(mailbox->owner_key), sync);
+    return append_record(fd, MAIL_RECORD_OWNER, 0, mailbox->last_seen, mailbox->user, mailbox->owner_ip,
+                         (const char *)&mailbox->legacy_key, sizeof(mailbox->legacy_key), sync);
+}
+
+// Reescreve o log só com as mensagens ainda pendentes e não expiradas
+static int compact_log(MailboxStore *store)
+{
+    char tmp_path[PATH_MAX + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", store->path);
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (fd < 0)
+        return -1;
+
+    time_t now = time(NULL);
+    reclaim_boxes_locked(store, now);
+
+    int pending = 0;
+    for (int b = 0; b < store->box_count; b++)
+    {
+        Mailbox *mailbox = &store->boxes[b];
+        if (!mailbox->user[0])
+            continue;
+
+        if (append_owner_record(fd, mailbox, false) != 0)
+        {
+            close(fd);
+            unlink(tmp_path);
+            return -1;
+        }
+        for (MailItem *item = mailbox->head; item; item = item->next)
+        {
+            if (append_record(fd, MAIL_RECORD_DEPOSIT, item->id, item->timestamp, mailbox->user,
+                              item->from, item->text, item->length, false) != 0)
+            {
+                close(fd);
+                unlink(tmp_path);
+                return -1;
+            }
+            pending++;
+        }
+    }
+
+    if (fdatasync(fd) != 0 || rename(tmp_path, store->path) != 0)
+    {
+        close(fd);
+        unlink(tmp_path);
+        return -1;
+    }
+
+    store->fd = fd;
+    return pending;
+}
+
+int mailbox_open(MailboxStore *store, const char *path, time_t ttl)
+{
+    if (!store)
+        return -1;
+
+    memset(store->boxes, 0, sizeof(store->boxes));
+    store->box_count = 0;
+    store->free_count = 0;
+    for (int i = 0; i < MAILBOX_INDEX_SIZE; i++)
+        store->index[i] = -1;
+    store->next_id = 1;
+    store->ttl = ttl > 0 ? ttl : MAILBOX_DEFAULT_TTL;
+    store->fd = -1;
+    strncpy(store->path, path ? path : MAILBOX_DEFAULT_PATH, sizeof(store->path) - 1);
+    store->path[sizeof(store->path) - 1] = '\0';
+
+    if (pthread_mutex_init(&store->mutex, NULL) != 0)
+        return -1;
+
+    int pending;
+    if (load_existing(store) != 0 || (pending = compact_log(store)) < 0)
+    {
+        mailbox_close(store);
+        return -1;
+    }
+
+    TSLOG_INFO(TSLOG_CAT_GENERAL, "Mailbox %s: %d usuários registrados, %d mensagens pendentes (validade %ld s)",
+               store->path, store->box_count - store->free_count, pending, (long)store->ttl);
+    return 0;
+}
+
+// Confere a chave do dono existente. O crypt(3) roda fora do mutex; se o dono
+// mudar no meio (caixa liberada e registrada de novo) a chave é recusada.
+static int verify_owner(MailboxStore *store, const char *user, const char *key, time_t now)
+{
+    char stored[MAILBOX_KEY_HASH_SIZE];
+    uint64_t legacy;
+
+    pthread_mutex_lock(&store->mutex);
+    int box = find_box_locked(store, user);
+    if (box < 0)
+    {
+        pthread_mutex_unlock(&store->mutex);
+        return MAILBOX_UNKNOWN;
+    }
+    memcpy(stored, store->boxes[box].owner_key, sizeof(stored));
+    legacy = store->boxes[box].legacy_key;
+    pthread_mutex_unlock(&store->mutex);
+
+    // Caixa de um log antigo: confere pelo hash rápido e já troca pelo crypt(3)
+    char upgraded[MAILBOX_KEY_HASH_SIZE] = "";
+    bool ok = stored[0] ? verify_key(key, stored)
+                        : legacy_key_hash(user, key) == legacy && hash_key(key, upgraded);
+    if (!ok)
+        return MAILBOX_DENIED;
+
+    pthread_mutex_lock(&store->mutex);
+    box = find_box_locked(store, user);
+    Mailbox *mailbox = box >= 0 ? &store->boxes[box] : NULL;
+    if (!mailbox || strcmp(mailbox->owner_key, stored) != 0 || mailbox->legacy_key != legacy)
+    {
+        pthread_mutex_unlock(&store->mutex);
+        return MAILBOX_DENIED;
+    }
+
+    if (upgraded[0])
+    {
+        strcpy(mailbox->owner_key, upgraded);
+        mailbox->legacy_key = 0;
+    }
+
+    // Sem fdatasync: perder o registro só adianta a liberação da caixa vazia
+    // (ou mantém o hash antigo até o próximo login)
+    mailbox->last_seen = now;
+    append_owner_record(store->fd, mailbox, false);
+
+    pthread_mutex_unlock(&store->mutex);
+    return 0;
+}
+
+int mailbox_claim(MailboxStore *store, const char *user, const char *key, const char *ip)
+{
+    if (!store || !user || !user[0] || !key || strlen(key) < MAILBOX_MIN_KEY_LENGTH || !ip)
+        return -1;
+
+    time_t now = time(NULL);
+    int result = verify_owner(store, user, key, now);
+    if (result != MAILBOX_UNKNOWN)
+        return result;
+
+    char hashed[MAILBOX_KEY_HASH_SIZE];
+    if (!hash_key(key, hashed))
+    {
+        TSLOG_ERROR(TSLOG_CAT_GENERAL, "Falha ao gerar hash da chave de %s", user);
+        return -1;
+    }
+
+    pthread_mutex_lock(&store->mutex);
+
+    // Outro cliente registrou o nome enquanto o hash era calculado
+    if (find_box_locked(store, user) >= 0)
+    {
+        pthread_mutex_unlock(&store->mutex);
+        return MAILBOX_DENIED;
+    }
+
+    int from_ip = 0;
+    for (int b = 0; b < store->box_count; b++)
+    {
+        if (store->boxes[b].user[0] && strcmp(store->boxes[b].owner_ip, ip) == 0)
+            from_ip++;
+    }
+
+    Mailbox *mailbox = NULL;
+    if (from_ip < MAILBOX_MAX_USERS_PER_IP)
+    {
+        mailbox = create_box_locked(store, user);
+        if (!mailbox && reclaim_boxes_locked(store, now) > 0)
+            mailbox = create_box_locked(store, user);
+    }
+    if (!mailbox)
+    {
+        pthread_mutex_unlock(&store->mutex);
+        TSLOG_WARN(TSLOG_CAT_GENERAL, "Registro de %s recusado: limite de caixas (%s)", user, ip);
+        return MAILBOX_FULL;
+    }
+
+    strcpy(mailbox->owner_key, hashed);
+    strncpy(mailbox->owner_ip, ip, MAILBOX_NAME_SIZE - 1);
+    mailbox->last_seen = now;
+    if (append_owner_record(store->fd, mailbox, true) != 0)
+    {
+        release_box_locked(store, find_box_locked(store, user));
+        rebuild_index_locked(store);
+        pthread_mutex_unlock(&store->mutex);
+        TSLOG_ERROR(TSLOG_CAT_GENERAL, "Falha ao registrar dono da caixa %s", user);
+        return -1;
+    }
+
+    pthread_mutex_unlock(&store->mutex);
+
+    TSLOG_INFO(TSLOG_CAT_GENERAL, "Caixa de mensagens registrada: %s (%s)", user, ip);
+    return 0;
+}
+
+bool mailbox_is_registered(MailboxStore *store, const char *user)
+{
+    if (!store || !user)
+        return false;
+
+    pthread_mutex_lock(&store->mutex);
+    bool registered = find_box_locked(store, user) >= 0;
+    pthread_mutex_unlock(&store->mutex);
+    return registered;
+}
+
+int mailbox_deposit(MailboxStore *store, const char *to, const char *from,
+                    const char *text, size_t length)
+{
+    if (!store || !to || !to[0] || !from || !text || length > MAILBOX_MAX_TEXT_SIZE)
+        return -1;
+
+    pthread_mutex_lock(&store->mutex);
+
+    int box = find_box_locked(store, to);
+    if (box < 0)
+    {
+        pthread_mutex_unlock(&store->mutex);
+        return MAILBOX_UNKNOWN;
+    }
+
+    Mailbox *mailbox = &store->boxes[box];
+    time_t now = time(NULL);
+    expire_box(mailbox, store->ttl, now);
+    if (mailbox->count >= MAILBOX_MAX_MESSAGES || mailbox->bytes + length > MAILBOX_MAX_BYTES)
+    {
+        pthread_mutex_unlock(&store->mutex);
+        return MAILBOX_FULL;
+    }
+
+    uint64_t id = store->next_id;
+    MailItem *item = item_create(id, now, from, strnlen(from, MAILBOX_NAME_SIZE - 1), text, length);
+    if (!item || append_record(store->fd, MAIL_RECORD_DEPOSIT, id, now, mailbox->user,
+                               item->from, text, length, true) != 0)
+    {
+        pthread_mutex_unlock(&store->mutex);
+        free(item);
+        TSLOG_ERROR(TSLOG_CAT_GENERAL, "Falha ao gravar mensagem offline para %s", to);
+        return -1;
+    }
+
+    store->next_id++;
+    push_item(mailbox, item);
+
+    pthread_mutex_unlock(&store->mutex);
+
+    TSLOG_DEBUG(TSLOG_CAT_GENERAL, "Mensagem offline guardada: %s -> %s", from, to);
+    return 0;
+}
+
+int mailbox_take(MailboxStore *store, const char *user, MailItem **items)
+{
+    if (!store || !user || !items)
+        return -1;
+
+    *items = NULL;
+
+    pthread_mutex_lock(&store->mutex);
+
+    int box = find_box_locked(store, user);
+    if (box < 0)
+    {
+        pthread_mutex_unlock(&store->mutex);
+        return 0;
+    }
+
+    Mailbox *mailbox = &store->boxes[box];
+    expire_box(mailbox, store->ttl, time(NULL));
+
+    int count = mailbox->count;
+    if (count > 0)
+    {
+        // Limpa no log antes de entregar: no pior caso uma queda perde a
+        // entrega, mas nunca entrega duas vezes. Sem o registro as mensagens
+        // ficam na caixa para a próxima tentativa.
+        if (append_record(store->fd, MAIL_RECORD_CLEAR, mailbox->tail->id, time(NULL),
+                          mailbox->user, "", "", 0, true) != 0)
+        {
+            TSLOG_ERROR(TSLOG_CAT_GENERAL, "Falha ao registrar entrega offline para %s: %s", user, strerror(errno));
+            pthread_mutex_unlock(&store->mutex);
+            return -1;
+        }
+
+        *items = mailbox->head;
+        mailbox->head = mailbox->tail = NULL;
+        mailbox->count = 0;
+        mailbox->bytes = 0;
+    }
+
+    pthread_mutex_unlock(&store->mutex);
+    return count;
+}
+
+void mailbox_free_items(MailItem *items)
+{
+    while (items)
+    {
+        MailItem *next = items->next;
+        free(items);
+        items = next;
+    }
+}
+
+void mailbox_close(MailboxStore *store)
+{
+    if (!store)
+        return;
+
+    pthread_mutex_lock(&store->mutex);
+    for (int b = 0; b < store->box_count; b++)
+    {
+        mailbox_free_items(store->boxes[b].head);
+        store->boxes[b].head = store->boxes[b].tail = NULL;
+        store->boxes[b].count = 0;
+    }
+    store->box_count = 0;
+    store->free_count = 0;
+
+    if (store->fd >= 0)
+    {
+        close(store->fd);
+        store->fd = -1;
+    }
+    pthread_mutex_unlock(&store->mutex);
+
+    pthread_mutex_destroy(&store->mutex);
+}
@@ -0,0 +1,94 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+
+#define MAILBOX_DEFAULT_PATH "mailbox.log"
+#define MAILBOX_MAX_USERS 1024
+#define MAILBOX_INDEX_SIZE 2048 // Potência de 2, ao menos 2x MAILBOX_MAX_USERS
+#define MAILBOX_MAX_MESSAGES 50 // Por caixa
+#define MAILBOX_MAX_BYTES (16 * 1024)
+#define MAILBOX_DEFAULT_TTL (7 * 24 * 60 * 60)
+#define MAILBOX_NAME_SIZE 50
+#define MAILBOX_MAX_TEXT_SIZE 1024
+#define MAILBOX_MIN_KEY_LENGTH 4
+#define MAILBOX_KEY_HASH_SIZE 128 // Saída do crypt(3) com o método padrão (yescrypt)
+#define MAILBOX_MAX_USERS_PER_IP 16 // Nomes registrados a partir do mesmo IP
+#define MAILBOX_MAGIC 0x584F424Du // "MBOX"
+
+#define MAILBOX_FULL (-2)
+#define MAILBOX_UNKNOWN (-3) // Nome sem dono registrado
+#define MAILBOX_DENIED (-4)  // Chave não confere com a do dono
+
+typedef struct MailItem
+{
+    struct MailItem *next;
+    uint64_t id;
+    time_t timestamp;
+    char from[MAILBOX_NAME_SIZE];
+    size_t length;
+    char text[];
+} MailItem;
+
+// Uma caixa existe para cada nome registrado com /auth <senha> <usuário> <chave>
+typedef struct
+{
+    char user[MAILBOX_NAME_SIZE]; // Vazio = posição livre
+    char owner_key[MAILBOX_KEY_HASH_SIZE]; // crypt(3) da chave, com sal próprio; a chave não é guardada
+    uint64_t legacy_key;          // Hash rápido de logs antigos; trocado no próximo login
+    char owner_ip[MAILBOX_NAME_SIZE];
+    time_t last_seen;             // Último registro ou login do dono
+    MailItem *head; // Mais antiga
+    MailItem *tail;
+    int count;
+    size_t bytes;
+} Mailbox;
+
+// Mensagens privadas para quem está offline. Cada depósito é gravado no log
+// (com fdatasync) antes de ser confirmado; a entrega grava um registro de
+// limpeza. Na abertura o log é relido e reescrito só com o que ainda vale.
+// Caixas vazias cujo dono não aparece há mais que o TTL são liberadas.
+typedef struct
+{
+    Mailbox boxes[MAILBOX_MAX_USERS];
+    int box_count;                       // Posições já usadas de boxes[], livres ou não
+    int16_t free_boxes[MAILBOX_MAX_USERS]; // Posições liberadas, reusadas primeiro
+    int free_count;
+    int16_t index[MAILBOX_INDEX_SIZE]; // Hash do usuário -> posição em boxes[]
+    uint64_t next_id;
+    time_t ttl;
+
+    int fd;
+    char path[PATH_MAX];
+    pthread_mutex_t mutex;
+} MailboxStore;
+
+int mailbox_open(MailboxStore *store, const char *path, time_t ttl);
+
+// Registra o nome para a chave (se ainda não tem dono) ou confere a chave do
+// dono. 0 se o chamador é o dono, MAILBOX_DENIED se a chave não confere,
+// MAILBOX_FULL se a tabela ou o limite do IP foi atingido, -1 em erro.
+int mailbox_claim(MailboxStore *store, const char *user, const char *key, const char *ip);
+
+bool mailbox_is_registered(MailboxStore *store, const char *user);
+
+// 0 se guardou, MAILBOX_UNKNOWN se o nome não tem dono, MAILBOX_FULL se a
+// caixa atingiu o limite, -1 em erro
+int mailbox_deposit(MailboxStore *store, const char *to, const char *from,
+                    const char *text, size_t length);
+
+// Retira todas as mensagens válidas do usuário (lista ligada, da mais antiga
+// para a mais nova); chame só depois de mailbox_claim. Libere com mailbox_free_items.
+// -1 se a entrega não pôde ser registrada no log; as mensagens continuam na caixa.
+int mailbox_take(MailboxStore *store, const char *user, MailItem **items);
+
+void mailbox_free_items(MailItem *items);
+
+void mailbox_close(MailboxStore *store);
+
+#endif
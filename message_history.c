@@ -0,0 +1,112 @@
+#include "message_history.h"
+#include <string.h>
+
+int message_history_init(MessageHistory *history, size_t byte_budget)
+{
+    if (!history)
+        return -1;
+
+    memset(history->rooms, 0, sizeof(history->rooms));
+    history->byte_budget = byte_budget > 0 ? byte_budget : HISTORY_DEFAULT_BYTE_BUDGET;
+
+    if (pthread_mutex_init(&history->mutex, NULL) != 0)
+        return -1;
+
+    return 0;
+}
+
+static void evict_oldest(HistoryRing *ring)
+{
+    int oldest = (ring->head - ring->count + HISTORY_MAX_ENTRIES) % HISTORY_MAX_ENTRIES;
+    ring->bytes -= ring->entries[oldest]->length;
+    payload_unref(ring->entries[oldest]);
+    ring->entries[oldest] = NULL;
+    ring->count--;
+}
+
+void message_history_append(MessageHistory *history, Payload *payload)
+{
+    if (!history || !payload)
+        return;
+
+    if (payload->room_id < 0 || payload->room_id >= MAX_ROOMS || payload->length > history->byte_budget)
+    {
+        payload_unref(payload);
+        return;
+    }
+
+    pthread_mutex_lock(&history->mutex);
+
+    HistoryRing *ring = &history->rooms[payload->room_id];
+
+    // Cada mensagem sai no máximo uma vez, então o custo amortizado é O(1)
+    while (ring->count == HISTORY_MAX_ENTRIES ||
+           (ring->count > 0 && ring->bytes + payload->length > history->byte_budget))
+    {
+        evict_oldest(ring);
+    }
+
+    ring->entries[ring->head] = payload;
+    ring->head = (ring->head + 1) % HISTORY_MAX_ENTRIES;
+    ring->count++;
+    ring->bytes += payload->length;
+
+    pthread_mutex_unlock(&history->mutex);
+}
+
+int message_history_snapshot(MessageHistory *history, int room_id, Payload **out, int max_count)
+{
+    if (!history || !out || room_id < 0 || room_id >= MAX_ROOMS || max_count <= 0)
+        return 0;
+
+    pthread_mutex_lock(&history->mutex);
+
+    HistoryRing *ring = &history->rooms[room_id];
+    int count = ring->count < max_count ? ring->count : max_count;
+    int start = (ring->head - count + HISTORY_MAX_ENTRIES) % HISTORY_MAX_ENTRIES;
+    for (int i = 0; i < count; i++)
+        out[i] = payload_ref(ring->entries[(start + i) % HISTORY_MAX_ENTRIES]);
+
+    pthread_mutex_unlock(&history->mutex);
+    return count;
+}
+
+uint64_t message_history_oldest_offset(MessageHistory *history)
+{
+    if (!history)
+        return PAYLOAD_NO_OFFSET;
+
+    uint64_t oldest = PAYLOAD_NO_OFFSET;
+
+    pthread_mutex_lock(&history->mutex);
+    for (int r = 0; r < MAX_ROOMS; r++)
+    {
+        const HistoryRing *ring = &history->rooms[r];
+        if (ring->count == 0)
+            continue;
+
+        // Cada anel está em ordem de chegada: a mais antiga tem o menor offset
+        int first = (ring->head - ring->count + HISTORY_MAX_ENTRIES) % HISTORY_MAX_ENTRIES;
+        if (ring->entries[first]->journal_offset < oldest)
+            oldest = ring->entries[first]->journal_offset;
+    }
+    pthread_mutex_unlock(&history->mutex);
+
+    return oldest;
+}
+
+void message_history_destroy(MessageHistory *history)
+{
+    if (!history)
+        return;
+
+    pthread_mutex_lock(&history->mutex);
+    for (int r = 0; r < MAX_ROOMS; r++)
+    {
+        while (history->rooms[r].count > 0)
+            evict_oldest(&history->rooms[r]);
+    }
+    pthread_mutex_unlock(&history->mutex);
+
+    pthread_mutex_destroy(&history->mutex);
+}
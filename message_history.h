@@ -0,0 +1,43 @@
+#ifndef MESSAGE_HISTORY_H
+#define MESSAGE_HISTORY_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include "client_manager.h"
+#include "payload.h"
+
+#define HISTORY_MAX_ENTRIES 256                // Por sala
+#define HISTORY_DEFAULT_BYTE_BUDGET (64 * 1024) // Por sala
+
+typedef struct
+{
+    Payload *entries[HISTORY_MAX_ENTRIES];
+    int head;  // Próxima posição de escrita
+    int count;
+    size_t bytes;
+} HistoryRing;
+
+// Um anel por sala (o id da sala indexa rooms[]), cada um limitado em número
+// de mensagens e em bytes. Mensagens antigas saem quando o limite é atingido.
+typedef struct
+{
+    HistoryRing rooms[MAX_ROOMS];
+    size_t byte_budget;
+    pthread_mutex_t mutex;
+} MessageHistory;
+
+int message_history_init(MessageHistory *history, size_t byte_budget);
+
+// Guarda a referência recebida (quem chama não deve mais liberá-la)
+void message_history_append(MessageHistory *history, Payload *payload);
+
+// Copia (com referência) até max_count mensagens mais recentes da sala, da
+// mais antiga para a mais nova. Quem chama libera cada uma com payload_unref.
+int message_history_snapshot(MessageHistory *history, int room_id, Payload **out, int max_count);
+
+// Menor journal_offset entre as mensagens guardadas; PAYLOAD_NO_OFFSET se nenhuma
+uint64_t message_history_oldest_offset(MessageHistory *history);
+
+void message_history_destroy(MessageHistory *history);
+
+#endif
@@ -0,0 +1,273 @@
+#include "metrics.h"
+#include "tslog.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#define METRICS_POLL_MS 500
+#define METRICS_REQUEST_SIZE 1024
+
+typedef struct
+{
+    const char *family;
+    const char *labels; // NULL se não houver
+    const char *help;
+} MetricDescription;
+
+static const MetricDescription descriptions[METRIC_COUNT] = {
+    [METRIC_CONNECTIONS_ACCEPTED] = {"chat_connections_accepted_total", NULL, "Conexões aceitas"},
+    [METRIC_CONNECTIONS_REJECTED] = {"chat_connections_rejected_total", NULL,
+                                     "Conexões recusadas (admissão ou servidor lotado)"},
+    [METRIC_AUTH_FAILURES] = {"chat_auth_failures_total", NULL, "Tentativas de autenticação com senha incorreta"},
+    [METRIC_MESSAGES_IN] = {"chat_messages_received_total", NULL, "Linhas recebidas dos clientes"},
+    [METRIC_MESSAGES_OUT] = {"chat_messages_sent_total", NULL, "Mensagens entregues a destinatários"},
+    [METRIC_BYTES_IN] = {"chat_bytes_received_total", NULL, "Bytes lidos dos sockets de clientes"},
+    [METRIC_BYTES_OUT] = {"chat_bytes_sent_total", NULL, "Bytes enviados a destinatários"},
+    [METRIC_DROPS_RATE_LIMIT] = {"chat_messages_dropped_total", "reason=\"rate_limit\"",
+                                 "Mensagens descartadas"},
+    [METRIC_DROPS_SEND] = {"chat_messages_dropped_total", "reason=\"send_error\"", "Mensagens descartadas"},
+    [METRIC_FILTER_HITS] = {"chat_filter_hits_total", NULL, "Mensagens bloqueadas pelo filtro de palavras"},
+};
+
+static MetricShard shards[METRICS_MAX_SHARDS];
+MetricShard metrics_shared_shard;
+_Thread_local MetricShard *metrics_local_shard;
+
+static pthread_key_t shard_key;
+static pthread_once_t shard_key_once = PTHREAD_ONCE_INIT;
+
+static int listen_fd = -1;
+static pthread_t metrics_thread;
+static volatile bool metrics_running;
+static MetricsCollectFn collect_fn;
+static void *collect_ctx;
+
+// Ao fim da thread o shard volta a ficar livre; os valores continuam nele e a
+// próxima thread que o pegar soma por cima, então nada se perde.
+static void release_shard(void *value)
+{
+    MetricShard *shard = value;
+    atomic_store_explicit(&shard->in_use, false, memory_order_release);
+}
+
+static void create_shard_key(void)
+{
+    pthread_key_create(&shard_key, release_shard);
+}
+
+MetricShard *metrics_claim_shard(void)
+{
+    pthread_once(&shard_key_once, create_shard_key);
+
+    for (int i = 0; i < METRICS_MAX_SHARDS; i++)
+    {
+        bool expected = false;
+        if (!atomic_load_explicit(&shards[i].in_use, memory_order_relaxed) &&
+            atomic_compare_exchange_strong(&shards[i].in_use, &expected, true))
+        {
+            pthread_setspecific(shard_key, &shards[i]);
+            metrics_local_shard = &shards[i];
+            return metrics_local_shard;
+        }
+    }
+
+    metrics_local_shard = &metrics_shared_shard;
+    return metrics_local_shard;
+}
+
+void metrics_init(void)
+{
+    pthread_once(&shard_key_once, create_shard_key);
+}
+
+uint64_t metrics_total(MetricCounter counter)
+{
+    if (counter >= METRIC_COUNT)
+        return 0;
+
+    uint64_t total = atomic_load_explicit(&metrics_shared_shard.values[counter], memory_order_relaxed);
+    for (int i = 0; i < METRICS_MAX_SHARDS; i++)
+        total += atomic_load_explicit(&shards[i].values[counter], memory_order_relaxed);
+    return total;
+}
+
+void metrics_printf(MetricsBuffer *buffer, const char *format, ...)
+{
+    for (;;)
+    {
+        size_t available = buffer->capacity - buffer->length;
+        va_list args;
+        va_start(args, format);
+        int written = vsnprintf(buffer->data ? buffer->data + buffer->length : NULL, available, format, args);
+        va_end(args);
+
+        if (written < 0)
+            return;
+        if ((size_t)written < available)
+        {
+            buffer->length += (size_t)written;
+            return;
+        }
+
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+        while (capacity - buffer->length <= (size_t)written)
+            capacity *= 2;
+        char *data = realloc(buffer->data, capacity);
+        if (!data)
+            return;
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+}
+
+static void render(MetricsBuffer *buffer)
+{
+    const char *previous_family = NULL;
+    for (int c = 0; c < METRIC_COUNT; c++)
+    {
+        const MetricDescription *desc = &descriptions[c];
+        if (!previous_family || strcmp(previous_family, desc->family) != 0)
+        {
+            metrics_printf(buffer, "# HELP %s %s\n# TYPE %s counter\n", desc->family, desc->help, desc->family);
+            previous_family = desc->family;
+        }
+
+        if (desc->labels)
+            metrics_printf(buffer, "%s{%s} %llu\n", desc->family, desc->labels,
+                           (unsigned long long)metrics_total((MetricCounter)c));
+        else
+            metrics_printf(buffer, "%s %llu\n", desc->family, (unsigned long long)metrics_total((MetricCounter)c));
+    }
+
+    if (collect_fn)
+        collect_fn(buffer, collect_ctx);
+}
+
+static void send_all(int fd, const char *data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+        if (sent <= 0)
+        {
+            if (sent < 0 && errno == EINTR)
+                continue;
+            return;
+        }
+        data += sent;
+        length -= (size_t)sent;
+    }
+}
+
+static void serve_request(int fd)
+{
+    struct timeval timeout = {.tv_sec = 1, .tv_usec = 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    char request[METRICS_REQUEST_SIZE];
+    ssize_t received = recv(fd, request, sizeof(request) - 1, 0);
+    if (received <= 0)
+        return;
+    request[received] = '\0';
+
+    char header[256];
+    if (strncmp(request, "GET /metrics", 12) != 0 && strncmp(request, "GET / ", 6) != 0)
+    {
+        const char *not_found = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        send_all(fd, not_found, strlen(not_found));
+        return;
+    }
+
+    MetricsBuffer body = {0};
+    render(&body);
+
+    int header_length = snprintf(header, sizeof(header),
+                                 "HTTP/1.1 200 OK\r\n"
+                                 "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                                 "Content-Length: %zu\r\n"
+                                 "Connection: close\r\n\r\n",
+                                 body.length);
+    send_all(fd, header, (size_t)header_length);
+    send_all(fd, body.data, body.length);
+    free(body.data);
+}
+
+static void *metrics_worker(void *arg)
+{
+    (void)arg;
+    struct pollfd pfd = {.fd = listen_fd, .events = POLLIN};
+
+    while (metrics_running)
+    {
+        if (poll(&pfd, 1, METRICS_POLL_MS) <= 0)
+            continue;
+
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0)
+            continue;
+
+        serve_request(fd);
+        close(fd);
+    }
+
+    return NULL;
+}
+
+int metrics_start(int port, MetricsCollectFn collect, void *ctx)
+{
+    if (port <= 0)
+        return 0;
+
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+        return -1;
+
+    int opt = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons((uint16_t)port);
+
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_fd, 8) != 0)
+    {
+        close(listen_fd);
+        listen_fd = -1;
+        return -1;
+    }
+
+    collect_fn = collect;
+    collect_ctx = ctx;
+    metrics_running = true;
+    if (pthread_create(&metrics_thread, NULL, metrics_worker, NULL) != 0)
+    {
+        metrics_running = false;
+        close(listen_fd);
+        listen_fd = -1;
+        return -1;
+    }
+
+    TSLOG_INFO(TSLOG_CAT_NET, "Métricas disponíveis em http://0.0.0.0:%d/metrics", port);
+    return 0;
+}
+
+void metrics_stop(void)
+{
+    if (!metrics_running)
+        return;
+
+    metrics_running = false;
+    pthread_join(metrics_thread, NULL);
+    close(listen_fd);
+    listen_fd = -1;
+}
@@ -0,0 +1,83 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define METRICS_DEFAULT_PORT 9100
+#define METRICS_MAX_SHARDS 256 // Threads com contadores próprios; as demais dividem um extra
+#define METRICS_CACHE_LINE 64
+
+typedef enum
+{
+    METRIC_CONNECTIONS_ACCEPTED,
+    METRIC_CONNECTIONS_REJECTED,
+    METRIC_AUTH_FAILURES,
+    METRIC_MESSAGES_IN,
+    METRIC_MESSAGES_OUT,
+    METRIC_BYTES_IN,
+    METRIC_BYTES_OUT,
+    METRIC_DROPS_RATE_LIMIT,
+    METRIC_DROPS_SEND,
+    METRIC_FILTER_HITS,
+    METRIC_COUNT
+} MetricCounter;
+
+// Contadores de uma thread, em linhas de cache próprias para não haver
+// compartilhamento falso. Só a thread dona escreve; a coleta só lê.
+typedef struct
+{
+    _Alignas(METRICS_CACHE_LINE) atomic_uint_fast64_t values[METRIC_COUNT];
+    atomic_bool in_use;
+} MetricShard;
+
+extern _Thread_local MetricShard *metrics_local_shard;
+extern MetricShard metrics_shared_shard;
+MetricShard *metrics_claim_shard(void);
+
+// Sem trava e, no caso comum, sem instrução atômica de leitura-modificação-escrita:
+// o shard tem um único escritor, então load + store relaxados bastam.
+static inline void metrics_add(MetricCounter counter, uint64_t amount)
+{
+    MetricShard *shard = metrics_local_shard;
+    if (!shard)
+        shard = metrics_claim_shard();
+
+    atomic_uint_fast64_t *value = &shard->values[counter];
+    if (shard == &metrics_shared_shard)
+        atomic_fetch_add_explicit(value, amount, memory_order_relaxed);
+    else
+        atomic_store_explicit(value, atomic_load_explicit(value, memory_order_relaxed) + amount,
+                              memory_order_relaxed);
+}
+
+static inline void metrics_inc(MetricCounter counter)
+{
+    metrics_add(counter, 1);
+}
+
+// Texto da resposta, montado na coleta
+typedef struct
+{
+    char *data;
+    size_t length;
+    size_t capacity;
+} MetricsBuffer;
+
+void metrics_printf(MetricsBuffer *buffer, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+// Chamada a cada coleta para acrescentar gauges e métricas de outros módulos
+typedef void (*MetricsCollectFn)(MetricsBuffer *buffer, void *ctx);
+
+void metrics_init(void);
+
+// Soma de todas as threads
+uint64_t metrics_total(MetricCounter counter);
+
+// Servidor HTTP (GET /metrics) numa thread própria. port 0 desliga.
+int metrics_start(int port, MetricsCollectFn collect, void *ctx);
+void metrics_stop(void);
+
+#endif
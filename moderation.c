@@ -0,0 +1,251 @@
+#include "moderation.h"
+#include "word_filter.h"
+#include "tslog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/stat.h>
+
+// Lista usada quando o arquivo de palavras não existe
+static const char *default_words[] = {
+    "spam", "lixo", "idiota", "burro", "estupido",
+    "merda", "porra", "caralho", "fdp", "otario",
+    NULL};
+
+// Contadores de leitores em linhas de cache separadas
+typedef struct
+{
+    atomic_long count;
+    char padding[64 - sizeof(atomic_long)];
+} ReaderCounter;
+
+static _Atomic(WordFilter *) current_filter;
+static atomic_uint reader_epoch;
+static ReaderCounter readers[2];
+
+static char filter_path[PATH_MAX];
+static struct stat last_stat;
+static bool have_stat = false;
+
+static sem_t reload_sem;
+static pthread_t reload_thread;
+static atomic_bool reload_requested;
+static atomic_bool reload_running;
+
+static WordFilter *load_from_file(const char *path, int *word_count)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return NULL;
+
+    int capacity = 64, count = 0;
+    char **words = malloc((size_t)capacity * sizeof(char *));
+    char line[MODERATION_MAX_WORD_SIZE + 2];
+
+    while (words && fgets(line, sizeof(line), file))
+    {
+        char *start = line;
+        while (*start == ' ' || *start == '\t')
+            start++;
+
+        size_t length = strcspn(start, "\r\n");
+        while (length > 0 && (start[length - 1] == ' ' || start[length - 1] == '\t'))
+            length--;
+        start[length] = '\0';
+
+        if (length == 0 || start[0] == '#')
+            continue;
+
+        if (count == capacity)
+        {
+            capacity *= 2;
+            char **grown = realloc(words, (size_t)capacity * sizeof(char *));
+            if (!grown)
+                break;
+            words = grown;
+        }
+        words[count] = strdup(start);
+        if (words[count])
+            count++;
+    }
+    fclose(file);
+
+    WordFilter *filter = words ? word_filter_create((const char *const *)words, count) : NULL;
+
+    for (int i = 0; i < count; i++)
+        free(words[i]);
+    free(words);
+
+    *word_count = count;
+    return filter;
+}
+
+// Espera até que nenhum leitor que possa ter visto o filtro antigo continue ativo.
+// Duas trocas de época garantem que os dois contadores foram drenados ao menos uma vez.
+static void wait_for_readers(void)
+{
+    for (int phase = 0; phase < 2; phase++)
+    {
+        unsigned int old = atomic_fetch_add(&reader_epoch, 1) & 1;
+        while (atomic_load(&readers[old].count) != 0)
+        {
+            struct timespec pause = {0, 100000};
+            nanosleep(&pause, NULL);
+        }
+    }
+}
+
+static void publish(WordFilter *filter)
+{
+    WordFilter *old = atomic_exchange(&current_filter, filter);
+    if (old)
+    {
+        wait_for_readers();
+        word_filter_destroy(old);
+    }
+}
+
+static bool file_changed(void)
+{
+    struct stat st;
+    if (stat(filter_path, &st) != 0)
+        return false;
+
+    bool changed = !have_stat ||
+                   st.st_mtim.tv_sec != last_stat.st_mtim.tv_sec ||
+                   st.st_mtim.tv_nsec != last_stat.st_mtim.tv_nsec ||
+                   st.st_size != last_stat.st_size ||
+                   st.st_ino != last_stat.st_ino;
+    last_stat = st;
+    have_stat = true;
+    return changed;
+}
+
+static void reload(void)
+{
+    int count = 0;
+    WordFilter *filter = load_from_file(filter_path, &count);
+    if (!filter)
+    {
+        TSLOG_WARN(TSLOG_CAT_GENERAL, "Falha ao recarregar filtro de %s, mantendo o atual", filter_path);
+        return;
+    }
+
+    publish(filter);
+    TSLOG_INFO(TSLOG_CAT_GENERAL, "Filtro de palavras recarregado: %d palavras (%s)", count, filter_path);
+}
+
+static void *reload_worker(void *arg)
+{
+    (void)arg;
+
+    while (atomic_load(&reload_running))
+    {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += MODERATION_POLL_SECONDS;
+
+        while (sem_timedwait(&reload_sem, &deadline) != 0 && errno == EINTR)
+            ;
+
+        if (!atomic_load(&reload_running))
+            break;
+
+        bool forced = atomic_exchange(&reload_requested, false);
+        if (file_changed() || forced)
+            reload();
+    }
+
+    return NULL;
+}
+
+int moderation_init(const char *path)
+{
+    const char *source = path ? path : MODERATION_DEFAULT_FILE;
+    if (strlen(source) >= sizeof(filter_path))
+        return -1;
+    strcpy(filter_path, source);
+
+    int count = 0;
+    WordFilter *filter = load_from_file(filter_path, &count);
+    if (filter)
+    {
+        file_changed();
+        TSLOG_INFO(TSLOG_CAT_GENERAL, "Filtro de palavras carregado de %s: %d palavras (pré-filtro %s)",
+                   filter_path, count, word_filter_simd_level());
+    }
+    else
+    {
+        count = 0;
+        while (default_words[count] != NULL)
+            count++;
+        filter = word_filter_create(default_words, count);
+        if (!filter)
+            return -1;
+        TSLOG_WARN(TSLOG_CAT_GENERAL, "Arquivo %s indisponível, usando lista embutida (%d palavras)",
+                   filter_path, count);
+    }
+
+    atomic_store(&current_filter, filter);
+
+    if (sem_init(&reload_sem, 0, 0) != 0)
+        return -1;
+
+    atomic_store(&reload_running, true);
+    if (pthread_create(&reload_thread, NULL, reload_worker, NULL) != 0)
+    {
+        atomic_store(&reload_running, false);
+        sem_destroy(&reload_sem);
+        return -1;
+    }
+
+    return 0;
+}
+
+int moderation_contains_profanity(const char *text, size_t length)
+{
+    unsigned int idx = atomic_load(&reader_epoch) & 1;
+    atomic_fetch_add(&readers[idx].count, 1);
+
+    int result = word_filter_contains(atomic_load(&current_filter), text, length);
+
+    atomic_fetch_sub(&readers[idx].count, 1);
+    return result;
+}
+
+void moderation_request_reload(void)
+{
+    atomic_store(&reload_requested, true);
+    sem_post(&reload_sem);
+}
+
+int moderation_word_count(void)
+{
+    unsigned int idx = atomic_load(&reader_epoch) & 1;
+    atomic_fetch_add(&readers[idx].count, 1);
+
+    int count = word_filter_word_count(atomic_load(&current_filter));
+
+    atomic_fetch_sub(&readers[idx].count, 1);
+    return count;
+}
+
+void moderation_shutdown(void)
+{
+    if (atomic_exchange(&reload_running, false))
+    {
+        sem_post(&reload_sem);
+        pthread_join(reload_thread, NULL);
+        sem_destroy(&reload_sem);
+    }
+
+    publish(NULL);
+}
@@ -0,0 +1,25 @@
+#ifndef MODERATION_H
+#define MODERATION_H
+
+#include <stddef.h>
+
+#define MODERATION_DEFAULT_FILE "filter_words.txt"
+#define MODERATION_POLL_SECONDS 2
+#define MODERATION_MAX_WORD_SIZE 128
+
+// Carrega a lista (ou a lista embutida, se o arquivo não existir) e inicia a
+// thread que recompila o filtro quando o arquivo muda ou um reload é pedido.
+int moderation_init(const char *path);
+
+// Nunca bloqueia: o filtro publicado é lido sem mutex e só é liberado depois
+// que todas as leituras em andamento terminam.
+int moderation_contains_profanity(const char *text, size_t length);
+
+// Seguro para chamar de dentro de um signal handler (SIGHUP)
+void moderation_request_reload(void);
+
+int moderation_word_count(void);
+
+void moderation_shutdown(void);
+
+#endif
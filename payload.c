@@ -0,0 +1,35 @@
+#include "payload.h"
+#include <stdlib.h>
+#include <string.h>
+
+Payload *payload_create(const char *data, size_t length, int room_id, time_t timestamp)
+{
+    if (!data)
+        return NULL;
+
+    Payload *payload = malloc(sizeof(Payload) + length + 1);
+    if (!payload)
+        return NULL;
+
+    atomic_init(&payload->refs, 1);
+    payload->room_id = room_id;
+    payload->timestamp = timestamp;
+    payload->length = length;
+    payload->journal_offset = PAYLOAD_NO_OFFSET;
+    memcpy(payload->data, data, length);
+    payload->data[length] = '\0';
+    return payload;
+}
+
+Payload *payload_ref(Payload *payload)
+{
+    if (payload)
+        atomic_fetch_add_explicit(&payload->refs, 1, memory_order_relaxed);
+    return payload;
+}
+
+void payload_unref(Payload *payload)
+{
+    if (payload && atomic_fetch_sub_explicit(&payload->refs, 1, memory_order_acq_rel) == 1)
+        free(payload);
+}
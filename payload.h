@@ -0,0 +1,31 @@
+#ifndef PAYLOAD_H
+#define PAYLOAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+// Buffer imutável com contagem de referências: os mesmos bytes enviados no
+// broadcast ficam no histórico sem cópia. Fora journal_offset, preenchido
+// antes de entrar no histórico, nunca é alterado depois de criado.
+typedef struct
+{
+    atomic_int refs;
+    int room_id;
+    time_t timestamp;
+    size_t length;
+    uint64_t journal_offset; // PAYLOAD_NO_OFFSET se não foi para o journal
+    char data[]; // Terminado em '\0' (não contado em length)
+} Payload;
+
+#define PAYLOAD_NO_OFFSET UINT64_MAX
+
+// Cria com uma referência pertencente a quem chamou
+Payload *payload_create(const char *data, size_t length, int room_id, time_t timestamp);
+
+Payload *payload_ref(Payload *payload);
+
+void payload_unref(Payload *payload);
+
+#endif
@@ -0,0 +1,213 @@
+#include "pipeline.h"
+#include "tslog.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    PipelineStage *stage;
+    int index;
+} WorkerArgs;
+
+static bool is_stop_message(const Message *msg)
+{
+    return msg->sender_fd == -1 && strcmp(msg->content, "SHUTDOWN") == 0;
+}
+
+static void *pipeline_worker(void *arg)
+{
+    WorkerArgs *args = arg;
+    PipelineStage *stage = args->stage;
+    ThreadSafeQueue *queue = &stage->queues[args->index];
+    free(args);
+
+    Message msg;
+    while (tsqueue_dequeue(queue, &msg) == 0)
+    {
+        if (is_stop_message(&msg))
+            break;
+
+        uint64_t started = latency_now_ns();
+        latency_histogram_record(&stage->queue_latency, started - msg.enqueue_ns);
+
+        const char *failed = NULL;
+        for (int i = 0; i < stage->check_count && !failed; i++)
+        {
+            if (stage->checks[i].fn(&msg) != 0)
+            {
+                atomic_fetch_add_explicit(&stage->checks[i].rejected, 1, memory_order_relaxed);
+                failed = stage->checks[i].name;
+            }
+        }
+
+        latency_histogram_record(&stage->check_latency, latency_now_ns() - started);
+
+        if (failed)
+        {
+            atomic_fetch_add_explicit(&stage->rejected, 1, memory_order_relaxed);
+            if (stage->on_reject)
+                stage->on_reject(&msg, failed);
+        }
+        else
+        {
+            atomic_fetch_add_explicit(&stage->accepted, 1, memory_order_relaxed);
+            if (stage->on_accept)
+                stage->on_accept(&msg);
+        }
+    }
+
+    return NULL;
+}
+
+// Cada worker drena sua fila até encontrar a mensagem de parada
+static void stop_workers(PipelineStage *stage, int count)
+{
+    Message stop_msg;
+    memset(&stop_msg, 0, sizeof(stop_msg));
+    strcpy(stop_msg.content, "SHUTDOWN");
+    stop_msg.sender_fd = -1;
+
+    for (int i = 0; i < count; i++)
+        tsqueue_enqueue(&stage->queues[i], &stop_msg);
+
+    for (int i = 0; i < count; i++)
+        pthread_join(stage->threads[i], NULL);
+}
+
+int pipeline_stage_init(PipelineStage *stage, int workers,
+                        PipelineAcceptFn on_accept, PipelineRejectFn on_reject)
+{
+    if (!stage)
+        return -1;
+
+    if (workers <= 0)
+        workers = PIPELINE_DEFAULT_WORKERS;
+    if (workers > PIPELINE_MAX_WORKERS)
+        workers = PIPELINE_MAX_WORKERS;
+
+    memset(stage, 0, sizeof(*stage));
+    stage->queues = calloc((size_t)workers, sizeof(ThreadSafeQueue));
+    stage->threads = calloc((size_t)workers, sizeof(pthread_t));
+    if (!stage->queues || !stage->threads)
+    {
+        free(stage->queues);
+        free(stage->threads);
+        return -1;
+    }
+
+    for (int i = 0; i < workers; i++)
+    {
+        if (tsqueue_init(&stage->queues[i]) != 0)
+        {
+            for (int j = 0; j < i; j++)
+                tsqueue_destroy(&stage->queues[j]);
+            free(stage->queues);
+            free(stage->threads);
+            return -1;
+        }
+    }
+
+    stage->worker_count = workers;
+    stage->on_accept = on_accept;
+    stage->on_reject = on_reject;
+    latency_histogram_init(&stage->queue_latency);
+    latency_histogram_init(&stage->check_latency);
+    return 0;
+}
+
+int pipeline_stage_add_check(PipelineStage *stage, const char *name, PipelineCheck check)
+{
+    if (!stage || !check || stage->running || stage->check_count >= PIPELINE_MAX_CHECKS)
+        return -1;
+
+    PipelineCheckEntry *entry = &stage->checks[stage->check_count++];
+    entry->name = name;
+    entry->fn = check;
+    atomic_init(&entry->rejected, 0);
+    return 0;
+}
+
+int pipeline_stage_start(PipelineStage *stage)
+{
+    if (!stage || stage->running)
+        return -1;
+
+    for (int i = 0; i < stage->worker_count; i++)
+    {
+        WorkerArgs *args = malloc(sizeof(WorkerArgs));
+        if (args)
+        {
+            args->stage = stage;
+            args->index = i;
+        }
+
+        if (!args || pthread_create(&stage->threads[i], NULL, pipeline_worker, args) != 0)
+        {
+            free(args);
+            stop_workers(stage, i);
+            return -1;
+        }
+    }
+
+    stage->running = true;
+    TSLOG_INFO(TSLOG_CAT_BROADCAST, "Estágio de moderação iniciado com %d workers", stage->worker_count);
+    return 0;
+}
+
+int pipeline_stage_submit(PipelineStage *stage, Message *msg)
+{
+    if (!stage || !msg || msg->sender_fd < 0)
+        return -1;
+
+    int shard = msg->sender_fd % stage->worker_count;
+    msg->enqueue_ns = latency_now_ns();
+    return tsqueue_enqueue(&stage->queues[shard], msg);
+}
+
+int pipeline_stage_depth(PipelineStage *stage)
+{
+    if (!stage)
+        return -1;
+
+    int depth = 0;
+    for (int i = 0; i < stage->worker_count; i++)
+        depth += tsqueue_size(&stage->queues[i]);
+    return depth;
+}
+
+void pipeline_stage_get_stats(PipelineStage *stage, PipelineStats *stats)
+{
+    if (!stage || !stats)
+        return;
+
+    stats->depth = pipeline_stage_depth(stage);
+    stats->accepted = atomic_load_explicit(&stage->accepted, memory_order_relaxed);
+    stats->rejected = atomic_load_explicit(&stage->rejected, memory_order_relaxed);
+    stats->queue_p50_ns = latency_histogram_percentile(&stage->queue_latency, 0.50);
+    stats->queue_p99_ns = latency_histogram_percentile(&stage->queue_latency, 0.99);
+    stats->check_p50_ns = latency_histogram_percentile(&stage->check_latency, 0.50);
+    stats->check_p99_ns = latency_histogram_percentile(&stage->check_latency, 0.99);
+}
+
+void pipeline_stage_stop(PipelineStage *stage)
+{
+    if (!stage || !stage->running)
+        return;
+
+    stop_workers(stage, stage->worker_count);
+    stage->running = false;
+}
+
+void pipeline_stage_destroy(PipelineStage *stage)
+{
+    if (!stage || !stage->queues)
+        return;
+
+    for (int i = 0; i < stage->worker_count; i++)
+        tsqueue_destroy(&stage->queues[i]);
+
+    free(stage->queues);
+    free(stage->threads);
+    stage->queues = NULL;
+    stage->threads = NULL;
+}
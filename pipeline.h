@@ -0,0 +1,77 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "thread_safe_queue.h"
+#include "latency_histogram.h"
+
+#define PIPELINE_MAX_CHECKS 8
+#define PIPELINE_MAX_WORKERS 16
+#define PIPELINE_DEFAULT_WORKERS 4
+
+// Retorna 0 se a mensagem pode seguir; diferente de 0 rejeita
+typedef int (*PipelineCheck)(const Message *msg);
+
+// Chamadas pela thread do worker, na ordem de chegada de cada remetente
+typedef void (*PipelineAcceptFn)(Message *msg);
+typedef void (*PipelineRejectFn)(const Message *msg, const char *check_name);
+
+typedef struct
+{
+    const char *name;
+    PipelineCheck fn;
+    atomic_uint_fast64_t rejected;
+} PipelineCheckEntry;
+
+// Estágio entre a leitura do socket e o broadcast_worker. Cada remetente é
+// mapeado sempre para o mesmo worker (fila própria), preservando sua ordem.
+typedef struct
+{
+    ThreadSafeQueue *queues;
+    pthread_t *threads;
+    int worker_count;
+    bool running;
+
+    PipelineCheckEntry checks[PIPELINE_MAX_CHECKS];
+    int check_count;
+    PipelineAcceptFn on_accept;
+    PipelineRejectFn on_reject;
+
+    atomic_uint_fast64_t accepted;
+    atomic_uint_fast64_t rejected;
+    LatencyHistogram queue_latency;  // submit -> worker
+    LatencyHistogram check_latency;  // tempo executando as verificações
+} PipelineStage;
+
+typedef struct
+{
+    int depth;
+    uint64_t accepted;
+    uint64_t rejected;
+    uint64_t queue_p50_ns;
+    uint64_t queue_p99_ns;
+    uint64_t check_p50_ns;
+    uint64_t check_p99_ns;
+} PipelineStats;
+
+int pipeline_stage_init(PipelineStage *stage, int workers,
+                        PipelineAcceptFn on_accept, PipelineRejectFn on_reject);
+
+int pipeline_stage_add_check(PipelineStage *stage, const char *name, PipelineCheck check);
+
+int pipeline_stage_start(PipelineStage *stage);
+
+int pipeline_stage_submit(PipelineStage *stage, Message *msg);
+
+int pipeline_stage_depth(PipelineStage *stage);
+
+void pipeline_stage_get_stats(PipelineStage *stage, PipelineStats *stats);
+
+void pipeline_stage_stop(PipelineStage *stage);
+
+void pipeline_stage_destroy(PipelineStage *stage);
+
+#endif
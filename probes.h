@@ -0,0 +1,33 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+// Tracepoints USDT (provedor "chat") para bpftrace/perf. Com <sys/sdt.h>
+// disponível cada probe vira um único nop mais uma nota ELF; sem ele (ou com
+// -DCHAT_NO_USDT) os argumentos nem são avaliados.
+//
+//   bpftrace -e 'usdt:./server:chat:message_ingest { @[arg0] = count(); }'
+//   perf probe -x ./server sdt_chat:broadcast_end
+
+#if !defined(CHAT_NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define CHAT_USDT_ENABLED 1
+#endif
+#endif
+
+#ifdef CHAT_USDT_ENABLED
+
+#define CHAT_PROBE1(name, a) DTRACE_PROBE1(chat, name, a)
+#define CHAT_PROBE2(name, a, b) DTRACE_PROBE2(chat, name, a, b)
+#define CHAT_PROBE3(name, a, b, c) DTRACE_PROBE3(chat, name, a, b, c)
+
+#else
+
+// sizeof não avalia a expressão, mas evita avisos de variável sem uso
+#define CHAT_PROBE1(name, a) ((void)sizeof(a))
+#define CHAT_PROBE2(name, a, b) ((void)sizeof(a), (void)sizeof(b))
+#define CHAT_PROBE3(name, a, b, c) ((void)sizeof(a), (void)sizeof(b), (void)sizeof(c))
+
+#endif
+
+#endif
@@ -0,0 +1,145 @@
+#include "rate_limiter.h"
+#include <stdio.h>
+#include <time.h>
+
+#define MILLI_TOKENS 1000u
+
+static const char *class_names[RATE_CLASS_COUNT] = {"broadcast", "privada", "comando"};
+
+static const RateLimitConfig default_configs[RATE_CLASS_COUNT] = {
+    {.rate = 5, .burst = 10},  // RATE_CLASS_BROADCAST
+    {.rate = 5, .burst = 10},  // RATE_CLASS_PRIVATE
+    {.rate = 10, .burst = 20}, // RATE_CLASS_COMMAND
+};
+
+// Relógio grosso (resolução de um tick do kernel) basta para fichas por segundo
+static uint32_t coarse_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u);
+}
+
+static uint64_t pack(uint32_t time_ms, uint32_t milli_tokens)
+{
+    return ((uint64_t)time_ms << 32) | milli_tokens;
+}
+
+void rate_limiter_init(RateLimiter *limiter)
+{
+    if (!limiter)
+        return;
+
+    for (int c = 0; c < RATE_CLASS_COUNT; c++)
+    {
+        limiter->classes[c] = default_configs[c];
+        atomic_init(&limiter->allowed[c], 0);
+        atomic_init(&limiter->delayed[c], 0);
+        atomic_init(&limiter->rejected[c], 0);
+    }
+    limiter->policy = RATE_POLICY_REJECT;
+    limiter->max_delay_ms = RATE_DEFAULT_MAX_DELAY_MS;
+}
+
+int rate_limiter_configure(RateLimiter *limiter, RateClass rate_class, const char *spec)
+{
+    if (!limiter || rate_class >= RATE_CLASS_COUNT || !spec)
+        return -1;
+
+    unsigned int rate, burst;
+    int fields = sscanf(spec, "%u/%u", &rate, &burst);
+    if (fields < 1)
+        return -1;
+    if (fields == 1)
+        burst = rate;
+
+    // O estado guarda mili-fichas em 32 bits
+    if (burst == 0 && rate > 0)
+        burst = 1;
+    if (burst > UINT32_MAX / MILLI_TOKENS)
+        return -1;
+
+    limiter->classes[rate_class].rate = rate;
+    limiter->classes[rate_class].burst = burst;
+    return 0;
+}
+
+void rate_limiter_connection_init(const RateLimiter *limiter, ConnectionRateState *state)
+{
+    if (!limiter || !state)
+        return;
+
+    uint32_t now = coarse_now_ms();
+    for (int c = 0; c < RATE_CLASS_COUNT; c++)
+        atomic_init(&state->buckets[c].state, pack(now, limiter->classes[c].burst * MILLI_TOKENS));
+}
+
+// Tenta tirar uma ficha. Retorna 0 se conseguiu, senão quantos ms faltam para a próxima
+static uint32_t bucket_take(TokenBucket *bucket, const RateLimitConfig *config)
+{
+    uint64_t capacity = (uint64_t)config->burst * MILLI_TOKENS;
+    uint64_t old = atomic_load_explicit(&bucket->state, memory_order_relaxed);
+
+    for (;;)
+    {
+        uint32_t now = coarse_now_ms();
+        uint32_t last = (uint32_t)(old >> 32);
+        uint64_t tokens = (uint32_t)old;
+
+        // Subtração sem sinal trata a volta do contador de 32 bits
+        uint32_t elapsed = now - last;
+        tokens += (uint64_t)elapsed * config->rate; // rate fichas/s = rate mili-fichas/ms
+        if (tokens > capacity)
+            tokens = capacity;
+
+        if (tokens < MILLI_TOKENS)
+        {
+            // Nada a gravar: o tempo decorrido continua contando a partir de last
+            return (uint32_t)((MILLI_TOKENS - tokens + config->rate - 1) / config->rate);
+        }
+
+        uint64_t updated = pack(now, (uint32_t)(tokens - MILLI_TOKENS));
+        if (atomic_compare_exchange_weak_explicit(&bucket->state, &old, updated,
+                                                  memory_order_relaxed, memory_order_relaxed))
+            return 0;
+    }
+}
+
+bool rate_limiter_admit(RateLimiter *limiter, ConnectionRateState *state, RateClass rate_class)
+{
+    if (!limiter || !state || rate_class >= RATE_CLASS_COUNT)
+        return true;
+
+    const RateLimitConfig *config = &limiter->classes[rate_class];
+    if (config->rate == 0)
+    {
+        atomic_fetch_add_explicit(&limiter->allowed[rate_class], 1, memory_order_relaxed);
+        return true;
+    }
+
+    uint32_t wait_ms = bucket_take(&state->buckets[rate_class], config);
+    if (wait_ms > 0 && limiter->policy == RATE_POLICY_DELAY && wait_ms <= limiter->max_delay_ms)
+    {
+        atomic_fetch_add_explicit(&limiter->delayed[rate_class], 1, memory_order_relaxed);
+        do
+        {
+            struct timespec pause = {.tv_sec = wait_ms / 1000, .tv_nsec = (long)(wait_ms % 1000) * 1000000L};
+            nanosleep(&pause, NULL);
+            wait_ms = bucket_take(&state->buckets[rate_class], config);
+        } while (wait_ms > 0 && wait_ms <= limiter->max_delay_ms);
+    }
+
+    if (wait_ms > 0)
+    {
+        atomic_fetch_add_explicit(&limiter->rejected[rate_class], 1, memory_order_relaxed);
+        return false;
+    }
+
+    atomic_fetch_add_explicit(&limiter->allowed[rate_class], 1, memory_order_relaxed);
+    return true;
+}
+
+const char *rate_class_name(RateClass rate_class)
+{
+    return rate_class < RATE_CLASS_COUNT ? class_names[rate_class] : "?";
+}
@@ -0,0 +1,65 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define RATE_DEFAULT_MAX_DELAY_MS 1000
+
+typedef enum
+{
+    RATE_CLASS_BROADCAST,
+    RATE_CLASS_PRIVATE,
+    RATE_CLASS_COMMAND,
+    RATE_CLASS_COUNT
+} RateClass;
+
+typedef enum
+{
+    RATE_POLICY_REJECT, // Descarta o excesso
+    RATE_POLICY_DELAY   // Segura a leitura até haver ficha (até max_delay_ms)
+} RatePolicy;
+
+typedef struct
+{
+    uint32_t rate;  // Fichas por segundo (0 = sem limite)
+    uint32_t burst; // Capacidade do balde
+} RateLimitConfig;
+
+// Estado do balde num único inteiro de 64 bits, atualizado por CAS:
+// 32 bits altos = último reabastecimento (ms), 32 baixos = mili-fichas
+typedef struct
+{
+    atomic_uint_fast64_t state;
+} TokenBucket;
+
+typedef struct
+{
+    TokenBucket buckets[RATE_CLASS_COUNT];
+} ConnectionRateState;
+
+typedef struct
+{
+    RateLimitConfig classes[RATE_CLASS_COUNT];
+    RatePolicy policy;
+    uint32_t max_delay_ms;
+
+    atomic_uint_fast64_t allowed[RATE_CLASS_COUNT];
+    atomic_uint_fast64_t delayed[RATE_CLASS_COUNT];
+    atomic_uint_fast64_t rejected[RATE_CLASS_COUNT];
+} RateLimiter;
+
+void rate_limiter_init(RateLimiter *limiter);
+
+// spec no formato "taxa/rajada", ex.: "5/10"
+int rate_limiter_configure(RateLimiter *limiter, RateClass rate_class, const char *spec);
+
+void rate_limiter_connection_init(const RateLimiter *limiter, ConnectionRateState *state);
+
+// true se a mensagem pode seguir (possivelmente depois de esperar, na política DELAY)
+bool rate_limiter_admit(RateLimiter *limiter, ConnectionRateState *state, RateClass rate_class);
+
+const char *rate_class_name(RateClass rate_class);
+
+#endif
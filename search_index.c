@@ -0,0 +1,597 @@
+#include "search_index.h"
+#include "tslog.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SEARCH_READ_CHUNK (1024 * 1024)
+#define SEARCH_MAX_FILL (SEARCH_SLOTS / 10 * 9) // Sondagem linear degrada acima disso
+
+static size_t file_size_for(uint64_t capacity)
+{
+    return sizeof(SearchIndexHeader) + (size_t)SEARCH_SLOTS * sizeof(SearchSlot) +
+           (size_t)capacity * sizeof(SearchPosting);
+}
+
+static unsigned char fold(unsigned char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + ('a' - 'A')) : c;
+}
+
+// Letras, dígitos e bytes UTF-8 (>= 0x80) formam palavras; o resto separa
+static bool is_word_byte(unsigned char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+static uint64_t term_hash(const unsigned char *term, size_t length)
+{
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < length; i++)
+    {
+        h ^= fold(term[i]);
+        h *= 1099511628211ULL;
+    }
+    return h ? h : 1;
+}
+
+// Hashes distintos dos termos do texto; retorna quantos foram extraídos
+static int extract_terms(const char *text, size_t length, uint64_t *terms, int max_terms)
+{
+    const unsigned char *p = (const unsigned char *)text;
+    int count = 0;
+    size_t i = 0;
+
+    while (i < length && count < max_terms)
+    {
+        while (i < length && !is_word_byte(p[i]))
+            i++;
+        size_t start = i;
+        while (i < length && is_word_byte(p[i]))
+            i++;
+
+        size_t term_length = i - start;
+        if (term_length < SEARCH_MIN_TERM_LENGTH || term_length > SEARCH_MAX_TERM_LENGTH)
+            continue;
+
+        uint64_t h = term_hash(p + start, term_length);
+        bool seen = false;
+        for (int t = 0; t < count && !seen; t++)
+            seen = terms[t] == h;
+        if (!seen)
+            terms[count++] = h;
+    }
+    return count;
+}
+
+// Mapeia o arquivo com o tamanho dado; o mapeamento anterior (se houver)
+// continua válido até quem chamou desfazê-lo
+static int map_file(SearchIndex *index, size_t size)
+{
+    if (ftruncate(index->fd, (off_t)size) != 0)
+        return -1;
+
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, index->fd, 0);
+    if (map == MAP_FAILED)
+        return -1;
+
+    index->map = map;
+    index->map_size = size;
+    index->header = map;
+    index->slots = (SearchSlot *)((char *)map + sizeof(SearchIndexHeader));
+    index->postings = (SearchPosting *)(index->slots + SEARCH_SLOTS);
+    return 0;
+}
+
+static void reset_index(SearchIndex *index)
+{
+    memset(index->slots, 0, (size_t)SEARCH_SLOTS * sizeof(SearchSlot));
+    index->header->magic = SEARCH_MAGIC;
+    index->header->slot_count = SEARCH_SLOTS;
+    index->header->indexed_offset = 0;
+    index->header->postings_used = 0;
+    index->header->terms = 0;
+    index->header->pruned_offset = 0;
+}
+
+// Chamada com o lock de escrita. Mapeia o arquivo maior antes de soltar o
+// antigo: se falhar, o índice segue no mapeamento atual e para de crescer.
+static int grow_postings(SearchIndex *index)
+{
+    void *old_map = index->map;
+    size_t old_size = index->map_size;
+    uint64_t capacity = index->header->postings_capacity * 2;
+
+    if (map_file(index, file_size_for(capacity)) != 0)
+    {
+        TSLOG_ERROR(TSLOG_CAT_GENERAL, "Falha ao expandir índice de busca: %s; indexação interrompida",
+                    strerror(errno));
+        if (ftruncate(index->fd, (off_t)old_size) != 0)
+            TSLOG_WARN(TSLOG_CAT_GENERAL, "Falha ao restaurar tamanho do índice: %s", strerror(errno));
+        index->full = true;
+        return -1;
+    }
+
+    munmap(old_map, old_size);
+    index->header->postings_capacity = capacity;
+    return 0;
+}
+
+static SearchSlot *find_slot(SearchIndex *index, uint64_t h, bool create)
+{
+    uint32_t slot = (uint32_t)h & (SEARCH_SLOTS - 1);
+    while (index->slots[slot].term_hash != 0)
+    {
+        if (index->slots[slot].term_hash == h)
+            return &index->slots[slot];
+        slot = (slot + 1) & (SEARCH_SLOTS - 1);
+    }
+
+    if (!create || index->header->terms >= SEARCH_MAX_FILL)
+        return NULL;
+
+    index->slots[slot].term_hash = h;
+    index->header->terms++;
+    return &index->slots[slot];
+}
+
+// Retorna false se o índice não pôde crescer (registro não indexado)
+static bool index_record(SearchIndex *index, const JournalRecord *record)
+{
+    uint64_t terms[SEARCH_MAX_MESSAGE_TERMS];
+    int count = extract_terms(record->data, record->length, terms, SEARCH_MAX_MESSAGE_TERMS);
+
+    pthread_rwlock_wrlock(&index->lock);
+
+    while (index->header->postings_used + (uint64_t)count > index->header->postings_capacity)
+    {
+        if (grow_postings(index) != 0)
+        {
+            pthread_rwlock_unlock(&index->lock);
+            return false;
+        }
+    }
+
+    for (int t = 0; t < count; t++)
+    {
+        SearchSlot *slot = find_slot(index, terms[t], true);
+        if (!slot)
+        {
+            if (!index->terms_full)
+                TSLOG_WARN(TSLOG_CAT_GENERAL, "Índice de busca: tabela de termos cheia (%llu); termos novos "
+                           "ficam fora da busca até a próxima poda",
+                           (unsigned long long)index->header->terms);
+            index->terms_full = true;
+            continue;
+        }
+
+        // Inserção na cabeça: cada lista fica da mensagem mais nova para a mais antiga
+        uint64_t posting = index->header->postings_used++;
+        index->postings[posting].journal_offset = record->offset;
+        index->postings[posting].next = slot->head;
+        slot->head = posting + 1;
+        slot->count++;
+    }
+
+    index->header->indexed_offset = record->offset + sizeof(JournalRecordHeader) +
+                                    record->room_length + record->length;
+
+    pthread_rwlock_unlock(&index->lock);
+    return true;
+}
+
+// Chamada com o lock de escrita. Descarta postings de registros que o journal
+// já liberou, compactando o vetor na mesma ordem, e refaz a tabela de termos
+// sem os que ficaram vazios (sondagem linear não aceita remoção simples).
+static void prune_locked(SearchIndex *index, uint64_t first)
+{
+    uint64_t used = index->header->postings_used;
+    uint64_t *remap = malloc((size_t)(used > 0 ? used : 1) * sizeof(uint64_t)); // Nova posição + 1, 0 = descartado
+    SearchSlot *live = malloc((size_t)SEARCH_SLOTS * sizeof(SearchSlot));
+    if (!remap || !live)
+    {
+        free(remap);
+        free(live);
+        return;
+    }
+
+    // Novas posições nunca passam das antigas, então dá para mover no lugar
+    uint64_t kept = 0;
+    for (uint64_t i = 0; i < used; i++)
+    {
+        SearchPosting posting = index->postings[i];
+        if (posting.journal_offset < first)
+        {
+            remap[i] = 0;
+            continue;
+        }
+        remap[i] = kept + 1;
+        index->postings[kept].journal_offset = posting.journal_offset;
+        index->postings[kept].next = posting.next != 0 ? remap[posting.next - 1] : 0;
+        kept++;
+    }
+
+    uint64_t live_count = 0;
+    for (uint32_t s = 0; s < SEARCH_SLOTS; s++)
+    {
+        SearchSlot slot = index->slots[s];
+        if (slot.term_hash == 0 || slot.head == 0 || remap[slot.head - 1] == 0)
+            continue;
+
+        slot.head = remap[slot.head - 1];
+        slot.count = 0;
+        for (uint64_t p = slot.head; p != 0; p = index->postings[p - 1].next)
+            slot.count++;
+        live[live_count++] = slot;
+    }
+
+    memset(index->slots, 0, (size_t)SEARCH_SLOTS * sizeof(SearchSlot));
+    index->header->terms = 0;
+    for (uint64_t l = 0; l < live_count; l++)
+    {
+        SearchSlot *slot = find_slot(index, live[l].term_hash, true);
+        slot->head = live[l].head;
+        slot->count = live[l].count;
+    }
+
+    TSLOG_INFO(TSLOG_CAT_GENERAL, "Índice de busca podado até %llu: %llu de %llu postings e %llu termos mantidos",
+               (unsigned long long)first, (unsigned long long)kept, (unsigned long long)used,
+               (unsigned long long)live_count);
+
+    index->header->postings_used = kept;
+    index->header->pruned_offset = first;
+    index->terms_full = false;
+    index->full = false; // Com postings liberados a indexação pode voltar
+    index->generation++;
+    free(remap);
+    free(live);
+}
+
+// Poda quando a parte liberada do journal já pesa (um quarto do indexado
+// desde a última poda) ou quando a tabela de termos encheu
+static void maybe_prune(SearchIndex *index)
+{
+    uint64_t first = atomic_load_explicit(&index->journal->first_offset, memory_order_relaxed);
+    uint64_t pruned = index->header->pruned_offset;
+    if (first <= pruned)
+        return;
+
+    uint64_t indexed = index->header->indexed_offset;
+    uint64_t span = indexed > pruned ? indexed - pruned : 0;
+    if (!index->terms_full && !index->full && first - pruned < span / 4)
+        return;
+
+    pthread_rwlock_wrlock(&index->lock);
+    prune_locked(index, first);
+    pthread_rwlock_unlock(&index->lock);
+    msync(index->map, index->map_size, MS_ASYNC);
+}
+
+// Indexa o journal de indexed_offset até limit (sempre em fronteira de registro)
+static void index_range(SearchIndex *index, char *buffer, uint64_t limit)
+{
+    uint64_t offset = index->header->indexed_offset;
+
+    // O journal já liberou o começo (retenção): o que não foi indexado ficou de fora
+    uint64_t first = atomic_load_explicit(&index->journal->first_offset, memory_order_relaxed);
+    if (offset < first)
+    {
+        TSLOG_WARN(TSLOG_CAT_GENERAL, "Journal liberado até %llu antes de ser indexado; pulando %llu bytes",
+                   (unsigned long long)first, (unsigned long long)(first - offset));
+        pthread_rwlock_wrlock(&index->lock);
+        index->header->indexed_offset = first;
+        pthread_rwlock_unlock(&index->lock);
+        offset = first;
+    }
+
+    while (offset < limit)
+    {
+        size_t want = limit - offset < SEARCH_READ_CHUNK ? (size_t)(limit - offset) : SEARCH_READ_CHUNK;
+        ssize_t got = pread(index->journal_fd, buffer, want, (off_t)offset);
+        if (got <= 0)
+            break;
+
+        size_t consumed = 0;
+        JournalRecord record;
+        size_t length;
+        while ((length = journal_read_record(buffer + consumed, (size_t)got - consumed,
+                                             offset + consumed, &record)) > 0)
+        {
+            if (!index_record(index, &record))
+                break;
+            consumed += length;
+        }
+        if (index->full)
+            break;
+
+        if (consumed == 0)
+        {
+            TSLOG_WARN(TSLOG_CAT_GENERAL, "Registro inválido no journal (offset %llu); indexação pausada",
+                       (unsigned long long)offset);
+            break;
+        }
+        offset += consumed;
+    }
+
+    msync(index->map, index->map_size, MS_ASYNC);
+}
+
+static void *indexer_worker(void *arg)
+{
+    SearchIndex *index = arg;
+    char *buffer = malloc(SEARCH_READ_CHUNK);
+    if (!buffer)
+        return NULL;
+
+    pthread_mutex_lock(&index->wake_mutex);
+    while (index->running)
+    {
+        pthread_mutex_unlock(&index->wake_mutex);
+
+        uint64_t durable = atomic_load_explicit(&index->journal->durable_offset, memory_order_acquire);
+        if (!index->full && index->header->indexed_offset < durable)
+            index_range(index, buffer, durable);
+        maybe_prune(index);
+
+        pthread_mutex_lock(&index->wake_mutex);
+        if (!index->running)
+            break;
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (long)SEARCH_POLL_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&index->wake, &index->wake_mutex, &deadline);
+    }
+    pthread_mutex_unlock(&index->wake_mutex);
+
+    free(buffer);
+    return NULL;
+}
+
+int search_index_open(SearchIndex *index, const char *path, const char *journal_path)
+{
+    if (!index || !journal_path)
+        return -1;
+
+    memset(index, 0, sizeof(*index));
+    strncpy(index->path, path ? path : SEARCH_DEFAULT_PATH, sizeof(index->path) - 1);
+
+    index->journal_fd = open(journal_path, O_RDONLY);
+    if (index->journal_fd < 0)
+        return -1;
+
+    index->fd = open(index->path, O_RDWR | O_CREAT, 0644);
+    if (index->fd < 0)
+    {
+        close(index->journal_fd);
+        return -1;
+    }
+
+    SearchIndexHeader existing;
+    bool valid = pread(index->fd, &existing, sizeof(existing), 0) == (ssize_t)sizeof(existing) &&
+                 existing.magic == SEARCH_MAGIC && existing.slot_count == SEARCH_SLOTS &&
+                 existing.postings_capacity >= SEARCH_INITIAL_POSTINGS &&
+                 existing.postings_used <= existing.postings_capacity;
+
+    uint64_t capacity = valid ? existing.postings_capacity : SEARCH_INITIAL_POSTINGS;
+    if (!valid && ftruncate(index->fd, 0) != 0)
+    {
+        close(index->fd);
+        close(index->journal_fd);
+        return -1;
+    }
+
+    if (map_file(index, file_size_for(capacity)) != 0)
+    {
+        close(index->fd);
+        close(index->journal_fd);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(index->journal_fd, &st) != 0)
+        st.st_size = 0;
+
+    if (!valid || index->header->indexed_offset > (uint64_t)st.st_size)
+    {
+        if (valid)
+            TSLOG_WARN(TSLOG_CAT_GENERAL, "Índice de busca à frente do journal; reconstruindo");
+        reset_index(index);
+        index->header->postings_capacity = capacity;
+    }
+
+    pthread_rwlock_init(&index->lock, NULL);
+    pthread_mutex_init(&index->wake_mutex, NULL);
+    pthread_cond_init(&index->wake, NULL);
+
+    TSLOG_INFO(TSLOG_CAT_GENERAL, "Índice de busca %s: %llu termos, %llu postings, journal indexado até %llu",
+               index->path, (unsigned long long)index->header->terms,
+               (unsigned long long)index->header->postings_used,
+               (unsigned long long)index->header->indexed_offset);
+    return 0;
+}
+
+int search_index_start(SearchIndex *index, Journal *journal)
+{
+    if (!index || !index->map || !journal || index->running)
+        return -1;
+
+    index->journal = journal;
+    index->running = true;
+    if (pthread_create(&index->thread, NULL, indexer_worker, index) != 0)
+    {
+        index->running = false;
+        return -1;
+    }
+    return 0;
+}
+
+static bool read_candidate(SearchIndex *index, uint64_t offset, char *buffer, JournalRecord *record)
+{
+    JournalRecordHeader header;
+    if (pread(index->journal_fd, &header, sizeof(header), (off_t)offset) != (ssize_t)sizeof(header))
+        return false;
+
+    size_t total = sizeof(header) + header.room_length + (size_t)header.data_length;
+    if (total > JOURNAL_MAX_RECORD_SIZE ||
+        pread(index->journal_fd, buffer, total, (off_t)offset) != (ssize_t)total)
+        return false;
+
+    return journal_read_record(buffer, total, offset, record) == total;
+}
+
+int search_index_query(SearchIndex *index, const char *query, const char *room, SearchResult *results,
+                       int max_results)
+{
+    if (!index || !index->map || !query || !room || !results || max_results <= 0)
+        return -1;
+
+    size_t room_length = strlen(room);
+    uint64_t terms[SEARCH_MAX_QUERY_TERMS];
+    int term_count = extract_terms(query, strlen(query), terms, SEARCH_MAX_QUERY_TERMS);
+    if (term_count == 0)
+        return 0;
+
+    char *buffer = malloc(JOURNAL_MAX_RECORD_SIZE);
+    if (!buffer)
+        return -1;
+
+    // Percorre a lista do termo mais raro; as demais só confirmam. Os
+    // candidatos saem em rodadas (o journal é lido sem o lock) até achar
+    // max_results da sala ou ler SEARCH_MAX_RECORDS_READ registros: salas
+    // quietas não ficam sem resultado porque as outras encheram as rodadas.
+    uint64_t candidates[SEARCH_MAX_CANDIDATES];
+    uint64_t next = 0;          // Próximo posting da lista (índice + 1)
+    uint64_t generation = 0;
+    uint64_t lowest = UINT64_MAX;
+    int records_read = 0;
+    int found = 0;
+    bool started = false;
+
+    while (found < max_results && records_read < SEARCH_MAX_RECORDS_READ)
+    {
+        int candidate_count = 0;
+
+        pthread_rwlock_rdlock(&index->lock);
+
+        if (!started)
+        {
+            SearchSlot *driver = NULL;
+            for (int t = 0; t < term_count; t++)
+            {
+                SearchSlot *slot = find_slot(index, terms[t], false);
+                if (!slot)
+                {
+                    driver = NULL;
+                    break;
+                }
+                if (!driver || slot->count < driver->count)
+                    driver = slot;
+            }
+            next = driver ? driver->head : 0;
+            generation = index->generation;
+            started = true;
+        }
+        else if (generation != index->generation)
+        {
+            next = 0; // Poda no meio da consulta: as posições mudaram
+        }
+
+        // Reindexação após uma queda pode repetir registros no topo da lista; como
+        // a ordem real é decrescente, só aceita offsets abaixo do menor já visto
+        while (next != 0 && candidate_count < SEARCH_MAX_CANDIDATES &&
+               records_read + candidate_count < SEARCH_MAX_RECORDS_READ)
+        {
+            uint64_t offset = index->postings[next - 1].journal_offset;
+            next = index->postings[next - 1].next;
+            if (offset < lowest)
+            {
+                candidates[candidate_count++] = offset;
+                lowest = offset;
+            }
+        }
+
+        pthread_rwlock_unlock(&index->lock);
+
+        if (candidate_count == 0)
+            break;
+
+        for (int c = 0; c < candidate_count && found < max_results; c++)
+        {
+            records_read++;
+
+            JournalRecord record;
+            if (!read_candidate(index, candidates[c], buffer, &record))
+                continue;
+            if (record.room_length != room_length || memcmp(record.room, room, room_length) != 0)
+                continue;
+
+            uint64_t record_terms[SEARCH_MAX_MESSAGE_TERMS];
+            int record_term_count = extract_terms(record.data, record.length, record_terms,
+                                                  SEARCH_MAX_MESSAGE_TERMS);
+
+            bool match = true;
+            for (int t = 0; t < term_count && match; t++)
+            {
+                match = false;
+                for (int r = 0; r < record_term_count && !match; r++)
+                    match = record_terms[r] == terms[t];
+            }
+            if (!match)
+                continue;
+
+            SearchResult *result = &results[found++];
+            result->timestamp = record.timestamp;
+
+            size_t copied = room_length < sizeof(result->room) - 1 ? room_length : sizeof(result->room) - 1;
+            memcpy(result->room, record.room, copied);
+            result->room[copied] = '\0';
+
+            size_t text_length = record.length < sizeof(result->text) - 1 ? record.length : sizeof(result->text) - 1;
+            while (text_length > 0 && (record.data[text_length - 1] == '\n' || record.data[text_length - 1] == '\r'))
+                text_length--;
+            memcpy(result->text, record.data, text_length);
+            result->text[text_length] = '\0';
+        }
+    }
+
+    free(buffer);
+    return found;
+}
+
+void search_index_close(SearchIndex *index)
+{
+    if (!index || !index->map)
+        return;
+
+    if (index->running)
+    {
+        pthread_mutex_lock(&index->wake_mutex);
+        index->running = false;
+        pthread_cond_signal(&index->wake);
+        pthread_mutex_unlock(&index->wake_mutex);
+        pthread_join(index->thread, NULL);
+    }
+
+    TSLOG_INFO(TSLOG_CAT_GENERAL, "Índice de busca: %llu termos, %llu postings",
+               (unsigned long long)index->header->terms, (unsigned long long)index->header->postings_used);
+
+    msync(index->map, index->map_size, MS_SYNC);
+    munmap(index->map, index->map_size);
+    index->map = NULL;
+    close(index->fd);
+    close(index->journal_fd);
+
+    pthread_rwlock_destroy(&index->lock);
+    pthread_mutex_destroy(&index->wake_mutex);
+    pthread_cond_destroy(&index->wake);
+}
@@ -0,0 +1,96 @@
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include "journal.h"
+
+#define SEARCH_DEFAULT_PATH "chat.search"
+#define SEARCH_SLOTS 65536                // Termos distintos (potência de 2)
+#define SEARCH_INITIAL_POSTINGS 65536     // Cresce dobrando
+#define SEARCH_MAX_QUERY_TERMS 8
+#define SEARCH_MAX_MESSAGE_TERMS 128      // Termos distintos indexados por mensagem
+#define SEARCH_MIN_TERM_LENGTH 2
+#define SEARCH_MAX_TERM_LENGTH 32
+#define SEARCH_MAX_CANDIDATES 256         // Registros coletados por rodada da consulta
+#define SEARCH_MAX_RECORDS_READ 4096      // Limite de registros lidos por consulta
+#define SEARCH_MAX_RESULTS 10
+#define SEARCH_POLL_MS 200
+#define SEARCH_RESULT_TEXT_SIZE 512
+#define SEARCH_MAGIC 0x58444E49u // "INDX"
+
+typedef struct
+{
+    uint64_t term_hash; // 0 = slot livre
+    uint64_t head;      // Posting mais recente (índice + 1), 0 = vazia
+    uint64_t count;
+} SearchSlot;
+
+typedef struct
+{
+    uint64_t journal_offset; // Início do registro no journal
+    uint64_t next;           // Posting anterior do mesmo termo (índice + 1)
+} SearchPosting;
+
+// Layout do arquivo: cabeçalho, SEARCH_SLOTS slots, postings. Tudo em mmap
+// compartilhado, então o índice sobrevive a reinícios; indexed_offset diz até
+// onde o journal já foi processado.
+typedef struct
+{
+    uint32_t magic;
+    uint32_t slot_count;
+    uint64_t indexed_offset;
+    uint64_t postings_used;
+    uint64_t postings_capacity;
+    uint64_t terms;
+    uint64_t pruned_offset; // Postings abaixo disso já foram descartados (journal liberado)
+    uint8_t reserved[16];
+} SearchIndexHeader;
+
+typedef struct
+{
+    uint64_t timestamp;
+    char room[32];
+    char text[SEARCH_RESULT_TEXT_SIZE];
+} SearchResult;
+
+typedef struct
+{
+    char path[PATH_MAX];
+    int fd;
+    int journal_fd; // Leitura dos registros candidatos
+    void *map;
+    size_t map_size;
+    SearchIndexHeader *header;
+    SearchSlot *slots;
+    SearchPosting *postings;
+
+    Journal *journal;
+    pthread_rwlock_t lock; // Escrita: thread indexadora; leitura: consultas
+    pthread_mutex_t wake_mutex;
+    pthread_cond_t wake;
+    pthread_t thread;
+    bool running;
+    bool full; // Falha ao crescer: o índice fica como está e a indexação para
+    bool terms_full; // Tabela de termos cheia (avisado uma vez até a próxima poda)
+    uint64_t generation; // Muda a cada poda: posições de postings deixam de valer
+} SearchIndex;
+
+// Abre (ou cria) o índice. Se o journal for menor que o já indexado, o
+// índice é descartado e reconstruído.
+int search_index_open(SearchIndex *index, const char *path, const char *journal_path);
+
+// Inicia a thread que acompanha o journal, indexando só o que já passou por fdatasync
+int search_index_start(SearchIndex *index, Journal *journal);
+
+// Mensagens da sala room que contêm todos os termos, da mais nova para a mais antiga
+int search_index_query(SearchIndex *index, const char *query, const char *room, SearchResult *results,
+                       int max_results);
+
+void search_index_close(SearchIndex *index);
+
+#endif
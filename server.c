@@ -6,24 +6,76 @@
 #include <pthread.h>
 #include <signal.h>
 #include <errno.h>
+#include <ctype.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include "tslog.h"
 #include "thread_safe_queue.h"
 #include "client_manager.h"
+#include "moderation.h"
+#include "pipeline.h"
+#include "command_registry.h"
+#include "message_history.h"
+#include "journal.h"
+#include "mailbox.h"
+#include "search_index.h"
+#include "rate_limiter.h"
+#include "admission.h"
+#include "timer_wheel.h"
+#include "metrics.h"
+#include "probes.h"
+#include "flight_recorder.h"
+#include "capture.h"
 
 #define PORT 8080
 #define BACKLOG 10
 #define BUFFER_SIZE 1024
-
-const char *profanity_filter[] = {
-    "spam", "lixo", "idiota", "burro", "estupido",
-    "merda", "porra", "caralho", "fdp", "otario",
-    NULL};
+#define HISTORY_DEFAULT_REPLAY 20
+#define AUTH_TIMEOUT_DEFAULT_S 30
+#define HEARTBEAT_INTERVAL_DEFAULT_S 30
+#define IDLE_TIMEOUT_DEFAULT_S 600
+#define HEARTBEAT_PING "/ping\n"
+#define HEARTBEAT_PONG "/pong"
 
 static ClientManager client_manager;
 static ThreadSafeQueue message_queue;
+static PipelineStage moderation_stage;
+static CommandRegistry command_registry;
+static MessageHistory message_history;
+static Journal journal;
+static MailboxStore mailbox_store;
+static SearchIndex search_index;
+static RateLimiter rate_limiter;
+static AdmissionTable admission_table;
+static TimerWheel timer_wheel;
+static TrafficCapture traffic_capture;
+static uint32_t auth_timeout_ms;
+static uint32_t heartbeat_interval_ms;
+static uint32_t idle_timeout_ms;
+static atomic_uint_fast64_t auth_timeouts;
+static atomic_uint_fast64_t idle_disconnects;
+static atomic_uint_fast64_t heartbeat_disconnects;
+
+// Etapas de um broadcast, do recv até o último send
+typedef enum
+{
+    LATENCY_STAGE_INGEST, // recv -> fila de broadcast (leitura, limite, moderação)
+    LATENCY_STAGE_QUEUE,  // Espera na fila de broadcast
+    LATENCY_STAGE_FANOUT, // Retirada da fila -> último send
+    LATENCY_STAGE_TOTAL,  // recv -> último send
+    LATENCY_STAGE_COUNT
+} LatencyStage;
+
+static const char *latency_stage_names[LATENCY_STAGE_COUNT] = {"ingest", "queue", "fanout", "total"};
+static LatencyHistogram stage_latency[LATENCY_STAGE_COUNT];
 static pthread_t broadcast_thread;
 static volatile int server_running = 1;
+
+// Threads de cliente vivas: o encerramento espera todas antes de fechar
+// journal, índice e caixas que elas usam
+static int client_threads;
+static pthread_mutex_t client_threads_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t client_threads_done = PTHREAD_COND_INITIALIZER;
 static int server_socket = -1;
 
 void signal_handler(int sig)
@@ -31,19 +83,19 @@ void signal_handler(int sig)
     printf("\n[Servidor] Recebido sinal %d, finalizando graciosamente...\n", sig);
     server_running = 0;
 
+    // O SHUTDOWN do broadcast fica para o main, depois de drenar a moderação
     if (server_socket >= 0)
     {
         shutdown(server_socket, SHUT_RDWR);
         close(server_socket);
         server_socket = -1;
     }
+}
 
-    Message shutdown_msg;
-    shutdown_msg.type = MSG_BROADCAST;
-    strcpy(shutdown_msg.content, "SHUTDOWN");
-    shutdown_msg.timestamp = time(NULL);
-    shutdown_msg.sender_fd = -1;
-    tsqueue_enqueue(&message_queue, &shutdown_msg);
+void reload_signal_handler(int sig)
+{
+    (void)sig;
+    moderation_request_reload();
 }
 
 int contains_profanity(const char *message)
@@ -51,41 +103,75 @@ int contains_profanity(const char *message)
     if (!message)
         return 0;
 
-    char lower_msg[BUFFER_SIZE];
-    strncpy(lower_msg, message, BUFFER_SIZE - 1);
-    lower_msg[BUFFER_SIZE - 1] = '\0';
+    return moderation_contains_profanity(message, strnlen(message, BUFFER_SIZE - 1));
+}
+
+static int profanity_check(const Message *msg)
+{
+    return msg->type == MSG_BROADCAST && contains_profanity(msg->content);
+}
 
-    for (int i = 0; lower_msg[i]; i++)
+static void moderation_accept(Message *msg)
+{
+    if (msg->type == MSG_BROADCAST)
     {
-        if (lower_msg[i] >= 'A' && lower_msg[i] <= 'Z')
-        {
-            lower_msg[i] = lower_msg[i] + 32;
-        }
+        char formatted_msg[BUFFER_SIZE + 100];
+        snprintf(formatted_msg, sizeof(formatted_msg),
+                 "[%s]: %s\n", msg->username, msg->content);
+        strncpy(msg->content, formatted_msg, MAX_MESSAGE_SIZE - 1);
+        msg->content[MAX_MESSAGE_SIZE - 1] = '\0';
+        printf("[Chat] %s", msg->content);
     }
 
-    for (int i = 0; profanity_filter[i] != NULL; i++)
+    msg->enqueue_ns = latency_now_ns();
+    if (tsqueue_enqueue(&message_queue, msg) != 0)
     {
-        if (strstr(lower_msg, profanity_filter[i]) != NULL)
-        {
-            return 1;
-        }
+        client_manager_send_to(&client_manager, msg->sender_fd, msg->sender_id,
+                               "⚠ Servidor ocupado, tente novamente.\n");
+
+        TSLOG_WARN(TSLOG_CAT_BROADCAST, "Fila de mensagens cheia - mensagem descartada");
     }
-    return 0;
+}
+
+static void record_message_latency(const Message *msg, uint64_t dequeued_ns, uint64_t sent_ns)
+{
+    if (msg->ingest_ns == 0)
+        return;
+
+    latency_histogram_record(&stage_latency[LATENCY_STAGE_INGEST], msg->enqueue_ns - msg->ingest_ns);
+    latency_histogram_record(&stage_latency[LATENCY_STAGE_QUEUE], dequeued_ns - msg->enqueue_ns);
+    latency_histogram_record(&stage_latency[LATENCY_STAGE_FANOUT], sent_ns - dequeued_ns);
+    latency_histogram_record(&stage_latency[LATENCY_STAGE_TOTAL], sent_ns - msg->ingest_ns);
+}
+
+static void moderation_reject(const Message *msg, const char *check_name)
+{
+    // Roda num worker, depois do recv: o remetente pode ter saído e o fd ser de outro cliente
+    metrics_inc(METRIC_FILTER_HITS);
+    client_manager_send_to(&client_manager, msg->sender_fd, msg->sender_id,
+                           "⚠ AVISO: Sua mensagem contém conteúdo proibido e foi bloqueada.\n");
+
+    TSLOG_INFO(TSLOG_CAT_BROADCAST, "Mensagem bloqueada por %s - %s: %s",
+               check_name, msg->username, msg->content);
 }
 
 void *broadcast_worker(void *arg)
 {
     Message msg;
 
-    tslog_write("Thread de broadcast iniciada");
+    TSLOG_INFO(TSLOG_CAT_BROADCAST, "Thread de broadcast iniciada");
 
-    while (server_running)
+    // Não olha server_running: segue consumindo até o SHUTDOWN, que o main só
+    // enfileira depois que a moderação entregou tudo o que tinha
+    for (;;)
     {
         if (tsqueue_dequeue(&message_queue, &msg) == 0)
         {
+            uint64_t dequeued_ns = latency_now_ns();
+
             if (strcmp(msg.content, "SHUTDOWN") == 0)
             {
-                tslog_write("Thread de broadcast recebeu sinal de shutdown");
+                TSLOG_INFO(TSLOG_CAT_BROADCAST, "Thread de broadcast recebeu sinal de shutdown");
                 break;
             }
 
@@ -93,19 +179,31 @@ void *broadcast_worker(void *arg)
             {
             case MSG_BROADCAST:
             {
-                int sent = client_manager_broadcast(&client_manager, msg.content, msg.sender_fd);
+                Payload *payload = payload_create(msg.content, strlen(msg.content),
+                                                  msg.room_id, msg.timestamp);
+                if (!payload)
+                {
+                    TSLOG_ERROR(TSLOG_CAT_BROADCAST, "Sem memória para mensagem de %s", msg.username);
+                    break;
+                }
 
-                char log_msg[1200];
-                snprintf(log_msg, sizeof(log_msg),
-                         "Broadcast de %s para %d clientes: %s",
-                         msg.username, sent, msg.content);
-                tslog_write(log_msg);
-                break;
-            }
+                int sent = client_manager_broadcast_room(&client_manager, msg.room_id,
+                                                         payload->data, msg.sender_fd);
+                record_message_latency(&msg, dequeued_ns, latency_now_ns());
 
-            case MSG_PRIVATE:
-            {
-                client_manager_send_private(&client_manager, msg.username, msg.target, msg.content);
+                TSLOG_DEBUG(TSLOG_CAT_BROADCAST, "Broadcast de %s para %d clientes: %s",
+                            msg.username, sent, msg.content);
+
+                bool journaled = journal_append(&journal, client_manager_room_name(&client_manager, msg.room_id),
+                                                (uint64_t)msg.timestamp, payload->data, payload->length,
+                                                &payload->journal_offset) == 0;
+
+                // O histórico fica com a referência do mesmo buffer enviado
+                message_history_append(&message_history, payload);
+
+                // Próxima inicialização relê o journal a partir do que o histórico ainda guarda
+                if (journaled)
+                    journal_set_replay_offset(&journal, message_history_oldest_offset(&message_history));
                 break;
             }
 
@@ -114,11 +212,9 @@ void *broadcast_worker(void *arg)
                 char join_msg[256];
                 snprintf(join_msg, sizeof(join_msg),
                          "*** %s entrou no chat ***\n", msg.username);
-                client_manager_broadcast(&client_manager, join_msg, -1);
+                client_manager_broadcast_room(&client_manager, msg.room_id, join_msg, -1);
 
-                char log_msg[256];
-                snprintf(log_msg, sizeof(log_msg), "Cliente %s entrou no chat", msg.username);
-                tslog_write(log_msg);
+                TSLOG_INFO(TSLOG_CAT_BROADCAST, "Cliente %s entrou no chat", msg.username);
                 break;
             }
 
@@ -127,11 +223,21 @@ void *broadcast_worker(void *arg)
                 char leave_msg[256];
                 snprintf(leave_msg, sizeof(leave_msg),
                          "*** %s saiu do chat ***\n", msg.username);
-                client_manager_broadcast(&client_manager, leave_msg, -1);
+                client_manager_broadcast_room(&client_manager, msg.room_id, leave_msg, -1);
 
-                char log_msg[256];
-                snprintf(log_msg, sizeof(log_msg), "Cliente %s saiu do chat", msg.username);
-                tslog_write(log_msg);
+                TSLOG_INFO(TSLOG_CAT_BROADCAST, "Cliente %s saiu do chat", msg.username);
+                break;
+            }
+
+            case MSG_ROOM_JOIN:
+            case MSG_ROOM_PART:
+            {
+                char room_msg[256];
+                snprintf(room_msg, sizeof(room_msg),
+                         msg.type == MSG_ROOM_JOIN ? "*** %s entrou na sala #%s ***\n"
+                                                   : "*** %s saiu da sala #%s ***\n",
+                         msg.username, client_manager_room_name(&client_manager, msg.room_id));
+                client_manager_broadcast_room(&client_manager, msg.room_id, room_msg, msg.sender_fd);
                 break;
             }
 
@@ -141,176 +247,857 @@ void *broadcast_worker(void *arg)
         }
     }
 
-    tslog_write("Thread de broadcast finalizada");
+    TSLOG_INFO(TSLOG_CAT_BROADCAST, "Thread de broadcast finalizada");
     return NULL;
 }
 
-int process_command(int client_sock, const char *command)
+// Envia todos os buffers numa única chamada, repetindo só se a escrita for parcial
+static int send_iov(int client_sock, struct iovec *iov, int iov_count)
 {
-    ClientInfo *client = client_manager_find_by_socket(&client_manager, client_sock);
-    if (!client)
-        return -1;
+    while (iov_count > 0)
+    {
+        struct msghdr hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.msg_iov = iov;
+        hdr.msg_iovlen = (size_t)iov_count;
+
+        ssize_t written = sendmsg(client_sock, &hdr, MSG_NOSIGNAL);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
 
+        while (iov_count > 0 && (size_t)written >= iov->iov_len)
+        {
+            written -= (ssize_t)iov->iov_len;
+            iov++;
+            iov_count--;
+        }
+        if (iov_count > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + written;
+            iov->iov_len -= (size_t)written;
+        }
+    }
+    return 0;
+}
+
+// Entrega as mensagens guardadas enquanto o usuário estava offline
+static void deliver_offline_messages(int client_sock, const char *username)
+{
+    MailItem *items;
+    int count = mailbox_take(&mailbox_store, username, &items);
+    if (count < 0)
+    {
+        const char *response = "⚠ Mensagens offline indisponíveis no momento; tente entrar de novo mais tarde.\n";
+        send(client_sock, response, strlen(response), MSG_NOSIGNAL);
+        return;
+    }
+    if (count == 0)
+        return;
+
+    size_t capacity = (size_t)count * (MAILBOX_MAX_TEXT_SIZE + MAILBOX_NAME_SIZE + 64) + 128;
+    char *buffer = malloc(capacity);
+    if (!buffer)
+    {
+        mailbox_free_items(items);
+        return;
+    }
+
+    size_t length = (size_t)snprintf(buffer, capacity, "=== %d MENSAGEM(NS) RECEBIDA(S) OFFLINE ===\n", count);
+    for (MailItem *item = items; item; item = item->next)
+    {
+        char when[32];
+        struct tm tm_info;
+        localtime_r(&item->timestamp, &tm_info);
+        strftime(when, sizeof(when), "%d/%m %H:%M", &tm_info);
+        length += (size_t)snprintf(buffer + length, capacity - length,
+                                   "[PRIVADA de %s, %s]: %s\n", item->from, when, item->text);
+    }
+
+    struct iovec iov = {.iov_base = buffer, .iov_len = length};
+    send_iov(client_sock, &iov, 1);
+
+    TSLOG_INFO(TSLOG_CAT_GENERAL, "%d mensagens offline entregues para %s", count, username);
+    free(buffer);
+    mailbox_free_items(items);
+}
+
+// Assume o nome registrado e entrega a caixa offline; só com a chave do dono
+static void claim_identity(int client_sock, ClientInfo *client, const char *username, const char *key)
+{
     char response[BUFFER_SIZE];
+    size_t length = strlen(username);
 
-    if (strncmp(command, "/auth ", 6) == 0)
+    if (length < 3 || length > MAX_USERNAME_SIZE - 1)
+    {
+        strcpy(response, "✗ Nome deve ter entre 3 e 49 caracteres\n");
+    }
+    else if (strlen(key) < MAILBOX_MIN_KEY_LENGTH)
+    {
+        snprintf(response, sizeof(response), "✗ A chave deve ter ao menos %d caracteres\n",
+                 MAILBOX_MIN_KEY_LENGTH);
+    }
+    else if (strcmp(client->username, username) != 0 &&
+             client_manager_username_exists(&client_manager, username))
     {
-        const char *password = command + 6;
-        if (client_manager_authenticate(&client_manager, client_sock, password) == 0)
+        snprintf(response, sizeof(response), "✗ %s já está online\n", username);
+    }
+    else
+    {
+        int claimed = mailbox_claim(&mailbox_store, username, key, client->ip_address);
+        if (claimed == MAILBOX_DENIED)
         {
-            strcpy(response, "✓ Autenticado com sucesso! Bem-vindo ao chat.\n");
-            send(client_sock, response, strlen(response), MSG_NOSIGNAL);
-
-            Message join_msg;
-            join_msg.type = MSG_JOIN;
-            strncpy(join_msg.username, client->username, MAX_USERNAME_SIZE - 1);
-            join_msg.username[MAX_USERNAME_SIZE - 1] = '\0';
-            join_msg.timestamp = time(NULL);
-            join_msg.sender_fd = client_sock;
-            tsqueue_enqueue(&message_queue, &join_msg);
+            metrics_inc(METRIC_AUTH_FAILURES);
+            snprintf(response, sizeof(response), "✗ Chave incorreta para %s\n", username);
+        }
+        else if (claimed == MAILBOX_FULL)
+        {
+            strcpy(response, "✗ Limite de nomes registrados atingido\n");
+        }
+        else if (claimed != 0)
+        {
+            strcpy(response, "✗ Erro ao registrar o nome\n");
+        }
+        else if (strcmp(client->username, username) != 0 &&
+                 client_manager_rename(&client_manager, client_sock, username) != 0)
+        {
+            snprintf(response, sizeof(response), "✗ %s já está online\n", username);
         }
         else
         {
-            strcpy(response, "✗ Senha incorreta! Tente novamente.\n");
+            snprintf(response, sizeof(response), "✓ Você entrou como %s\n", client->username);
             send(client_sock, response, strlen(response), MSG_NOSIGNAL);
+            deliver_offline_messages(client_sock, client->username);
+            return;
         }
-        return 1;
     }
 
-    if (!client->authenticated)
+    send(client_sock, response, strlen(response), MSG_NOSIGNAL);
+}
+
+// /auth <senha> [<usuário> <chave>]: com usuário e chave, o nome fica
+// registrado para quem tem a chave, que recebe as mensagens guardadas offline
+static int cmd_auth(int client_sock, ClientInfo *client, char *args)
+{
+    char response[BUFFER_SIZE];
+
+    char *password = args;
+    char *username = NULL;
+    char *key = NULL;
+    char *space = strchr(args, ' ');
+    if (space)
     {
-        strcpy(response, "⚠ Você precisa se autenticar primeiro: /auth <senha>\n");
+        *space = '\0';
+        username = space + 1;
+        space = strchr(username, ' ');
+        if (!space)
+        {
+            strcpy(response, "Uso: /auth <senha> [<usuário> <chave>]\n");
+            send(client_sock, response, strlen(response), MSG_NOSIGNAL);
+            return 1;
+        }
+        *space = '\0';
+        key = space + 1;
+    }
+
+    int authenticated = client_manager_authenticate(&client_manager, client_sock, password) == 0;
+    CHAT_PROBE2(auth_result, client_sock, authenticated);
+    flight_record(FLIGHT_AUTH, client_sock, (uint64_t)authenticated, 0);
+
+    if (authenticated)
+    {
+        strcpy(response, "✓ Autenticado com sucesso! Bem-vindo ao chat.\n");
         send(client_sock, response, strlen(response), MSG_NOSIGNAL);
-        return 1;
+
+        if (username)
+            claim_identity(client_sock, client, username, key);
+
+        Message join_msg = {0};
+        join_msg.type = MSG_JOIN;
+        snprintf(join_msg.username, sizeof(join_msg.username), "%s", client->username);
+        join_msg.timestamp = time(NULL);
+        join_msg.sender_fd = client_sock;
+        join_msg.sender_id = client->connection_id;
+        join_msg.room_id = DEFAULT_ROOM_ID;
+        pipeline_stage_submit(&moderation_stage, &join_msg);
     }
+    else
+    {
+        metrics_inc(METRIC_AUTH_FAILURES);
+        strcpy(response, "✗ Senha incorreta! Tente novamente.\n");
+        send(client_sock, response, strlen(response), MSG_NOSIGNAL);
+    }
+    return 1;
+}
+
+static int cmd_list(int client_sock, ClientInfo *client, char *args)
+{
+    (void)client;
+    (void)args;
+
+    int client_sockets[MAX_CLIENTS];
+    char usernames[MAX_CLIENTS][MAX_USERNAME_SIZE];
+    int count = client_manager_get_authenticated_clients(&client_manager,
+                                                         client_sockets, usernames, MAX_CLIENTS);
 
-    if (strcmp(command, "/list") == 0)
+    char response[MAX_CLIENTS * (MAX_USERNAME_SIZE + 8) + 128];
+    int length = snprintf(response, sizeof(response), "=== USUÁRIOS ONLINE ===\n");
+    for (int i = 0; i < count; i++)
     {
-        int client_sockets[MAX_CLIENTS];
-        char usernames[MAX_CLIENTS][MAX_USERNAME_SIZE];
-        int count = client_manager_get_authenticated_clients(&client_manager,
-                                                             client_sockets, usernames, MAX_CLIENTS);
+        length += snprintf(response + length, sizeof(response) - (size_t)length, "• %s\n", usernames[i]);
+    }
+    snprintf(response + length, sizeof(response) - (size_t)length,
+             "\nTotal: %d usuários online\n", count);
 
-        strcpy(response, "=== USUÁRIOS ONLINE ===\n");
-        for (int i = 0; i < count; i++)
-        {
-            char user_line[80];
-            snprintf(user_line, sizeof(user_line), "• %s\n", usernames[i]);
-            strcat(response, user_line);
-        }
+    send(client_sock, response, strlen(response), MSG_NOSIGNAL);
+    return 1;
+}
+
+static int cmd_msg(int client_sock, ClientInfo *client, char *args)
+{
+    char response[BUFFER_SIZE];
+
+    char *space = strchr(args, ' ');
+    if (!space)
+        return 0;
+
+    *space = '\0';
+    const char *target_username = args;
+    const char *private_msg = space + 1;
+
+    // Entrega direta pelo índice de usernames, sem passar pela fila de broadcast
+    if (client_manager_send_private(&client_manager, client->username,
+                                    target_username, private_msg) == 0)
+    {
+        snprintf(response, sizeof(response),
+                 "✓ Mensagem privada enviada para %s\n", target_username);
+    }
+    else
+    {
+        // Destinatário offline com nome registrado: guarda para quando ele entrar
+        int stored = mailbox_deposit(&mailbox_store, target_username, client->username,
+                                     private_msg, strlen(private_msg));
+
+        if (stored == 0)
+            snprintf(response, sizeof(response),
+                     "✓ %s está offline; a mensagem será entregue quando entrar\n", target_username);
+        else if (stored == MAILBOX_FULL)
+            snprintf(response, sizeof(response),
+                     "✗ Caixa de mensagens de '%s' está cheia\n", target_username);
+        else
+            snprintf(response, sizeof(response),
+                     "✗ Usuário '%s' não encontrado ou offline\n", target_username);
+    }
 
-        char total_line[50];
-        snprintf(total_line, sizeof(total_line), "\nTotal: %d usuários online\n", count);
-        strcat(response, total_line);
+    send(client_sock, response, strlen(response), MSG_NOSIGNAL);
+    return 1;
+}
+
+static int cmd_nick(int client_sock, ClientInfo *client, char *new_username)
+{
+    char response[BUFFER_SIZE];
+
+    char old_name[MAX_USERNAME_SIZE];
+    strcpy(old_name, client->username);
+
+    if (strlen(new_username) < 3 || strlen(new_username) > MAX_USERNAME_SIZE - 1)
+    {
+        strcpy(response, "✗ Nome deve ter entre 3 e 49 caracteres\n");
+    }
+    else if (mailbox_is_registered(&mailbox_store, new_username))
+    {
+        // Nomes registrados só via /auth com a chave do dono
+        snprintf(response, sizeof(response),
+                 "✗ Nome registrado; entre com /auth <senha> %s <chave>\n", new_username);
+    }
+    else if (client_manager_rename(&client_manager, client_sock, new_username) != 0)
+    {
+        strcpy(response, "✗ Este nome já está em uso\n");
+    }
+    else
+    {
+        snprintf(response, sizeof(response),
+                 "✓ Nome alterado de %s para %s\n", old_name, client->username);
+    }
 
+    send(client_sock, response, strlen(response), MSG_NOSIGNAL);
+    return 1;
+}
+
+static void submit_room_notice(MessageType type, int client_sock, ClientInfo *client, int room_id)
+{
+    Message msg = {0};
+    msg.type = type;
+    snprintf(msg.username, sizeof(msg.username), "%s", client->username);
+    msg.content[0] = '\0';
+    msg.timestamp = time(NULL);
+    msg.sender_fd = client_sock;
+    msg.sender_id = client->connection_id;
+    msg.room_id = room_id;
+    pipeline_stage_submit(&moderation_stage, &msg);
+}
+
+static int switch_room(int client_sock, ClientInfo *client, const char *room_name)
+{
+    char response[BUFFER_SIZE];
+    int old_room = client->room_id;
+
+    int room_id = client_manager_join_room(&client_manager, client_sock, room_name);
+    if (room_id < 0)
+    {
+        strcpy(response, "✗ Não foi possível entrar na sala (limite de salas atingido)\n");
+    }
+    else if (room_id == old_room)
+    {
+        snprintf(response, sizeof(response), "Você já está na sala #%s\n", room_name);
+    }
+    else
+    {
+        submit_room_notice(MSG_ROOM_PART, client_sock, client, old_room);
+        submit_room_notice(MSG_ROOM_JOIN, client_sock, client, room_id);
+        snprintf(response, sizeof(response), "✓ Você entrou na sala #%s\n", room_name);
+    }
+
+    send(client_sock, response, strlen(response), MSG_NOSIGNAL);
+    return 1;
+}
+
+static int cmd_join(int client_sock, ClientInfo *client, char *room_name)
+{
+    if (room_name[0] == '#')
+        room_name++;
+
+    size_t length = strlen(room_name);
+    bool valid = length > 0 && length < MAX_ROOM_NAME_SIZE;
+    for (size_t i = 0; valid && i < length; i++)
+    {
+        unsigned char c = (unsigned char)room_name[i];
+        valid = isalnum(c) || c == '-' || c == '_';
+    }
+
+    if (!valid)
+    {
+        const char *response = "✗ Nome de sala inválido (letras, números, '-' e '_', até 31 caracteres)\n";
         send(client_sock, response, strlen(response), MSG_NOSIGNAL);
         return 1;
     }
 
-    if (strncmp(command, "/msg ", 5) == 0)
+    return switch_room(client_sock, client, room_name);
+}
+
+static int cmd_part(int client_sock, ClientInfo *client, char *args)
+{
+    (void)args;
+
+    if (client->room_id == DEFAULT_ROOM_ID)
     {
-        char *space = strchr(command + 5, ' ');
-        if (space)
-        {
-            *space = '\0';
-            const char *target_username = command + 5;
-            const char *private_msg = space + 1;
+        const char *response = "✗ Você já está na sala #" DEFAULT_ROOM_NAME "\n";
+        send(client_sock, response, strlen(response), MSG_NOSIGNAL);
+        return 1;
+    }
 
-            if (client_manager_find_by_username(&client_manager, target_username))
-            {
-                Message msg;
-                msg.type = MSG_PRIVATE;
-                strncpy(msg.username, client->username, MAX_USERNAME_SIZE - 1);
-                msg.username[MAX_USERNAME_SIZE - 1] = '\0';
-                strncpy(msg.target, target_username, MAX_USERNAME_SIZE - 1);
-                msg.target[MAX_USERNAME_SIZE - 1] = '\0';
-                strncpy(msg.content, private_msg, MAX_MESSAGE_SIZE - 1);
-                msg.content[MAX_MESSAGE_SIZE - 1] = '\0';
-                msg.timestamp = time(NULL);
-                msg.sender_fd = client_sock;
-
-                tsqueue_enqueue(&message_queue, &msg);
-
-                snprintf(response, sizeof(response),
-                         "✓ Mensagem privada enviada para %s\n", target_username);
-            }
-            else
-            {
-                snprintf(response, sizeof(response),
-                         "✗ Usuário '%s' não encontrado ou offline\n", target_username);
-            }
+    return switch_room(client_sock, client, DEFAULT_ROOM_NAME);
+}
+
+// Reconstrói o histórico das salas a partir do journal
+static void replay_journal_record(const JournalRecord *record, void *ctx)
+{
+    (void)ctx;
+
+    char room[MAX_ROOM_NAME_SIZE];
+    size_t room_length = record->room_length < sizeof(room) - 1 ? record->room_length : sizeof(room) - 1;
+    memcpy(room, record->room, room_length);
+    room[room_length] = '\0';
 
+    int room_id = client_manager_get_or_create_room(&client_manager, room);
+    if (room_id < 0)
+        return;
+
+    Payload *payload = payload_create(record->data, record->length, room_id, (time_t)record->timestamp);
+    if (payload)
+        payload->journal_offset = record->offset;
+    message_history_append(&message_history, payload);
+}
+
+static int cmd_history(int client_sock, ClientInfo *client, char *args)
+{
+    int requested = HISTORY_DEFAULT_REPLAY;
+    if (args)
+    {
+        requested = atoi(args);
+        if (requested <= 0)
+        {
+            const char *response = "✗ Uso: /history [n] (n > 0)\n";
             send(client_sock, response, strlen(response), MSG_NOSIGNAL);
             return 1;
         }
     }
+    if (requested > HISTORY_MAX_ENTRIES)
+        requested = HISTORY_MAX_ENTRIES;
+
+    Payload *entries[HISTORY_MAX_ENTRIES];
+    int count = message_history_snapshot(&message_history, client->room_id, entries, requested);
+
+    char header[128];
+    snprintf(header, sizeof(header), "=== HISTÓRICO #%s (%d mensagens) ===\n",
+             client_manager_room_name(&client_manager, client->room_id), count);
+
+    struct iovec iov[HISTORY_MAX_ENTRIES + 1];
+    iov[0].iov_base = header;
+    iov[0].iov_len = strlen(header);
+    for (int i = 0; i < count; i++)
+    {
+        iov[i + 1].iov_base = entries[i]->data;
+        iov[i + 1].iov_len = entries[i]->length;
+    }
+
+    send_iov(client_sock, iov, count + 1);
+
+    for (int i = 0; i < count; i++)
+        payload_unref(entries[i]);
+    return 1;
+}
+
+// Só a sala atual: quem nunca entrou numa sala não lê as conversas dela
+static int cmd_search(int client_sock, ClientInfo *client, char *terms)
+{
+    const char *room = client_manager_room_name(&client_manager, client->room_id);
+    if (!room)
+        return 1;
 
-    if (strncmp(command, "/nick ", 6) == 0)
+    SearchResult results[SEARCH_MAX_RESULTS];
+    int count = search_index_query(&search_index, terms, room, results, SEARCH_MAX_RESULTS);
+    if (count < 0)
+        count = 0;
+
+    char response[SEARCH_MAX_RESULTS * (SEARCH_RESULT_TEXT_SIZE + 64) + 128];
+    size_t length = (size_t)snprintf(response, sizeof(response),
+                                     "=== BUSCA '%s' em #%s: %d resultado(s) ===\n", terms, room, count);
+    for (int i = 0; i < count && length < sizeof(response); i++)
     {
-        const char *new_username = command + 6;
+        char when[32];
+        time_t timestamp = (time_t)results[i].timestamp;
+        struct tm tm_info;
+        localtime_r(&timestamp, &tm_info);
+        strftime(when, sizeof(when), "%d/%m %H:%M", &tm_info);
+        length += (size_t)snprintf(response + length, sizeof(response) - length,
+                                   "%s #%s %s\n", when, results[i].room, results[i].text);
+    }
 
-        if (strlen(new_username) < 3 || strlen(new_username) > MAX_USERNAME_SIZE - 1)
+    send(client_sock, response, strlen(response), MSG_NOSIGNAL);
+    return 1;
+}
+
+static int cmd_stats(int client_sock, ClientInfo *client, char *args)
+{
+    (void)client;
+    (void)args;
+
+    char response[BUFFER_SIZE];
+    int length = snprintf(response, sizeof(response),
+                          "=== LATÊNCIA DE BROADCAST (µs) ===\n%-8s %10s %9s %9s %9s %9s\n",
+                          "etapa", "amostras", "p50", "p99", "p999", "máx");
+    for (int i = 0; i < LATENCY_STAGE_COUNT && (size_t)length < sizeof(response); i++)
+    {
+        const LatencyHistogram *hist = &stage_latency[i];
+        length += snprintf(response + length, sizeof(response) - (size_t)length,
+                           "%-8s %10llu %9.1f %9.1f %9.1f %9.1f\n", latency_stage_names[i],
+                           (unsigned long long)latency_histogram_count(hist),
+                           latency_histogram_percentile(hist, 0.50) / 1e3,
+                           latency_histogram_percentile(hist, 0.99) / 1e3,
+                           latency_histogram_percentile(hist, 0.999) / 1e3,
+                           latency_histogram_max(hist) / 1e3);
+    }
+    if ((size_t)length < sizeof(response))
+        snprintf(response + length, sizeof(response) - (size_t)length,
+                 "Filas: moderação %d, broadcast %d\n",
+                 pipeline_stage_depth(&moderation_stage), tsqueue_size(&message_queue));
+
+    send(client_sock, response, strlen(response), MSG_NOSIGNAL);
+    return 1;
+}
+
+static int cmd_help(int client_sock, ClientInfo *client, char *args)
+{
+    (void)client;
+    (void)args;
+
+    char response[BUFFER_SIZE * 2];
+    int length = snprintf(response, sizeof(response), "=== COMANDOS DISPONÍVEIS ===\n");
+    for (int i = 0; i < command_registry.count && (size_t)length < sizeof(response); i++)
+    {
+        const CommandSpec *spec = command_registry.commands[i];
+        length += snprintf(response + length, sizeof(response) - (size_t)length,
+                           "%-17s - %s\n", spec->usage, spec->description);
+    }
+    if ((size_t)length < sizeof(response))
+        snprintf(response + length, sizeof(response) - (size_t)length,
+                 "\nDigite mensagens normalmente para broadcast público.\n");
+
+    send(client_sock, response, strlen(response), MSG_NOSIGNAL);
+    return 1;
+}
+
+static int cmd_quit(int client_sock, ClientInfo *client, char *args)
+{
+    (void)client;
+    (void)args;
+
+    const char *response = "Até logo! Desconectando...\n";
+    send(client_sock, response, strlen(response), MSG_NOSIGNAL);
+    return -1; // Sinaliza desconexão
+}
+
+// A ordem aqui é a ordem exibida no /help
+static CommandSpec command_table[] = {
+    {.name = "/auth", .usage = "/auth <senha> [<usuário> <chave>]",
+     .description = "Autenticar (senha: chat123); com usuário e chave, registra o nome",
+     .handler = cmd_auth, .takes_args = true, .requires_auth = false},
+    {.name = "/list", .usage = "/list", .description = "Listar usuários online",
+     .handler = cmd_list, .takes_args = false, .requires_auth = true},
+    {.name = "/msg", .usage = "/msg <user> <msg>", .description = "Enviar mensagem privada",
+     .handler = cmd_msg, .takes_args = true, .requires_auth = true},
+    {.name = "/nick", .usage = "/nick <nome>", .description = "Mudar nome de usuário",
+     .handler = cmd_nick, .takes_args = true, .requires_auth = true},
+    {.name = "/join", .usage = "/join <sala>", .description = "Entrar em uma sala (criada se não existir)",
+     .handler = cmd_join, .takes_args = true, .requires_auth = true},
+    {.name = "/part", .usage = "/part", .description = "Voltar para a sala " DEFAULT_ROOM_NAME,
+     .handler = cmd_part, .takes_args = false, .requires_auth = true},
+    {.name = "/history", .usage = "/history [n]", .description = "Últimas n mensagens da sala (padrão 20)",
+     .handler = cmd_history, .takes_args = true, .optional_args = true, .requires_auth = true},
+    {.name = "/search", .usage = "/search <termos>", .description = "Buscar mensagens antigas da sala",
+     .handler = cmd_search, .takes_args = true, .requires_auth = true},
+    {.name = "/stats", .usage = "/stats", .description = "Latência das etapas de broadcast",
+     .handler = cmd_stats, .takes_args = false, .requires_auth = true},
+    {.name = "/help", .usage = "/help", .description = "Mostrar esta ajuda",
+     .handler = cmd_help, .takes_args = false, .requires_auth = true},
+    {.name = "/quit", .usage = "/quit", .description = "Sair do chat",
+     .handler = cmd_quit, .takes_args = false, .requires_auth = true},
+};
+
+static int register_commands(void)
+{
+    if (command_registry_init(&command_registry) != 0)
+        return -1;
+
+    for (size_t i = 0; i < sizeof(command_table) / sizeof(command_table[0]); i++)
+    {
+        if (command_registry_register(&command_registry, &command_table[i]) != 0)
+            return -1;
+    }
+
+    return command_registry_build(&command_registry);
+}
+
+int process_command(int client_sock, char *command)
+{
+    // Resolve o comando antes de tocar no gerenciador de clientes
+    char *args = strchr(command, ' ');
+    size_t name_length = args ? (size_t)(args - command) : strlen(command);
+    CommandSpec *spec = command_registry_lookup(&command_registry, command, name_length);
+    if (spec && !spec->optional_args && spec->takes_args != (args != NULL))
+        spec = NULL;
+
+    ClientInfo *client = client_manager_find_by_socket(&client_manager, client_sock);
+    if (!client)
+        return -1;
+
+    if (spec && (!spec->requires_auth || client->authenticated))
+    {
+        int result = command_registry_execute(spec, client_sock, client, args ? args + 1 : NULL);
+        if (result != 0)
+            return result;
+    }
+
+    if (!client->authenticated)
+    {
+        const char *response = "⚠ Você precisa se autenticar primeiro: /auth <senha>\n";
+        send(client_sock, response, strlen(response), MSG_NOSIGNAL);
+        return 1;
+    }
+
+    return 0; // Comando não reconhecido
+}
+
+// Estado de uma conexão, na pilha de handle_client. Os timers são cancelados
+// (esperando callbacks em curso) antes do socket ser fechado.
+typedef struct
+{
+    int sock;
+    ConnectionRateState rate;
+    TimerEntry auth_timer;
+    TimerEntry heartbeat_timer;
+    atomic_bool authenticated;             // Lido pelo auth_timer sem o mutex do client_manager
+    atomic_uint_fast64_t last_activity_ms; // Última linha que não foi /pong
+    atomic_uint_fast64_t last_seen_ms;     // Qualquer linha
+    atomic_uint_fast64_t ping_sent_ms;     // 0 = nenhum ping sem resposta
+    uint64_t ingest_ns;                    // recv que trouxe a linha em tratamento
+    uint32_t capture_id;                   // Conexão na captura de tráfego (0 = desligada)
+} ClientSession;
+
+static uint64_t session_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+// Roda na thread da roda de timers: não pode bloquear no socket
+static void disconnect_session(ClientSession *session, const char *notice, uint64_t reason)
+{
+    flight_record(FLIGHT_DISCONNECT, session->sock, reason, 0);
+    send(session->sock, notice, strlen(notice), MSG_NOSIGNAL | MSG_DONTWAIT);
+    shutdown(session->sock, SHUT_RDWR); // recv em handle_client retorna 0 e a limpeza segue normal
+}
+
+// Callbacks da roda nunca tocam no mutex do client_manager: um broadcast
+// preso num send lento o segura, e a roda inteira pararia junto
+static void auth_deadline_expired(void *arg)
+{
+    ClientSession *session = arg;
+    if (atomic_load_explicit(&session->authenticated, memory_order_relaxed))
+        return;
+
+    atomic_fetch_add_explicit(&auth_timeouts, 1, memory_order_relaxed);
+    TSLOG_INFO(TSLOG_CAT_AUTH, "Socket %d não autenticou em %u s; desconectando",
+               session->sock, auth_timeout_ms / 1000);
+    disconnect_session(session, "⏱ Tempo para autenticação esgotado.\n", 1);
+}
+
+// Um único timer por conexão cobre inatividade e heartbeat: a cada disparo
+// verifica os prazos e se reagenda para o mais próximo.
+static void heartbeat_check(void *arg)
+{
+    ClientSession *session = arg;
+    uint64_t now = session_now_ms();
+    uint64_t next = UINT64_MAX;
+
+    if (idle_timeout_ms > 0)
+    {
+        uint64_t deadline = atomic_load_explicit(&session->last_activity_ms, memory_order_relaxed) +
+                            idle_timeout_ms;
+        if (now >= deadline)
         {
-            strcpy(response, "✗ Nome deve ter entre 3 e 49 caracteres\n");
+            atomic_fetch_add_explicit(&idle_disconnects, 1, memory_order_relaxed);
+            TSLOG_INFO(TSLOG_CAT_NET, "Socket %d inativo por %u s; desconectando",
+                       session->sock, idle_timeout_ms / 1000);
+            disconnect_session(session, "⏱ Desconectado por inatividade.\n", 2);
+            return;
         }
-        else if (client_manager_username_exists(&client_manager, new_username))
+        next = deadline;
+    }
+
+    if (heartbeat_interval_ms > 0)
+    {
+        uint64_t ping_sent = atomic_load_explicit(&session->ping_sent_ms, memory_order_relaxed);
+        uint64_t last_seen = atomic_load_explicit(&session->last_seen_ms, memory_order_relaxed);
+        uint64_t deadline;
+
+        if (ping_sent != 0)
+        {
+            deadline = ping_sent + heartbeat_interval_ms;
+            if (now >= deadline)
+            {
+                atomic_fetch_add_explicit(&heartbeat_disconnects, 1, memory_order_relaxed);
+                TSLOG_INFO(TSLOG_CAT_NET, "Socket %d sem resposta ao ping; desconectando", session->sock);
+                disconnect_session(session, "⏱ Conexão sem resposta.\n", 3);
+                return;
+            }
+        }
+        else if (now >= last_seen + heartbeat_interval_ms)
         {
-            strcpy(response, "✗ Este nome já está em uso\n");
+            // Marca antes de enviar: o /pong pode chegar antes da volta do send
+            atomic_store_explicit(&session->ping_sent_ms, now, memory_order_relaxed);
+            send(session->sock, HEARTBEAT_PING, strlen(HEARTBEAT_PING), MSG_NOSIGNAL | MSG_DONTWAIT);
+            deadline = now + heartbeat_interval_ms;
         }
         else
         {
-            char old_name[MAX_USERNAME_SIZE];
-            strcpy(old_name, client->username);
-            strncpy(client->username, new_username, MAX_USERNAME_SIZE - 1);
-            client->username[MAX_USERNAME_SIZE - 1] = '\0';
-
-            snprintf(response, sizeof(response),
-                     "✓ Nome alterado de %s para %s\n", old_name, new_username);
+            deadline = last_seen + heartbeat_interval_ms;
         }
 
-        send(client_sock, response, strlen(response), MSG_NOSIGNAL);
-        return 1;
+        if (deadline < next)
+            next = deadline;
     }
 
-    if (strcmp(command, "/help") == 0)
+    if (next != UINT64_MAX)
+        timer_schedule(&timer_wheel, &session->heartbeat_timer, (uint32_t)(next - now));
+}
+
+static void session_start_timers(ClientSession *session)
+{
+    uint64_t now = session_now_ms();
+    atomic_init(&session->last_activity_ms, now);
+    atomic_init(&session->last_seen_ms, now);
+    atomic_init(&session->ping_sent_ms, 0);
+    atomic_init(&session->authenticated, false);
+    timer_init(&session->auth_timer, auth_deadline_expired, session);
+    timer_init(&session->heartbeat_timer, heartbeat_check, session);
+
+    if (auth_timeout_ms > 0)
+        timer_schedule(&timer_wheel, &session->auth_timer, auth_timeout_ms);
+
+    uint32_t first_check = heartbeat_interval_ms;
+    if (idle_timeout_ms > 0 && (first_check == 0 || idle_timeout_ms < first_check))
+        first_check = idle_timeout_ms;
+    if (first_check > 0)
+        timer_schedule(&timer_wheel, &session->heartbeat_timer, first_check);
+}
+
+static void session_stop_timers(ClientSession *session)
+{
+    timer_cancel(&timer_wheel, &session->auth_timer);
+    timer_cancel(&timer_wheel, &session->heartbeat_timer);
+}
+
+// Trata uma linha recebida do cliente. Retorna -1 se o cliente deve ser desconectado
+static int handle_line(ClientSession *session, char *line)
+{
+    int client_sock = session->sock;
+    char *carriage_return = strchr(line, '\r');
+    if (carriage_return)
+        *carriage_return = '\0';
+    capture_line(&traffic_capture, session->capture_id, line, strlen(line));
+
+    // Qualquer linha prova que a conexão está viva; só o /pong não conta como atividade
+    uint64_t now = session_now_ms();
+    atomic_store_explicit(&session->last_seen_ms, now, memory_order_relaxed);
+    atomic_store_explicit(&session->ping_sent_ms, 0, memory_order_relaxed);
+    if (strcmp(line, HEARTBEAT_PONG) == 0)
+        return 0;
+    atomic_store_explicit(&session->last_activity_ms, now, memory_order_relaxed);
+
+    size_t line_length = strlen(line);
+    if (line_length == 0)
+        return 0;
+    metrics_inc(METRIC_MESSAGES_IN);
+    CHAT_PROBE2(message_ingest, client_sock, line_length);
+    flight_record(FLIGHT_INGEST, client_sock, line_length, 0);
+
+    // Limite por conexão antes de qualquer enfileiramento
+    RateClass rate_class = line[0] != '/'                   ? RATE_CLASS_BROADCAST
+                           : strncmp(line, "/msg ", 5) == 0 ? RATE_CLASS_PRIVATE
+                                                            : RATE_CLASS_COMMAND;
+    if (!rate_limiter_admit(&rate_limiter, &session->rate, rate_class))
     {
-        strcpy(response,
-               "=== COMANDOS DISPONÍVEIS ===\n"
-               "/auth <senha>     - Autenticar (senha: chat123)\n"
-               "/list             - Listar usuários online\n"
-               "/msg <user> <msg> - Enviar mensagem privada\n"
-               "/nick <nome>      - Mudar nome de usuário\n"
-               "/help             - Mostrar esta ajuda\n"
-               "/quit             - Sair do chat\n"
-               "\nDigite mensagens normalmente para broadcast público.\n");
+        const char *slow_down = "⚠ Muitas mensagens em sequência; aguarde um instante.\n";
+        metrics_inc(METRIC_DROPS_RATE_LIMIT);
+        send(client_sock, slow_down, strlen(slow_down), MSG_NOSIGNAL);
+        return 0;
+    }
 
-        send(client_sock, response, strlen(response), MSG_NOSIGNAL);
-        return 1;
+    client_manager_update_activity(&client_manager, client_sock);
+
+    if (line[0] == '/')
+    {
+        int result = process_command(client_sock, line);
+        if (!atomic_load_explicit(&session->authenticated, memory_order_relaxed) &&
+            strncmp(line, "/auth", 5) == 0)
+        {
+            ClientInfo *client = client_manager_find_by_socket(&client_manager, client_sock);
+            if (client && client->authenticated)
+            {
+                atomic_store_explicit(&session->authenticated, true, memory_order_relaxed);
+                timer_cancel(&timer_wheel, &session->auth_timer);
+            }
+        }
+        return result == -1 ? -1 : 0;
     }
 
-    if (strcmp(command, "/quit") == 0)
+    ClientInfo *client = client_manager_find_by_socket(&client_manager, client_sock);
+    if (!client || !client->authenticated)
     {
-        strcpy(response, "Até logo! Desconectando...\n");
-        send(client_sock, response, strlen(response), MSG_NOSIGNAL);
-        return -1; // Sinaliza desconexão
+        const char *auth_required = "⚠ Você precisa se autenticar antes de enviar mensagens: /auth <senha>\n";
+        send(client_sock, auth_required, strlen(auth_required), MSG_NOSIGNAL);
+
+        TSLOG_WARN(TSLOG_CAT_AUTH, "Mensagem rejeitada (não autenticado) - %s: %s",
+                   client ? client->username : "unknown", line);
+        return 0;
     }
 
-    return 0; // Comando não reconhecido
+    Message msg = {0};
+    msg.type = MSG_BROADCAST;
+    snprintf(msg.username, sizeof(msg.username), "%s", client->username);
+    strncpy(msg.content, line, MAX_MESSAGE_SIZE - 1);
+    msg.content[MAX_MESSAGE_SIZE - 1] = '\0';
+    msg.timestamp = time(NULL);
+    msg.sender_fd = client_sock;
+    msg.sender_id = client->connection_id;
+    msg.room_id = client->room_id;
+    msg.ingest_ns = session->ingest_ns;
+
+    // Filtro e demais verificações rodam no estágio de moderação
+    pipeline_stage_submit(&moderation_stage, &msg);
+    return 0;
+}
+
+// Argumento da thread de cada conexão
+typedef struct
+{
+    int sock;
+    uint32_t ip;   // Ordem de rede
+    bool admitted; // Ocupa vaga na tabela de admissão
+} ClientConnection;
+
+static void release_connection(const ClientConnection *conn)
+{
+    if (conn->admitted)
+        admission_release(&admission_table, conn->ip);
+}
+
+// Rejeição barata: sem mensagem nem log, e RST em vez de TIME_WAIT
+static void reject_connection(int sock)
+{
+    struct linger abort_close = {.l_onoff = 1, .l_linger = 0};
+    setsockopt(sock, SOL_SOCKET, SO_LINGER, &abort_close, sizeof(abort_close));
+    close(sock);
+}
+
+static void client_thread_exit(void)
+{
+    pthread_mutex_lock(&client_threads_mutex);
+    if (--client_threads == 0)
+        pthread_cond_broadcast(&client_threads_done);
+    pthread_mutex_unlock(&client_threads_mutex);
+}
+
+// Derruba as conexões (recv e send bloqueados voltam na hora) e espera as
+// threads terminarem a limpeza
+static void stop_client_threads(void)
+{
+    static int sockets[MAX_CLIENTS];
+    int count = client_manager_get_clients(&client_manager, sockets, NULL, MAX_CLIENTS);
+    for (int i = 0; i < count; i++)
+        shutdown(sockets[i], SHUT_RDWR);
+
+    pthread_mutex_lock(&client_threads_mutex);
+    while (client_threads > 0)
+        pthread_cond_wait(&client_threads_done, &client_threads_mutex);
+    pthread_mutex_unlock(&client_threads_mutex);
 }
 
 void *handle_client(void *arg)
 {
-    int client_sock = *(int *)arg;
+    ClientConnection conn = *(ClientConnection *)arg;
+    int client_sock = conn.sock;
     free(arg);
 
     char buffer[BUFFER_SIZE];
     char welcome_msg[512];
     int bytes;
 
+    ClientSession session = {.sock = client_sock};
+    rate_limiter_connection_init(&rate_limiter, &session.rate);
+
     ClientInfo *client = client_manager_find_by_socket(&client_manager, client_sock);
     if (!client)
     {
         close(client_sock);
+        release_connection(&conn);
+        client_thread_exit();
         return NULL;
     }
 
@@ -328,110 +1115,122 @@ void *handle_client(void *arg)
 
     if (send(client_sock, welcome_msg, strlen(welcome_msg), MSG_NOSIGNAL) < 0)
     {
-        tslog_write("Erro ao enviar boas-vindas");
+        TSLOG_WARN(TSLOG_CAT_NET, "Erro ao enviar boas-vindas");
         close(client_sock);
         client_manager_remove(&client_manager, client_sock);
+        release_connection(&conn);
+        client_thread_exit();
         return NULL;
     }
 
-    while (server_running && (bytes = recv(client_sock, buffer, BUFFER_SIZE - 1, 0)) > 0)
-    {
-        buffer[bytes] = '\0';
-
-        char *newline = strchr(buffer, '\n');
-        if (newline)
-            *newline = '\0';
-        newline = strchr(buffer, '\r');
-        if (newline)
-            *newline = '\0';
-
-        if (strlen(buffer) == 0)
-            continue;
-
-        client_manager_update_activity(&client_manager, client_sock);
-
-        if (buffer[0] == '/')
-        {
-            int cmd_result = process_command(client_sock, buffer);
-            if (cmd_result == -1)
-            {
-                break; // Cliente solicitou desconexão
-            }
-            continue;
-        }
+    session.capture_id = capture_connection_open(&traffic_capture, conn.ip);
+    session_start_timers(&session);
 
-        client = client_manager_find_by_socket(&client_manager, client_sock);
-        if (!client || !client->authenticated)
+    size_t pending = 0;
+    bool disconnect = false;
+    while (!disconnect && server_running &&
+           (bytes = recv(client_sock, buffer + pending, BUFFER_SIZE - 1 - pending, 0)) > 0)
+    {
+        session.ingest_ns = latency_now_ns();
+        metrics_add(METRIC_BYTES_IN, (uint64_t)bytes);
+        pending += (size_t)bytes;
+        buffer[pending] = '\0';
+
+        // Cada linha completa é uma mensagem; o resto espera o próximo recv
+        char *line = buffer;
+        char *newline;
+        while (!disconnect && (newline = memchr(line, '\n', pending - (size_t)(line - buffer))))
         {
-            const char *auth_required = "⚠ Você precisa se autenticar antes de enviar mensagens: /auth <senha>\n";
-            send(client_sock, auth_required, strlen(auth_required), MSG_NOSIGNAL);
-
-            char log_msg[512];
-            snprintf(log_msg, sizeof(log_msg),
-                     "Mensagem rejeitada (não autenticado) - %s: %s",
-                     client ? client->username : "unknown", buffer);
-            tslog_write(log_msg);
-            continue;
+            *newline = '\0';
+            disconnect = handle_line(&session, line) == -1;
+            line = newline + 1;
         }
 
-        if (contains_profanity(buffer))
+        pending -= (size_t)(line - buffer);
+        if (!disconnect && pending == BUFFER_SIZE - 1)
         {
-            const char *warning = "⚠ AVISO: Sua mensagem contém conteúdo proibido e foi bloqueada.\n";
-            send(client_sock, warning, strlen(warning), MSG_NOSIGNAL);
-
-            char log_msg[512];
-            snprintf(log_msg, sizeof(log_msg),
-                     "Mensagem bloqueada por filtro - %s: %s",
-                     client->username, buffer);
-            tslog_write(log_msg);
-            continue;
+            // Linha maior que o buffer: trata o que chegou, como antes
+            disconnect = handle_line(&session, buffer) == -1;
+            pending = 0;
         }
-
-        char formatted_msg[BUFFER_SIZE + 100];
-        snprintf(formatted_msg, sizeof(formatted_msg),
-                 "[%s]: %s\n", client->username, buffer);
-
-        Message msg;
-        msg.type = MSG_BROADCAST;
-        strncpy(msg.username, client->username, MAX_USERNAME_SIZE - 1);
-        msg.username[MAX_USERNAME_SIZE - 1] = '\0';
-        strncpy(msg.content, formatted_msg, MAX_MESSAGE_SIZE - 1);
-        msg.content[MAX_MESSAGE_SIZE - 1] = '\0';
-        msg.timestamp = time(NULL);
-        msg.sender_fd = client_sock;
-
-        if (tsqueue_enqueue(&message_queue, &msg) != 0)
-        {
-            const char *error = "⚠ Servidor ocupado, tente novamente.\n";
-            send(client_sock, error, strlen(error), MSG_NOSIGNAL);
-
-            char log_msg[256];
-            snprintf(log_msg, sizeof(log_msg),
-                     "Fila de mensagens cheia - mensagem descartada");
-            tslog_write(log_msg);
-        }
-
-        printf("[Chat] %s", formatted_msg);
+        memmove(buffer, line, pending);
     }
 
     client = client_manager_find_by_socket(&client_manager, client_sock);
     if (client && client->authenticated)
     {
-        Message leave_msg;
+        Message leave_msg = {0};
         leave_msg.type = MSG_LEAVE;
-        strncpy(leave_msg.username, client->username, MAX_USERNAME_SIZE - 1);
-        leave_msg.username[MAX_USERNAME_SIZE - 1] = '\0';
+        snprintf(leave_msg.username, sizeof(leave_msg.username), "%s", client->username);
         leave_msg.timestamp = time(NULL);
         leave_msg.sender_fd = client_sock;
-        tsqueue_enqueue(&message_queue, &leave_msg);
+        leave_msg.sender_id = client->connection_id;
+        leave_msg.room_id = client->room_id;
+        pipeline_stage_submit(&moderation_stage, &leave_msg);
     }
 
+    session_stop_timers(&session);
+    capture_connection_close(&traffic_capture, session.capture_id);
+    flight_record(FLIGHT_DISCONNECT, client_sock, 0, 0);
     close(client_sock);
     client_manager_remove(&client_manager, client_sock);
+    release_connection(&conn);
+    client_thread_exit();
 
     return NULL;
 }
 
+// Gauges e latências lidos só no momento da coleta do endpoint de métricas
+static void collect_server_metrics(MetricsBuffer *buffer, void *ctx)
+{
+    (void)ctx;
+
+    metrics_printf(buffer, "# HELP chat_clients Clientes conectados\n# TYPE chat_clients gauge\n");
+    metrics_printf(buffer, "chat_clients{state=\"connected\"} %d\n",
+                   client_manager_get_total_count(&client_manager));
+    metrics_printf(buffer, "chat_clients{state=\"authenticated\"} %d\n",
+                   client_manager_get_authenticated_count(&client_manager));
+
+    metrics_printf(buffer, "# HELP chat_queue_depth Mensagens aguardando em fila\n# TYPE chat_queue_depth gauge\n");
+    metrics_printf(buffer, "chat_queue_depth{queue=\"moderation\"} %d\n", pipeline_stage_depth(&moderation_stage));
+    metrics_printf(buffer, "chat_queue_depth{queue=\"broadcast\"} %d\n", tsqueue_size(&message_queue));
+
+    static const double quantiles[] = {0.5, 0.99, 0.999};
+    metrics_printf(buffer, "# HELP chat_message_latency_seconds Latência de broadcast por etapa\n"
+                           "# TYPE chat_message_latency_seconds summary\n");
+    for (int i = 0; i < LATENCY_STAGE_COUNT; i++)
+    {
+        const LatencyHistogram *hist = &stage_latency[i];
+        for (size_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); q++)
+        {
+            metrics_printf(buffer, "chat_message_latency_seconds{stage=\"%s\",quantile=\"%g\"} %.9f\n",
+                           latency_stage_names[i], quantiles[q],
+                           latency_histogram_percentile(hist, quantiles[q]) / 1e9);
+        }
+        metrics_printf(buffer, "chat_message_latency_seconds_sum{stage=\"%s\"} %.9f\n", latency_stage_names[i],
+                       atomic_load_explicit(&hist->sum, memory_order_relaxed) / 1e9);
+        metrics_printf(buffer, "chat_message_latency_seconds_count{stage=\"%s\"} %llu\n", latency_stage_names[i],
+                       (unsigned long long)latency_histogram_count(hist));
+    }
+
+    metrics_printf(buffer, "# HELP chat_command_duration_seconds Tempo de execução por comando\n"
+                           "# TYPE chat_command_duration_seconds summary\n");
+    for (int i = 0; i < command_registry.count; i++)
+    {
+        CommandSpec *spec = command_registry.commands[i];
+        for (size_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); q++)
+        {
+            metrics_printf(buffer, "chat_command_duration_seconds{command=\"%s\",quantile=\"%g\"} %.9f\n",
+                           spec->name + 1, quantiles[q],
+                           latency_histogram_percentile(&spec->latency, quantiles[q]) / 1e9);
+        }
+        metrics_printf(buffer, "chat_command_duration_seconds_sum{command=\"%s\"} %.9f\n", spec->name + 1,
+                       atomic_load_explicit(&spec->latency.sum, memory_order_relaxed) / 1e9);
+        metrics_printf(buffer, "chat_command_duration_seconds_count{command=\"%s\"} %llu\n", spec->name + 1,
+                       (unsigned long long)latency_histogram_count(&spec->latency));
+    }
+}
+
 int main()
 {
     struct sockaddr_in server_addr, client_addr;
@@ -448,11 +1247,134 @@ int main()
     tslog_init("server.log");
 
     tslog_write("=== SERVIDOR DE CHAT INICIANDO ===");
+    metrics_init();
+    for (int i = 0; i < LATENCY_STAGE_COUNT; i++)
+        latency_histogram_init(&stage_latency[i]);
+
+    if (moderation_init(getenv("CHAT_FILTER_FILE")) != 0)
+    {
+        fprintf(stderr, "ERRO: Falha ao inicializar filtro de palavras\n");
+        TSLOG_ERROR(TSLOG_CAT_GENERAL, "Falha ao inicializar filtro de palavras");
+        tslog_close();
+        exit(EXIT_FAILURE);
+    }
+    signal(SIGHUP, reload_signal_handler);
+
+    if (flight_recorder_init(getenv("CHAT_FLIGHT_FILE")) != 0)
+        TSLOG_WARN(TSLOG_CAT_GENERAL, "Não foi possível instalar o flight recorder");
+
+    rate_limiter_init(&rate_limiter);
+    const char *rate_envs[RATE_CLASS_COUNT] = {"CHAT_RATE_BROADCAST", "CHAT_RATE_PRIVATE", "CHAT_RATE_COMMAND"};
+    for (int c = 0; c < RATE_CLASS_COUNT; c++)
+    {
+        const char *spec = getenv(rate_envs[c]);
+        if (spec && rate_limiter_configure(&rate_limiter, (RateClass)c, spec) != 0)
+            TSLOG_WARN(TSLOG_CAT_GENERAL, "%s inválido (%s); usando o padrão", rate_envs[c], spec);
+    }
+    const char *rate_policy = getenv("CHAT_RATE_POLICY");
+    if (rate_policy && strcmp(rate_policy, "delay") == 0)
+        rate_limiter.policy = RATE_POLICY_DELAY;
+
+    if (admission_init(&admission_table) != 0)
+    {
+        fprintf(stderr, "ERRO: Falha ao inicializar controle de admissão\n");
+        TSLOG_ERROR(TSLOG_CAT_GENERAL, "Falha ao inicializar controle de admissão");
+        tslog_close();
+        exit(EXIT_FAILURE);
+    }
+    const char *admission_rate = getenv("CHAT_ADMISSION_RATE");
+    if (admission_rate && admission_configure_rate(&admission_table, admission_rate) != 0)
+        TSLOG_WARN(TSLOG_CAT_GENERAL, "CHAT_ADMISSION_RATE inválido (%s); usando o padrão", admission_rate);
+    const char *admission_max = getenv("CHAT_ADMISSION_MAX_PER_IP");
+    if (admission_max)
+        admission_table.max_per_ip = (uint32_t)strtoul(admission_max, NULL, 10);
+
+    const char *auth_timeout_env = getenv("CHAT_AUTH_TIMEOUT");
+    const char *heartbeat_env = getenv("CHAT_HEARTBEAT_INTERVAL");
+    const char *idle_timeout_env = getenv("CHAT_IDLE_TIMEOUT");
+    auth_timeout_ms = 1000u * (auth_timeout_env ? (uint32_t)strtoul(auth_timeout_env, NULL, 10)
+                                                : AUTH_TIMEOUT_DEFAULT_S);
+    heartbeat_interval_ms = 1000u * (heartbeat_env ? (uint32_t)strtoul(heartbeat_env, NULL, 10)
+                                                   : HEARTBEAT_INTERVAL_DEFAULT_S);
+    idle_timeout_ms = 1000u * (idle_timeout_env ? (uint32_t)strtoul(idle_timeout_env, NULL, 10)
+                                                : IDLE_TIMEOUT_DEFAULT_S);
+    if (timer_wheel_init(&timer_wheel, TIMER_WHEEL_DEFAULT_TICK_MS) != 0 ||
+        timer_wheel_start(&timer_wheel) != 0)
+    {
+        fprintf(stderr, "ERRO: Falha ao iniciar roda de timers\n");
+        TSLOG_ERROR(TSLOG_CAT_GENERAL, "Falha ao iniciar roda de timers");
+        tslog_close();
+        exit(EXIT_FAILURE);
+    }
+
+    if (register_commands() != 0)
+    {
+        fprintf(stderr, "ERRO: Falha ao montar tabela de comandos\n");
+        TSLOG_ERROR(TSLOG_CAT_GENERAL, "Falha ao montar tabela de comandos");
+        tslog_close();
+        exit(EXIT_FAILURE);
+    }
 
     if (client_manager_init(&client_manager) != 0)
     {
         fprintf(stderr, "ERRO: Falha ao inicializar gerenciador de clientes\n");
-        tslog_write("ERRO: Falha ao inicializar gerenciador de clientes");
+        TSLOG_ERROR(TSLOG_CAT_GENERAL, "Falha ao inicializar gerenciador de clientes");
+        tslog_close();
+        exit(EXIT_FAILURE);
+    }
+
+    const char *history_env = getenv("CHAT_HISTORY_BYTES");
+    if (message_history_init(&message_history, history_env ? strtoul(history_env, NULL, 10) : 0) != 0)
+    {
+        fprintf(stderr, "ERRO: Falha ao inicializar histórico de mensagens\n");
+        TSLOG_ERROR(TSLOG_CAT_GENERAL, "Falha ao inicializar histórico de mensagens");
+        client_manager_destroy(&client_manager);
+        tslog_close();
+        exit(EXIT_FAILURE);
+    }
+
+    const char *journal_path = getenv("CHAT_JOURNAL_FILE");
+    const char *flush_ms_env = getenv("CHAT_JOURNAL_FLUSH_MS");
+    const char *flush_bytes_env = getenv("CHAT_JOURNAL_FLUSH_BYTES");
+    const char *retain_env = getenv("CHAT_JOURNAL_RETAIN_BYTES");
+    if (!journal_path)
+        journal_path = JOURNAL_DEFAULT_PATH;
+
+    if (journal_recover(journal_path, replay_journal_record, NULL) < 0 ||
+        journal_open(&journal, journal_path, flush_ms_env ? atoi(flush_ms_env) : 0,
+                     flush_bytes_env ? strtoul(flush_bytes_env, NULL, 10) : 0,
+                     retain_env ? strtoull(retain_env, NULL, 10) : JOURNAL_DEFAULT_RETAIN_BYTES) != 0)
+    {
+        fprintf(stderr, "ERRO: Falha ao abrir journal %s\n", journal_path);
+        TSLOG_ERROR(TSLOG_CAT_GENERAL, "Falha ao abrir journal %s", journal_path);
+        message_history_destroy(&message_history);
+        client_manager_destroy(&client_manager);
+        tslog_close();
+        exit(EXIT_FAILURE);
+    }
+
+    if (search_index_open(&search_index, getenv("CHAT_SEARCH_FILE"), journal_path) != 0 ||
+        search_index_start(&search_index, &journal) != 0)
+    {
+        fprintf(stderr, "ERRO: Falha ao abrir índice de busca\n");
+        TSLOG_ERROR(TSLOG_CAT_GENERAL, "Falha ao abrir índice de busca");
+        journal_close(&journal);
+        message_history_destroy(&message_history);
+        client_manager_destroy(&client_manager);
+        tslog_close();
+        exit(EXIT_FAILURE);
+    }
+
+    const char *mailbox_ttl_env = getenv("CHAT_MAILBOX_TTL");
+    if (mailbox_open(&mailbox_store, getenv("CHAT_MAILBOX_FILE"),
+                     mailbox_ttl_env ? (time_t)atol(mailbox_ttl_env) : 0) != 0)
+    {
+        fprintf(stderr, "ERRO: Falha ao abrir caixa de mensagens offline\n");
+        TSLOG_ERROR(TSLOG_CAT_GENERAL, "Falha ao abrir caixa de mensagens offline");
+        search_index_close(&search_index);
+        journal_close(&journal);
+        message_history_destroy(&message_history);
+        client_manager_destroy(&client_manager);
         tslog_close();
         exit(EXIT_FAILURE);
     }
@@ -460,7 +1382,7 @@ int main()
     if (tsqueue_init(&message_queue) != 0)
     {
         fprintf(stderr, "ERRO: Falha ao inicializar fila de mensagens\n");
-        tslog_write("ERRO: Falha ao inicializar fila de mensagens");
+        TSLOG_ERROR(TSLOG_CAT_GENERAL, "Falha ao inicializar fila de mensagens");
         client_manager_destroy(&client_manager);
         tslog_close();
         exit(EXIT_FAILURE);
@@ -469,7 +1391,7 @@ int main()
     if ((server_socket = socket(AF_INET, SOCK_STREAM, 0)) < 0)
     {
         perror("ERRO: Falha ao criar socket");
-        tslog_write("ERRO: Falha ao criar socket do servidor");
+        TSLOG_ERROR(TSLOG_CAT_GENERAL, "Falha ao criar socket do servidor");
         tsqueue_destroy(&message_queue);
         client_manager_destroy(&client_manager);
         tslog_close();
@@ -480,7 +1402,7 @@ int main()
     if (setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0)
     {
         perror("ERRO: Falha no setsockopt");
-        tslog_write("ERRO: Falha ao configurar socket (setsockopt)");
+        TSLOG_ERROR(TSLOG_CAT_GENERAL, "Falha ao configurar socket (setsockopt)");
         close(server_socket);
         tsqueue_destroy(&message_queue);
         client_manager_destroy(&client_manager);
@@ -496,7 +1418,7 @@ int main()
     if (bind(server_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0)
     {
         perror("ERRO: Falha no bind");
-        tslog_write("ERRO: Falha ao fazer bind do socket");
+        TSLOG_ERROR(TSLOG_CAT_GENERAL, "Falha ao fazer bind do socket");
         close(server_socket);
         tsqueue_destroy(&message_queue);
         client_manager_destroy(&client_manager);
@@ -507,7 +1429,7 @@ int main()
     if (listen(server_socket, BACKLOG) < 0)
     {
         perror("ERRO: Falha no listen");
-        tslog_write("ERRO: Falha ao colocar socket em modo listen");
+        TSLOG_ERROR(TSLOG_CAT_GENERAL, "Falha ao colocar socket em modo listen");
         close(server_socket);
         tsqueue_destroy(&message_queue);
         client_manager_destroy(&client_manager);
@@ -518,7 +1440,7 @@ int main()
     if (pthread_create(&broadcast_thread, NULL, broadcast_worker, NULL) != 0)
     {
         perror("ERRO: Falha ao criar thread de broadcast");
-        tslog_write("ERRO: Falha ao criar thread de broadcast");
+        TSLOG_ERROR(TSLOG_CAT_GENERAL, "Falha ao criar thread de broadcast");
         close(server_socket);
         tsqueue_destroy(&message_queue);
         client_manager_destroy(&client_manager);
@@ -526,13 +1448,36 @@ int main()
         exit(EXIT_FAILURE);
     }
 
+    const char *workers_env = getenv("CHAT_MODERATION_WORKERS");
+    if (pipeline_stage_init(&moderation_stage, workers_env ? atoi(workers_env) : 0,
+                            moderation_accept, moderation_reject) != 0 ||
+        pipeline_stage_add_check(&moderation_stage, "filtro", profanity_check) != 0 ||
+        pipeline_stage_start(&moderation_stage) != 0)
+    {
+        fprintf(stderr, "ERRO: Falha ao iniciar estágio de moderação\n");
+        TSLOG_ERROR(TSLOG_CAT_GENERAL, "Falha ao iniciar estágio de moderação");
+        exit(EXIT_FAILURE);
+    }
+
+    const char *metrics_port_env = getenv("CHAT_METRICS_PORT");
+    int metrics_port = metrics_port_env ? atoi(metrics_port_env) : METRICS_DEFAULT_PORT;
+    if (metrics_start(metrics_port, collect_server_metrics, NULL) != 0)
+        TSLOG_WARN(TSLOG_CAT_NET, "Não foi possível abrir a porta de métricas %d; seguindo sem métricas",
+                   metrics_port);
+
+    const char *capture_path = getenv("CHAT_CAPTURE_FILE");
+    if (capture_open(&traffic_capture, capture_path) != 0)
+        TSLOG_WARN(TSLOG_CAT_NET, "Não foi possível abrir a captura %s; seguindo sem captura", capture_path);
+    else if (capture_path && capture_path[0])
+        TSLOG_INFO(TSLOG_CAT_NET, "Capturando tráfego de entrada em %s", capture_path);
+
     printf("✓ Componentes inicializados com sucesso\n");
     printf("✓ Servidor rodando na porta %d\n", PORT);
     printf("✓ Thread de broadcast ativa\n");
     printf("✓ Aguardando conexões...\n");
     printf("✓ Pressione Ctrl+C para finalizar graciosamente\n\n");
 
-    tslog_write("Servidor de chat iniciado com sucesso na porta 8080");
+    TSLOG_INFO(TSLOG_CAT_NET, "Servidor de chat iniciado com sucesso na porta %d", PORT);
 
     while (server_running)
     {
@@ -545,7 +1490,7 @@ int main()
                 if (errno != EINTR)
                 {
                     perror("ERRO: Falha no accept");
-                    tslog_write("ERRO: Falha ao aceitar conexão de cliente");
+                    TSLOG_ERROR(TSLOG_CAT_NET, "Falha ao aceitar conexão de cliente");
                 }
                 continue;
             }
@@ -555,6 +1500,19 @@ int main()
             }
         }
 
+        // Admissão antes de qualquer alocação, thread, boas-vindas ou log
+        ClientConnection conn = {.sock = client_sock, .ip = client_addr.sin_addr.s_addr, .admitted = false};
+        AdmissionResult admission = admission_admit(&admission_table, conn.ip);
+        if (admission == ADMISSION_REJECT_RATE || admission == ADMISSION_REJECT_CONCURRENT)
+        {
+            metrics_inc(METRIC_CONNECTIONS_REJECTED);
+            CHAT_PROBE2(connection_reject, conn.ip, admission);
+            flight_record(FLIGHT_REJECT, client_sock, conn.ip, (uint64_t)admission);
+            reject_connection(client_sock);
+            continue;
+        }
+        conn.admitted = admission == ADMISSION_OK;
+
         char client_ip[INET_ADDRSTRLEN];
         inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
         int client_port = ntohs(client_addr.sin_port);
@@ -564,11 +1522,11 @@ int main()
             const char *full_msg = "Servidor lotado! Tente novamente mais tarde.\n";
             send(client_sock, full_msg, strlen(full_msg), MSG_NOSIGNAL);
             close(client_sock);
+            release_connection(&conn);
+            metrics_inc(METRIC_CONNECTIONS_REJECTED);
 
-            char log_msg[256];
-            snprintf(log_msg, sizeof(log_msg),
-                     "Conexão rejeitada (servidor lotado): %s:%d", client_ip, client_port);
-            tslog_write(log_msg);
+            TSLOG_WARN(TSLOG_CAT_NET, "Conexão rejeitada (servidor lotado): %s:%d",
+                       client_ip, client_port);
             continue;
         }
 
@@ -580,33 +1538,42 @@ int main()
         {
             fprintf(stderr, "ERRO: Não foi possível adicionar cliente\n");
             close(client_sock);
+            release_connection(&conn);
             continue;
         }
 
-        char log_msg[256];
-        snprintf(log_msg, sizeof(log_msg),
-                 "Nova conexão aceita: %s:%d (socket %d, username: %s)",
-                 client_ip, client_port, client_sock, temp_username);
-        tslog_write(log_msg);
-        printf("[Servidor] %s\n", log_msg);
+        metrics_inc(METRIC_CONNECTIONS_ACCEPTED);
+        CHAT_PROBE2(connection_accept, client_sock, conn.ip);
+        flight_record(FLIGHT_ACCEPT, client_sock, conn.ip, 0);
+        TSLOG_INFO(TSLOG_CAT_NET, "Nova conexão aceita: %s:%d (socket %d, username: %s)",
+                   client_ip, client_port, client_sock, temp_username);
+        printf("[Servidor] Nova conexão aceita: %s:%d (socket %d, username: %s)\n",
+               client_ip, client_port, client_sock, temp_username);
 
-        int *new_sock = malloc(sizeof(int));
-        if (!new_sock)
+        ClientConnection *new_conn = malloc(sizeof(ClientConnection));
+        if (!new_conn)
         {
             perror("ERRO: Falha ao alocar memória");
             close(client_sock);
             client_manager_remove(&client_manager, client_sock);
+            release_connection(&conn);
             continue;
         }
 
-        *new_sock = client_sock;
+        *new_conn = conn;
 
-        if (pthread_create(&tid, NULL, handle_client, new_sock) != 0)
+        pthread_mutex_lock(&client_threads_mutex);
+        client_threads++;
+        pthread_mutex_unlock(&client_threads_mutex);
+
+        if (pthread_create(&tid, NULL, handle_client, new_conn) != 0)
         {
             perror("ERRO: Falha ao criar thread do cliente");
-            free(new_sock);
+            client_thread_exit();
+            free(new_conn);
             close(client_sock);
             client_manager_remove(&client_manager, client_sock);
+            release_connection(&conn);
             continue;
         }
 
@@ -616,7 +1583,78 @@ int main()
     printf("\n[Servidor] Iniciando processo de finalização...\n");
     tslog_write("Iniciando finalização gracioso do servidor");
 
-    Message shutdown_msg;
+    // Primeiro as conexões: as saídas (MSG_LEAVE) ainda passam pela moderação
+    printf("[Servidor] Aguardando threads de clientes finalizarem...\n");
+    stop_client_threads();
+
+    // Drena o estágio de moderação com o broadcast ainda consumindo a fila;
+    // o SHUTDOWN do broadcast só entra depois, atrás das últimas mensagens
+    pipeline_stage_stop(&moderation_stage);
+
+    PipelineStats stage_stats;
+    pipeline_stage_get_stats(&moderation_stage, &stage_stats);
+    TSLOG_INFO(TSLOG_CAT_BROADCAST,
+               "Moderação: %llu aceitas, %llu bloqueadas, fila p50/p99 %llu/%llu ns, "
+               "verificação p50/p99 %llu/%llu ns",
+               (unsigned long long)stage_stats.accepted, (unsigned long long)stage_stats.rejected,
+               (unsigned long long)stage_stats.queue_p50_ns, (unsigned long long)stage_stats.queue_p99_ns,
+               (unsigned long long)stage_stats.check_p50_ns, (unsigned long long)stage_stats.check_p99_ns);
+
+    for (int c = 0; c < RATE_CLASS_COUNT; c++)
+    {
+        TSLOG_INFO(TSLOG_CAT_NET, "Limite %s: %llu aceitas, %llu atrasadas, %llu rejeitadas",
+                   rate_class_name((RateClass)c),
+                   (unsigned long long)atomic_load(&rate_limiter.allowed[c]),
+                   (unsigned long long)atomic_load(&rate_limiter.delayed[c]),
+                   (unsigned long long)atomic_load(&rate_limiter.rejected[c]));
+    }
+
+    TSLOG_INFO(TSLOG_CAT_NET, "Admissão: %llu aceitas, %llu sem rastreio, %llu rejeitadas por taxa, "
+               "%llu por concorrência",
+               (unsigned long long)atomic_load(&admission_table.admitted),
+               (unsigned long long)atomic_load(&admission_table.untracked),
+               (unsigned long long)atomic_load(&admission_table.rejected_rate),
+               (unsigned long long)atomic_load(&admission_table.rejected_concurrent));
+
+    capture_close(&traffic_capture);
+    if (atomic_load(&traffic_capture.connections) > 0)
+        TSLOG_INFO(TSLOG_CAT_NET, "Captura: %llu conexões, %llu linhas, %llu bytes gravados, %llu erros de escrita",
+                   (unsigned long long)atomic_load(&traffic_capture.connections),
+                   (unsigned long long)atomic_load(&traffic_capture.lines),
+                   (unsigned long long)atomic_load(&traffic_capture.bytes),
+                   (unsigned long long)atomic_load(&traffic_capture.write_errors));
+
+    timer_wheel_stop(&timer_wheel);
+    metrics_stop();
+    TSLOG_INFO(TSLOG_CAT_NET, "Timers: %llu agendados, %llu cancelados, %llu disparados; desconexões: "
+               "%llu sem autenticação, %llu por inatividade, %llu sem resposta ao ping",
+               (unsigned long long)atomic_load(&timer_wheel.scheduled),
+               (unsigned long long)atomic_load(&timer_wheel.cancelled),
+               (unsigned long long)atomic_load(&timer_wheel.fired),
+               (unsigned long long)atomic_load(&auth_timeouts),
+               (unsigned long long)atomic_load(&idle_disconnects),
+               (unsigned long long)atomic_load(&heartbeat_disconnects));
+
+    for (int i = 0; i < LATENCY_STAGE_COUNT; i++)
+    {
+        TSLOG_INFO(TSLOG_CAT_BROADCAST, "Latência %s: %llu amostras, p50/p99/p999 %llu/%llu/%llu ns",
+                   latency_stage_names[i], (unsigned long long)latency_histogram_count(&stage_latency[i]),
+                   (unsigned long long)latency_histogram_percentile(&stage_latency[i], 0.50),
+                   (unsigned long long)latency_histogram_percentile(&stage_latency[i], 0.99),
+                   (unsigned long long)latency_histogram_percentile(&stage_latency[i], 0.999));
+    }
+
+    for (int i = 0; i < command_registry.count; i++)
+    {
+        CommandSpec *spec = command_registry.commands[i];
+        TSLOG_INFO(TSLOG_CAT_GENERAL, "Comando %s: %llu chamadas, p50/p99 %llu/%llu ns",
+                   spec->name,
+                   (unsigned long long)atomic_load_explicit(&spec->calls, memory_order_relaxed),
+                   (unsigned long long)latency_histogram_percentile(&spec->latency, 0.50),
+                   (unsigned long long)latency_histogram_percentile(&spec->latency, 0.99));
+    }
+
+    Message shutdown_msg = {0};
     shutdown_msg.type = MSG_BROADCAST;
     strcpy(shutdown_msg.content, "SHUTDOWN");
     shutdown_msg.timestamp = time(NULL);
@@ -633,8 +1671,17 @@ int main()
     }
 
     printf("[Servidor] Finalizando componentes...\n");
+    pipeline_stage_destroy(&moderation_stage);
+    command_registry_destroy(&command_registry);
     tsqueue_destroy(&message_queue);
+    search_index_close(&search_index);
+    journal_close(&journal);
+    mailbox_close(&mailbox_store);
+    message_history_destroy(&message_history);
     client_manager_destroy(&client_manager);
+    admission_destroy(&admission_table);
+    timer_wheel_destroy(&timer_wheel);
+    moderation_shutdown();
 
     tslog_write("=== SERVIDOR DE CHAT FINALIZADO ===");
     tslog_close();
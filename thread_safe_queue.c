@@ -1,4 +1,6 @@
 #include "thread_safe_queue.h"
+#include "probes.h"
+#include "flight_recorder.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -49,6 +51,8 @@ int tsqueue_enqueue(ThreadSafeQueue *queue, const Message *msg)
     memcpy(&queue->messages[queue->rear], msg, sizeof(Message));
     queue->rear = (queue->rear + 1) % queue->capacity;
     queue->count++;
+    CHAT_PROBE2(queue_enqueue, queue, queue->count);
+    flight_record(FLIGHT_ENQUEUE, -1, (uintptr_t)queue, (uint64_t)queue->count);
 
     pthread_cond_signal(&queue->not_empty);
 
@@ -71,6 +75,8 @@ int tsqueue_dequeue(ThreadSafeQueue *queue, Message *msg)
     memcpy(msg, &queue->messages[queue->front], sizeof(Message));
     queue->front = (queue->front + 1) % queue->capacity;
     queue->count--;
+    CHAT_PROBE2(queue_dequeue, queue, queue->count);
+    flight_record(FLIGHT_DEQUEUE, -1, (uintptr_t)queue, (uint64_t)queue->count);
 
     pthread_cond_signal(&queue->not_full);
 
@@ -94,6 +100,8 @@ int tsqueue_try_enqueue(ThreadSafeQueue *queue, const Message *msg)
     memcpy(&queue->messages[queue->rear], msg, sizeof(Message));
     queue->rear = (queue->rear + 1) % queue->capacity;
     queue->count++;
+    CHAT_PROBE2(queue_enqueue, queue, queue->count);
+    flight_record(FLIGHT_ENQUEUE, -1, (uintptr_t)queue, (uint64_t)queue->count);
 
     pthread_cond_signal(&queue->not_empty);
 
@@ -117,6 +125,8 @@ int tsqueue_try_dequeue(ThreadSafeQueue *queue, Message *msg)
     memcpy(msg, &queue->messages[queue->front], sizeof(Message));
     queue->front = (queue->front + 1) % queue->capacity;
     queue->count--;
+    CHAT_PROBE2(queue_dequeue, queue, queue->count);
+    flight_record(FLIGHT_DEQUEUE, -1, (uintptr_t)queue, (uint64_t)queue->count);
 
     pthread_cond_signal(&queue->not_full);
 
@@ -4,6 +4,7 @@
 #include <pthread.h>
 #include <stdbool.h>
 #include <time.h>
+#include <stdint.h>
 
 #define MAX_QUEUE_SIZE 1000
 #define MAX_MESSAGE_SIZE 1024
@@ -12,9 +13,10 @@
 typedef enum
 {
     MSG_BROADCAST,
-    MSG_PRIVATE,
     MSG_JOIN,
     MSG_LEAVE,
+    MSG_ROOM_JOIN,
+    MSG_ROOM_PART,
     MSG_AUTH,
     MSG_ERROR
 } MessageType;
@@ -24,9 +26,12 @@ typedef struct
     MessageType type;
     char username[MAX_USERNAME_SIZE];
     char content[MAX_MESSAGE_SIZE];
-    char target[MAX_USERNAME_SIZE]; // Para mensagens privadas
     time_t timestamp;
+    uint64_t ingest_ns;  // recv que trouxe a linha (monotônico); 0 = gerada pelo servidor
+    uint64_t enqueue_ns; // Instante (monotônico) da última entrada em fila
     int sender_fd;
+    uint64_t sender_id; // ClientInfo.connection_id: o fd pode ter sido reusado quando a resposta sair
+    int room_id; // Sala de destino dos broadcasts e avisos
 } Message;
 
 typedef struct
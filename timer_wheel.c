@@ -0,0 +1,278 @@
+#include "timer_wheel.h"
+#include <string.h>
+#include <time.h>
+
+#define LEVEL_SHIFT(level) ((level) * TIMER_WHEEL_SLOT_BITS)
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+
+static uint64_t monotonic_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+static uint64_t elapsed_ticks(const TimerWheel *wheel)
+{
+    return (monotonic_ms() - wheel->start_ms) / wheel->tick_ms;
+}
+
+static void list_init(TimerEntry *head)
+{
+    head->next = head;
+    head->prev = head;
+}
+
+static void list_add_tail(TimerEntry *head, TimerEntry *timer)
+{
+    timer->prev = head->prev;
+    timer->next = head;
+    head->prev->next = timer;
+    head->prev = timer;
+}
+
+static void list_unlink(TimerEntry *timer)
+{
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->next = timer->prev = NULL;
+}
+
+// Move todos os timers de head para work (que deve estar vazia)
+static void list_splice(TimerEntry *head, TimerEntry *work)
+{
+    if (head->next == head)
+        return;
+
+    work->next = head->next;
+    work->prev = head->prev;
+    work->next->prev = work;
+    work->prev->next = work;
+    list_init(head);
+}
+
+// Nível escolhido pela distância até o vencimento: o nível n guarda timers que
+// vencem em menos de 64^(n+1) ticks, na posição dada pelos bits do nível n.
+static void insert_locked(TimerWheel *wheel, TimerEntry *timer)
+{
+    if (timer->expires < wheel->current_tick)
+        timer->expires = wheel->current_tick;
+
+    uint64_t delta = timer->expires - wheel->current_tick;
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1ULL << LEVEL_SHIFT(level + 1)))
+        level++;
+
+    uint64_t max_delta = (1ULL << LEVEL_SHIFT(TIMER_WHEEL_LEVELS)) - 1;
+    if (delta > max_delta)
+        timer->expires = wheel->current_tick + max_delta;
+
+    int slot = (int)((timer->expires >> LEVEL_SHIFT(level)) & SLOT_MASK);
+    list_add_tail(&wheel->slots[level][slot], timer);
+}
+
+// Redistribui uma posição de nível superior pelos níveis de baixo
+static int cascade_locked(TimerWheel *wheel, int level)
+{
+    int slot = (int)((wheel->current_tick >> LEVEL_SHIFT(level)) & SLOT_MASK);
+    TimerEntry work;
+    list_init(&work);
+    list_splice(&wheel->slots[level][slot], &work);
+
+    while (work.next != &work)
+    {
+        TimerEntry *timer = work.next;
+        list_unlink(timer);
+        insert_locked(wheel, timer);
+    }
+    return slot;
+}
+
+static void run_tick_locked(TimerWheel *wheel)
+{
+    int index = (int)(wheel->current_tick & SLOT_MASK);
+    for (int level = 1; index == 0 && level < TIMER_WHEEL_LEVELS; level++)
+        index = cascade_locked(wheel, level);
+
+    index = (int)(wheel->current_tick & SLOT_MASK);
+    wheel->current_tick++;
+
+    // Lista local: callbacks podem reagendar para a posição que está sendo esvaziada
+    TimerEntry work;
+    list_init(&work);
+    list_splice(&wheel->slots[0][index], &work);
+
+    while (work.next != &work)
+    {
+        TimerEntry *timer = work.next;
+        list_unlink(timer);
+        timer->pending = false;
+        wheel->running_timer = timer;
+
+        pthread_mutex_unlock(&wheel->mutex);
+        timer->fn(timer->arg);
+        atomic_fetch_add_explicit(&wheel->fired, 1, memory_order_relaxed);
+        pthread_mutex_lock(&wheel->mutex);
+
+        wheel->running_timer = NULL;
+        pthread_cond_broadcast(&wheel->callback_done);
+    }
+}
+
+static void *wheel_worker(void *arg)
+{
+    TimerWheel *wheel = arg;
+
+    pthread_mutex_lock(&wheel->mutex);
+    while (wheel->running)
+    {
+        uint64_t target = elapsed_ticks(wheel);
+        while (wheel->running && wheel->current_tick <= target)
+            run_tick_locked(wheel);
+
+        uint64_t next_ms = wheel->start_ms + wheel->current_tick * wheel->tick_ms;
+        struct timespec deadline = {.tv_sec = (time_t)(next_ms / 1000),
+                                    .tv_nsec = (long)(next_ms % 1000) * 1000000L};
+        if (wheel->running)
+            pthread_cond_timedwait(&wheel->wake, &wheel->mutex, &deadline);
+    }
+    pthread_mutex_unlock(&wheel->mutex);
+
+    return NULL;
+}
+
+int timer_wheel_init(TimerWheel *wheel, uint32_t tick_ms)
+{
+    if (!wheel)
+        return -1;
+
+    memset(wheel, 0, sizeof(*wheel));
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++)
+    {
+        for (int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++)
+            list_init(&wheel->slots[level][slot]);
+    }
+    wheel->tick_ms = tick_ms > 0 ? tick_ms : TIMER_WHEEL_DEFAULT_TICK_MS;
+    wheel->start_ms = monotonic_ms();
+    atomic_init(&wheel->scheduled, 0);
+    atomic_init(&wheel->cancelled, 0);
+    atomic_init(&wheel->fired, 0);
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+    int result = 0;
+    if (pthread_mutex_init(&wheel->mutex, NULL) != 0 ||
+        pthread_cond_init(&wheel->wake, &attr) != 0 ||
+        pthread_cond_init(&wheel->callback_done, NULL) != 0)
+        result = -1;
+
+    pthread_condattr_destroy(&attr);
+    return result;
+}
+
+int timer_wheel_start(TimerWheel *wheel)
+{
+    if (!wheel)
+        return -1;
+
+    wheel->running = true;
+    if (pthread_create(&wheel->thread, NULL, wheel_worker, wheel) != 0)
+    {
+        wheel->running = false;
+        return -1;
+    }
+    return 0;
+}
+
+void timer_wheel_stop(TimerWheel *wheel)
+{
+    if (!wheel || !wheel->running)
+        return;
+
+    pthread_mutex_lock(&wheel->mutex);
+    wheel->running = false;
+    pthread_cond_signal(&wheel->wake);
+    pthread_mutex_unlock(&wheel->mutex);
+
+    pthread_join(wheel->thread, NULL);
+}
+
+void timer_wheel_destroy(TimerWheel *wheel)
+{
+    if (!wheel)
+        return;
+
+    timer_wheel_stop(wheel);
+    pthread_cond_destroy(&wheel->wake);
+    pthread_cond_destroy(&wheel->callback_done);
+    pthread_mutex_destroy(&wheel->mutex);
+}
+
+void timer_init(TimerEntry *timer, TimerCallback fn, void *arg)
+{
+    if (!timer)
+        return;
+
+    timer->next = timer->prev = NULL;
+    timer->expires = 0;
+    timer->fn = fn;
+    timer->arg = arg;
+    timer->pending = false;
+    timer->cancelled = false;
+}
+
+void timer_schedule(TimerWheel *wheel, TimerEntry *timer, uint32_t delay_ms)
+{
+    if (!wheel || !timer || !timer->fn)
+        return;
+
+    pthread_mutex_lock(&wheel->mutex);
+
+    if (timer->cancelled)
+    {
+        pthread_mutex_unlock(&wheel->mutex);
+        return;
+    }
+
+    if (timer->pending)
+        list_unlink(timer);
+
+    uint64_t now = elapsed_ticks(wheel);
+    if (now < wheel->current_tick)
+        now = wheel->current_tick;
+    timer->expires = now + (delay_ms + wheel->tick_ms - 1) / wheel->tick_ms;
+    insert_locked(wheel, timer);
+    timer->pending = true;
+
+    pthread_mutex_unlock(&wheel->mutex);
+
+    atomic_fetch_add_explicit(&wheel->scheduled, 1, memory_order_relaxed);
+}
+
+void timer_cancel(TimerWheel *wheel, TimerEntry *timer)
+{
+    if (!wheel || !timer)
+        return;
+
+    pthread_mutex_lock(&wheel->mutex);
+
+    // Marca antes de esperar: um callback em execução que se reagende
+    // (heartbeat_check) não volta para a roda
+    timer->cancelled = true;
+
+    // Dentro do próprio callback não há o que esperar
+    bool in_wheel_thread = wheel->running && pthread_equal(pthread_self(), wheel->thread);
+    while (wheel->running_timer == timer && !in_wheel_thread)
+        pthread_cond_wait(&wheel->callback_done, &wheel->mutex);
+
+    if (timer->pending)
+    {
+        list_unlink(timer);
+        timer->pending = false;
+        atomic_fetch_add_explicit(&wheel->cancelled, 1, memory_order_relaxed);
+    }
+
+    pthread_mutex_unlock(&wheel->mutex);
+}
@@ -0,0 +1,66 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_DEFAULT_TICK_MS 100 // 4 níveis de 64 posições: ~19 dias de alcance
+
+// Chamada pela thread da roda, sem o mutex travado. Pode reagendar o próprio timer.
+typedef void (*TimerCallback)(void *arg);
+
+// Intrusivo: quem usa embute o TimerEntry na própria estrutura, então agendar
+// e cancelar são O(1) e não alocam.
+typedef struct TimerEntry
+{
+    struct TimerEntry *next;
+    struct TimerEntry *prev;
+    uint64_t expires; // Em ticks
+    TimerCallback fn;
+    void *arg;
+    bool pending;
+    bool cancelled; // timer_schedule ignora o timer até o próximo timer_init
+} TimerEntry;
+
+typedef struct
+{
+    TimerEntry slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS]; // Sentinelas de listas circulares
+    uint64_t current_tick;
+    uint64_t start_ms;
+    uint32_t tick_ms;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_cond_t callback_done;
+    pthread_t thread;
+    bool running;
+    TimerEntry *running_timer; // Callback em execução (para o cancelamento síncrono)
+
+    atomic_uint_fast64_t scheduled;
+    atomic_uint_fast64_t cancelled;
+    atomic_uint_fast64_t fired;
+} TimerWheel;
+
+int timer_wheel_init(TimerWheel *wheel, uint32_t tick_ms);
+int timer_wheel_start(TimerWheel *wheel);
+
+// Para a thread; timers ainda pendentes não disparam mais
+void timer_wheel_stop(TimerWheel *wheel);
+void timer_wheel_destroy(TimerWheel *wheel);
+
+void timer_init(TimerEntry *timer, TimerCallback fn, void *arg);
+
+// Agenda (ou reagenda) para daqui a delay_ms, arredondado para cima em ticks
+void timer_schedule(TimerWheel *wheel, TimerEntry *timer, uint32_t delay_ms);
+
+// Remove o timer. Se o callback estiver rodando em outra thread, espera ele
+// terminar: depois do retorno a memória do timer pode ser liberada. O
+// cancelamento é definitivo: um callback que tente se reagendar não consegue.
+void timer_cancel(TimerWheel *wheel, TimerEntry *timer);
+
+#endif
@@ -1,52 +1,393 @@
+#define _GNU_SOURCE
 #include "tslog.h"
 #include <stdio.h>
+#include <stdarg.h>
+#include <strings.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <limits.h>
 #include <pthread.h>
+#include <sched.h>
 #include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-static FILE *arquivo_log = NULL;
-static pthread_mutex_t mutex_log;
+#define TSLOG_LINE_MAX 4096
 
-void tslog_init(const char *nome_arquivo)
+// O cursor guarda a geração do segmento nos bits altos e o offset de escrita
+// nos bits baixos, assim uma única operação atômica reserva espaço e identifica
+// em qual segmento a linha deve ser copiada.
+#define TSLOG_GEN_SHIFT 40
+#define TSLOG_OFFSET_MASK ((UINT64_C(1) << TSLOG_GEN_SHIFT) - 1)
+
+typedef struct
+{
+    int fd;
+    char *base;
+    atomic_uint_fast64_t committed;
+} LogSegment;
+
+static LogSegment segmentos[2];
+static atomic_uint_fast64_t cursor_log;
+static atomic_bool log_ativo;
+static pthread_mutex_t mutex_rotacao = PTHREAD_MUTEX_INITIALIZER;
+static char nome_base[PATH_MAX];
+static uint64_t tamanho_segmento;
+static int retencao;
+
+unsigned char tslog_category_levels[TSLOG_CAT_COUNT] = {
+    TSLOG_DEFAULT_LEVEL, TSLOG_DEFAULT_LEVEL, TSLOG_DEFAULT_LEVEL,
+    TSLOG_DEFAULT_LEVEL, TSLOG_DEFAULT_LEVEL};
+
+static const char *nomes_categorias[TSLOG_CAT_COUNT] = {
+    "geral", "net", "auth", "broadcast", "manager"};
+
+static const char *nomes_niveis[] = {"DEBUG", "INFO", "WARN", "ERROR", "OFF"};
+
+// Cache por thread do timestamp formatado: strftime só roda quando o segundo muda
+static __thread time_t segundo_cache = -1;
+static __thread char tempo_cache[32];
+
+static void rotacionar_arquivos(void)
+{
+    char origem[PATH_MAX + 16];
+    char destino[PATH_MAX + 16];
+
+    if (retencao <= 0)
+    {
+        unlink(nome_base);
+        return;
+    }
+
+    snprintf(destino, sizeof(destino), "%s.%d", nome_base, retencao);
+    unlink(destino);
+
+    for (int i = retencao - 1; i >= 1; i--)
+    {
+        snprintf(origem, sizeof(origem), "%s.%d", nome_base, i);
+        snprintf(destino, sizeof(destino), "%s.%d", nome_base, i + 1);
+        rename(origem, destino);
+    }
+
+    snprintf(destino, sizeof(destino), "%s.1", nome_base);
+    rename(nome_base, destino);
+}
+
+static int abrir_segmento(LogSegment *seg, uint64_t *usado)
+{
+    int fd = open(nome_base, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    uint64_t existente = (uint64_t)st.st_size;
+    if (existente >= tamanho_segmento)
+    {
+        // Segmento anterior já está cheio (ou veio de uma versão sem rotação)
+        close(fd);
+        rotacionar_arquivos();
+        fd = open(nome_base, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+            return -1;
+        existente = 0;
+    }
+
+    if (ftruncate(fd, (off_t)tamanho_segmento) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    char *base = mmap(NULL, tamanho_segmento, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED)
+    {
+        close(fd);
+        return -1;
+    }
+
+    // Após um crash o arquivo fica com o tamanho cheio e zeros no final
+    while (existente > 0 && base[existente - 1] == '\0')
+        existente--;
+
+    seg->fd = fd;
+    seg->base = base;
+    atomic_store(&seg->committed, existente);
+    *usado = existente;
+    return 0;
+}
+
+static void finalizar_segmento(LogSegment *seg, uint64_t usado)
+{
+    if (seg->base == NULL)
+        return;
+
+    munmap(seg->base, tamanho_segmento);
+    if (ftruncate(seg->fd, (off_t)usado) != 0)
+        perror("Falha ao truncar segmento de log");
+    close(seg->fd);
+    seg->base = NULL;
+    seg->fd = -1;
+}
+
+static void aguardar_escritores(LogSegment *seg, uint64_t usado)
+{
+    while (atomic_load_explicit(&seg->committed, memory_order_acquire) < usado)
+        sched_yield();
+}
+
+// Reserva o restante do segmento atual: quem obtiver o offset de fronteira
+// é o responsável por finalizar o arquivo. Chamada com mutex_rotacao travado.
+static void encerrar_segmento_atual(void)
+{
+    uint64_t cursor = atomic_fetch_add(&cursor_log, tamanho_segmento + 1);
+    uint64_t offset = cursor & TSLOG_OFFSET_MASK;
+    LogSegment *seg = &segmentos[(cursor >> TSLOG_GEN_SHIFT) & 1];
+
+    if (offset <= tamanho_segmento)
+    {
+        aguardar_escritores(seg, offset);
+        finalizar_segmento(seg, offset);
+    }
+}
+
+// Executada apenas pela thread cuja reserva cruzou o fim do segmento
+static void rotacionar(uint64_t geracao, uint64_t usado)
+{
+    pthread_mutex_lock(&mutex_rotacao);
+
+    LogSegment *antigo = &segmentos[geracao & 1];
+
+    if (!atomic_load(&log_ativo))
+    {
+        aguardar_escritores(antigo, usado);
+        finalizar_segmento(antigo, usado);
+        pthread_mutex_unlock(&mutex_rotacao);
+        return;
+    }
+
+    LogSegment *novo = &segmentos[(geracao + 1) & 1];
+    uint64_t inicio = 0;
+
+    rotacionar_arquivos();
+    if (abrir_segmento(novo, &inicio) != 0)
+    {
+        perror("Falha ao criar novo segmento de log");
+        novo->base = NULL;
+        inicio = 0;
+    }
+
+    atomic_store_explicit(&cursor_log, ((geracao + 1) << TSLOG_GEN_SHIFT) | inicio,
+                          memory_order_release);
+
+    aguardar_escritores(antigo, usado);
+    finalizar_segmento(antigo, usado);
+
+    if (!atomic_load(&log_ativo))
+        encerrar_segmento_atual();
+
+    pthread_mutex_unlock(&mutex_rotacao);
+}
+
+static void escrever_linha(const char *linha, uint64_t tamanho)
+{
+    if (tamanho > tamanho_segmento)
+        tamanho = tamanho_segmento;
+
+    while (atomic_load_explicit(&log_ativo, memory_order_acquire))
+    {
+        uint64_t cursor = atomic_fetch_add_explicit(&cursor_log, tamanho, memory_order_acq_rel);
+        uint64_t geracao = cursor >> TSLOG_GEN_SHIFT;
+        uint64_t offset = cursor & TSLOG_OFFSET_MASK;
+        LogSegment *seg = &segmentos[geracao & 1];
+
+        if (seg->base == NULL)
+            return; // Log desabilitado após falha de rotação
+
+        if (offset + tamanho <= tamanho_segmento)
+        {
+            memcpy(seg->base + offset, linha, tamanho);
+            atomic_fetch_add_explicit(&seg->committed, tamanho, memory_order_release);
+            return;
+        }
+
+        if (offset <= tamanho_segmento)
+        {
+            rotacionar(geracao, offset);
+        }
+        else
+        {
+            while ((atomic_load_explicit(&cursor_log, memory_order_acquire) >> TSLOG_GEN_SHIFT) == geracao &&
+                   atomic_load_explicit(&log_ativo, memory_order_relaxed))
+                sched_yield();
+        }
+    }
+}
+
+void tslog_init_ex(const char *nome_arquivo, size_t segment_size, int retention)
 {
-    if (pthread_mutex_init(&mutex_log, NULL) != 0)
+    if (!nome_arquivo || strlen(nome_arquivo) >= sizeof(nome_base))
     {
-        fprintf(stderr, "Falha ao inicializar mutex do log\n");
+        fprintf(stderr, "Nome de arquivo de log inválido\n");
         exit(1);
     }
 
-    arquivo_log = fopen(nome_arquivo, "a");
-    if (arquivo_log == NULL)
+    strcpy(nome_base, nome_arquivo);
+    tamanho_segmento = segment_size > 0 ? segment_size : TSLOG_DEFAULT_SEGMENT_SIZE;
+    retencao = retention;
+
+    uint64_t inicio = 0;
+    if (abrir_segmento(&segmentos[0], &inicio) != 0)
     {
         perror("Não foi possível abrir o arquivo de log");
         exit(1);
     }
+
+    segmentos[1].fd = -1;
+    segmentos[1].base = NULL;
+    atomic_store(&cursor_log, inicio);
+    const char *niveis = getenv("TSLOG_LEVEL");
+    if (niveis && tslog_parse_levels(niveis) != 0)
+        fprintf(stderr, "TSLOG_LEVEL inválido: %s\n", niveis);
+
+    atomic_store(&log_ativo, true);
+}
+
+void tslog_init(const char *nome_arquivo)
+{
+    tslog_init_ex(nome_arquivo, TSLOG_DEFAULT_SEGMENT_SIZE, TSLOG_DEFAULT_RETENTION);
+}
+
+static void emitir(int nivel, TSLogCategory categoria, const char *formato, va_list args)
+{
+    time_t agora = time(NULL);
+    if (agora != segundo_cache)
+    {
+        struct tm info_tempo;
+        localtime_r(&agora, &info_tempo);
+        strftime(tempo_cache, sizeof(tempo_cache), "%Y-%m-%d %H:%M:%S", &info_tempo);
+        segundo_cache = agora;
+    }
+
+    char linha[TSLOG_LINE_MAX];
+    int prefixo = snprintf(linha, sizeof(linha), "[%s] %-5s %s: ",
+                           tempo_cache, nomes_niveis[nivel], nomes_categorias[categoria]);
+    int corpo = vsnprintf(linha + prefixo, sizeof(linha) - prefixo - 1, formato, args);
+    if (corpo < 0)
+        return;
+
+    size_t tamanho = (size_t)prefixo + (size_t)corpo;
+    if (tamanho > sizeof(linha) - 2)
+        tamanho = sizeof(linha) - 2;
+    linha[tamanho++] = '\n';
+
+    escrever_linha(linha, (uint64_t)tamanho);
+}
+
+void tslog_writef(int nivel, TSLogCategory categoria, const char *formato, ...)
+{
+    if (nivel < TSLOG_LEVEL_DEBUG || nivel >= TSLOG_LEVEL_OFF || categoria >= TSLOG_CAT_COUNT)
+        return;
+    if (!atomic_load_explicit(&log_ativo, memory_order_acquire))
+        return;
+
+    va_list args;
+    va_start(args, formato);
+    emitir(nivel, categoria, formato, args);
+    va_end(args);
 }
 
 void tslog_write(const char *mensagem)
 {
-    pthread_mutex_lock(&mutex_log);
+    if (!mensagem || !tslog_enabled(TSLOG_LEVEL_INFO, TSLOG_CAT_GENERAL))
+        return;
 
-    time_t agora;
-    time(&agora);
+    tslog_writef(TSLOG_LEVEL_INFO, TSLOG_CAT_GENERAL, "%s", mensagem);
+}
 
-    struct tm *info_tempo = localtime(&agora);
-    char buffer_tempo[32];
-    strftime(buffer_tempo, sizeof(buffer_tempo), "%Y-%m-%d %H:%M:%S", info_tempo);
+void tslog_set_level(TSLogCategory categoria, int nivel)
+{
+    if (categoria >= TSLOG_CAT_COUNT || nivel < TSLOG_LEVEL_DEBUG || nivel > TSLOG_LEVEL_OFF)
+        return;
 
-    fprintf(arquivo_log, "[%s] %s\n", buffer_tempo, mensagem);
-    fflush(arquivo_log);
+    __atomic_store_n(&tslog_category_levels[categoria], (unsigned char)nivel, __ATOMIC_RELAXED);
+}
 
-    pthread_mutex_unlock(&mutex_log);
+static int nivel_por_nome(const char *nome, size_t tamanho)
+{
+    for (int i = TSLOG_LEVEL_DEBUG; i <= TSLOG_LEVEL_OFF; i++)
+    {
+        if (strlen(nomes_niveis[i]) == tamanho && strncasecmp(nomes_niveis[i], nome, tamanho) == 0)
+            return i;
+    }
+    return -1;
 }
 
-void tslog_close()
+// Formato: "info" ou "warn,broadcast=debug,net=error"
+int tslog_parse_levels(const char *spec)
 {
-    if (arquivo_log != NULL)
+    if (!spec)
+        return -1;
+
+    int resultado = 0;
+    const char *p = spec;
+    while (*p)
     {
-        fclose(arquivo_log);
-        arquivo_log = NULL;
+        const char *fim = strchr(p, ',');
+        size_t tamanho = fim ? (size_t)(fim - p) : strlen(p);
+        const char *igual = memchr(p, '=', tamanho);
+
+        if (igual == NULL)
+        {
+            int nivel = nivel_por_nome(p, tamanho);
+            if (nivel < 0)
+                resultado = -1;
+            else
+                for (int c = 0; c < TSLOG_CAT_COUNT; c++)
+                    tslog_set_level((TSLogCategory)c, nivel);
+        }
+        else
+        {
+            size_t tamanho_cat = (size_t)(igual - p);
+            int nivel = nivel_por_nome(igual + 1, tamanho - tamanho_cat - 1);
+            int categoria = -1;
+            for (int c = 0; c < TSLOG_CAT_COUNT; c++)
+            {
+                if (strlen(nomes_categorias[c]) == tamanho_cat &&
+                    strncasecmp(nomes_categorias[c], p, tamanho_cat) == 0)
+                    categoria = c;
+            }
+
+            if (nivel < 0 || categoria < 0)
+                resultado = -1;
+            else
+                tslog_set_level((TSLogCategory)categoria, nivel);
+        }
+
+        p += tamanho;
+        if (*p == ',')
+            p++;
     }
-    pthread_mutex_destroy(&mutex_log);
+
+    return resultado;
+}
+
+void tslog_close()
+{
+    if (!atomic_exchange(&log_ativo, false))
+        return;
+
+    pthread_mutex_lock(&mutex_rotacao);
+    encerrar_segmento_atual();
+    pthread_mutex_unlock(&mutex_rotacao);
 }
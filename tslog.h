@@ -2,9 +2,92 @@
 #define TSLOG_H
 
 #include <pthread.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Tamanho de cada segmento mapeado em memória e quantos segmentos
+// rotacionados (arquivo.1 ... arquivo.N) são mantidos em disco.
+#ifndef TSLOG_DEFAULT_SEGMENT_SIZE
+#define TSLOG_DEFAULT_SEGMENT_SIZE (4 * 1024 * 1024)
+#endif
+
+#ifndef TSLOG_DEFAULT_RETENTION
+#define TSLOG_DEFAULT_RETENTION 5
+#endif
+
+// Níveis são macros (e não enum) para poderem ser usados em #if
+#define TSLOG_LEVEL_DEBUG 0
+#define TSLOG_LEVEL_INFO 1
+#define TSLOG_LEVEL_WARN 2
+#define TSLOG_LEVEL_ERROR 3
+#define TSLOG_LEVEL_OFF 4
+
+// Chamadas abaixo deste nível são removidas na compilação (-DTSLOG_COMPILE_LEVEL=...)
+#ifndef TSLOG_COMPILE_LEVEL
+#define TSLOG_COMPILE_LEVEL TSLOG_LEVEL_DEBUG
+#endif
+
+// Nível inicial em tempo de execução; sobrescrito pela variável TSLOG_LEVEL
+#ifndef TSLOG_DEFAULT_LEVEL
+#define TSLOG_DEFAULT_LEVEL TSLOG_LEVEL_INFO
+#endif
+
+typedef enum
+{
+    TSLOG_CAT_GENERAL,
+    TSLOG_CAT_NET,
+    TSLOG_CAT_AUTH,
+    TSLOG_CAT_BROADCAST,
+    TSLOG_CAT_MANAGER,
+    TSLOG_CAT_COUNT
+} TSLogCategory;
+
+extern unsigned char tslog_category_levels[TSLOG_CAT_COUNT];
+
+static inline bool tslog_enabled(int level, TSLogCategory category)
+{
+    return level >= __atomic_load_n(&tslog_category_levels[category], __ATOMIC_RELAXED);
+}
 
 void tslog_init(const char *filename);
+void tslog_init_ex(const char *filename, size_t segment_size, int retention);
 void tslog_write(const char *message);
+void tslog_writef(int level, TSLogCategory category, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+void tslog_set_level(TSLogCategory category, int level);
+int tslog_parse_levels(const char *spec);
 void tslog_close();
 
+// O teste de nível acontece antes de qualquer formatação dos argumentos
+#define TSLOG(level, category, ...)                                        \
+    do                                                                     \
+    {                                                                      \
+        if ((level) >= TSLOG_COMPILE_LEVEL && tslog_enabled((level), (category))) \
+            tslog_writef((level), (category), __VA_ARGS__);                \
+    } while (0)
+
+#if TSLOG_COMPILE_LEVEL <= TSLOG_LEVEL_DEBUG
+#define TSLOG_DEBUG(category, ...) TSLOG(TSLOG_LEVEL_DEBUG, category, __VA_ARGS__)
+#else
+#define TSLOG_DEBUG(category, ...) ((void)0)
+#endif
+
+#if TSLOG_COMPILE_LEVEL <= TSLOG_LEVEL_INFO
+#define TSLOG_INFO(category, ...) TSLOG(TSLOG_LEVEL_INFO, category, __VA_ARGS__)
+#else
+#define TSLOG_INFO(category, ...) ((void)0)
+#endif
+
+#if TSLOG_COMPILE_LEVEL <= TSLOG_LEVEL_WARN
+#define TSLOG_WARN(category, ...) TSLOG(TSLOG_LEVEL_WARN, category, __VA_ARGS__)
+#else
+#define TSLOG_WARN(category, ...) ((void)0)
+#endif
+
+#if TSLOG_COMPILE_LEVEL <= TSLOG_LEVEL_ERROR
+#define TSLOG_ERROR(category, ...) TSLOG(TSLOG_LEVEL_ERROR, category, __VA_ARGS__)
+#else
+#define TSLOG_ERROR(category, ...) ((void)0)
+#endif
+
 #endif
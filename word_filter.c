@@ -0,0 +1,394 @@
+#include "word_filter.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WORD_FILTER_X86 1
+#endif
+
+// Acima disso o pré-filtro rejeitaria pouco e o autômato sozinho é mais barato
+#define WF_MAX_PREFILTER_BIGRAMS 16
+
+typedef size_t (*FindCandidateFn)(const struct WordFilter *filter,
+                                  const unsigned char *text, size_t start, size_t length);
+
+struct WordFilter
+{
+    uint8_t byte_class[256];
+    int class_count;
+    int state_count;
+    int word_count;
+    uint32_t *delta;   // delta[estado * class_count + classe]
+    uint8_t *accept;   // estado reconhece (sufixo de) alguma palavra
+
+    // Pré-filtro: primeiros dois bytes (minúsculos) de cada palavra.
+    // bigram_count < 0 desabilita (palavra de 1 byte ou bigramas demais).
+    int bigram_count;
+    unsigned char bigram_first[WF_MAX_PREFILTER_BIGRAMS];
+    unsigned char bigram_second[WF_MAX_PREFILTER_BIGRAMS];
+};
+
+static FindCandidateFn find_candidate;
+static const char *simd_level = "scalar";
+static pthread_once_t simd_once = PTHREAD_ONCE_INIT;
+
+static unsigned char to_lower_ascii(unsigned char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + 32) : c;
+}
+
+// Retorna a primeira posição >= start onde começa um bigrama de alguma palavra,
+// ou length se não houver nenhuma: nenhuma palavra pode começar antes dela.
+static size_t find_candidate_scalar(const struct WordFilter *filter,
+                                    const unsigned char *text, size_t start, size_t length)
+{
+    for (size_t i = start; i + 1 < length; i++)
+    {
+        unsigned char a = to_lower_ascii(text[i]);
+        unsigned char b = to_lower_ascii(text[i + 1]);
+        for (int k = 0; k < filter->bigram_count; k++)
+        {
+            if (filter->bigram_first[k] == a && filter->bigram_second[k] == b)
+                return i;
+        }
+    }
+    return length;
+}
+
+#ifdef WORD_FILTER_X86
+__attribute__((target("sse2"))) static inline __m128i fold_sse2(__m128i v)
+{
+    __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8((char)(128 - 'A')));
+    __m128i upper = _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(-128 + 26)));
+    return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+__attribute__((target("sse2"))) static size_t find_candidate_sse2(const struct WordFilter *filter,
+                                                                  const unsigned char *text,
+                                                                  size_t start, size_t length)
+{
+    size_t i = start;
+    for (; i + 17 <= length; i += 16)
+    {
+        __m128i v0 = fold_sse2(_mm_loadu_si128((const __m128i *)(text + i)));
+        __m128i v1 = fold_sse2(_mm_loadu_si128((const __m128i *)(text + i + 1)));
+        __m128i hits = _mm_setzero_si128();
+
+        for (int k = 0; k < filter->bigram_count; k++)
+        {
+            __m128i a = _mm_cmpeq_epi8(v0, _mm_set1_epi8((char)filter->bigram_first[k]));
+            __m128i b = _mm_cmpeq_epi8(v1, _mm_set1_epi8((char)filter->bigram_second[k]));
+            hits = _mm_or_si128(hits, _mm_and_si128(a, b));
+        }
+
+        int mask = _mm_movemask_epi8(hits);
+        if (mask)
+            return i + (size_t)__builtin_ctz((unsigned int)mask);
+    }
+    return find_candidate_scalar(filter, text, i, length);
+}
+
+__attribute__((target("avx2"))) static inline __m256i fold_avx2(__m256i v)
+{
+    __m256i shifted = _mm256_add_epi8(v, _mm256_set1_epi8((char)(128 - 'A')));
+    __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(-128 + 26)), shifted);
+    return _mm256_or_si256(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+__attribute__((target("avx2"))) static size_t find_candidate_avx2(const struct WordFilter *filter,
+                                                                  const unsigned char *text,
+                                                                  size_t start, size_t length)
+{
+    size_t i = start;
+    for (; i + 33 <= length; i += 32)
+    {
+        __m256i v0 = fold_avx2(_mm256_loadu_si256((const __m256i *)(text + i)));
+        __m256i v1 = fold_avx2(_mm256_loadu_si256((const __m256i *)(text + i + 1)));
+        __m256i hits = _mm256_setzero_si256();
+
+        for (int k = 0; k < filter->bigram_count; k++)
+        {
+            __m256i a = _mm256_cmpeq_epi8(v0, _mm256_set1_epi8((char)filter->bigram_first[k]));
+            __m256i b = _mm256_cmpeq_epi8(v1, _mm256_set1_epi8((char)filter->bigram_second[k]));
+            hits = _mm256_or_si256(hits, _mm256_and_si256(a, b));
+        }
+
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(hits);
+        if (mask)
+            return i + (size_t)__builtin_ctz(mask);
+    }
+    return find_candidate_sse2(filter, text, i, length);
+}
+#endif
+
+// WORD_FILTER_SIMD=scalar|sse2|avx2 força uma implementação (benchmarks/depuração)
+static void select_simd(void)
+{
+    const char *forced = getenv("WORD_FILTER_SIMD");
+
+    // Sem SIMD o pré-filtro custaria mais que o próprio autômato
+    find_candidate = NULL;
+    simd_level = "scalar";
+
+#ifdef WORD_FILTER_X86
+    __builtin_cpu_init();
+    if (forced && strcmp(forced, "scalar") == 0)
+        return;
+
+    if (__builtin_cpu_supports("sse2"))
+    {
+        find_candidate = find_candidate_sse2;
+        simd_level = "sse2";
+    }
+    if (__builtin_cpu_supports("avx2") && !(forced && strcmp(forced, "sse2") == 0))
+    {
+        find_candidate = find_candidate_avx2;
+        simd_level = "avx2";
+    }
+#else
+    (void)forced;
+#endif
+}
+
+const char *word_filter_simd_level(void)
+{
+    pthread_once(&simd_once, select_simd);
+    return simd_level;
+}
+
+static int grow_states(WordFilter *filter, int *capacity)
+{
+    int new_capacity = *capacity * 2;
+    size_t row = (size_t)filter->class_count;
+
+    uint32_t *delta = realloc(filter->delta, (size_t)new_capacity * row * sizeof(uint32_t));
+    if (!delta)
+        return -1;
+    filter->delta = delta;
+    memset(delta + (size_t)*capacity * row, 0, (size_t)(new_capacity - *capacity) * row * sizeof(uint32_t));
+
+    uint8_t *accept = realloc(filter->accept, (size_t)new_capacity);
+    if (!accept)
+        return -1;
+    filter->accept = accept;
+    memset(accept + *capacity, 0, (size_t)(new_capacity - *capacity));
+
+    *capacity = new_capacity;
+    return 0;
+}
+
+static int build_trie(WordFilter *filter, const char *const *words, int count)
+{
+    int capacity = 64;
+    size_t row = (size_t)filter->class_count;
+
+    filter->delta = calloc((size_t)capacity * row, sizeof(uint32_t));
+    filter->accept = calloc((size_t)capacity, 1);
+    if (!filter->delta || !filter->accept)
+        return -1;
+
+    filter->state_count = 1;
+
+    // Durante a construção, transição 0 significa "sem filho" (a raiz nunca é filha)
+    for (int w = 0; w < count; w++)
+    {
+        const unsigned char *p = (const unsigned char *)words[w];
+        if (!p || *p == '\0')
+            continue;
+
+        uint32_t state = 0;
+        for (; *p; p++)
+        {
+            uint32_t *slot = &filter->delta[state * row + filter->byte_class[*p]];
+            if (*slot == 0)
+            {
+                if (filter->state_count == capacity && grow_states(filter, &capacity) != 0)
+                    return -1;
+                slot = &filter->delta[state * row + filter->byte_class[*p]];
+                *slot = (uint32_t)filter->state_count++;
+            }
+            state = *slot;
+        }
+        filter->accept[state] = 1;
+        filter->word_count++;
+    }
+
+    return 0;
+}
+
+static int build_failure_links(WordFilter *filter)
+{
+    size_t row = (size_t)filter->class_count;
+    uint32_t *fail = calloc((size_t)filter->state_count, sizeof(uint32_t));
+    uint32_t *queue = malloc((size_t)filter->state_count * sizeof(uint32_t));
+    if (!fail || !queue)
+    {
+        free(fail);
+        free(queue);
+        return -1;
+    }
+
+    int head = 0, tail = 0;
+    for (size_t c = 0; c < row; c++)
+    {
+        uint32_t child = filter->delta[c];
+        if (child != 0)
+            queue[tail++] = child;
+    }
+
+    // BFS: completa as transições ausentes com as do estado de falha
+    while (head < tail)
+    {
+        uint32_t state = queue[head++];
+        filter->accept[state] |= filter->accept[fail[state]];
+
+        for (size_t c = 0; c < row; c++)
+        {
+            uint32_t *slot = &filter->delta[state * row + c];
+            uint32_t via_fail = filter->delta[fail[state] * row + c];
+            if (*slot != 0)
+            {
+                fail[*slot] = via_fail;
+                queue[tail++] = *slot;
+            }
+            else
+            {
+                *slot = via_fail;
+            }
+        }
+    }
+
+    free(fail);
+    free(queue);
+    return 0;
+}
+
+static void build_prefilter(WordFilter *filter, const char *const *words, int count)
+{
+    filter->bigram_count = 0;
+
+    for (int w = 0; w < count; w++)
+    {
+        const unsigned char *p = (const unsigned char *)words[w];
+        if (!p || p[0] == '\0')
+            continue;
+        if (p[1] == '\0')
+        {
+            filter->bigram_count = -1;
+            return;
+        }
+
+        unsigned char a = to_lower_ascii(p[0]);
+        unsigned char b = to_lower_ascii(p[1]);
+        int known = 0;
+        for (int k = 0; k < filter->bigram_count && !known; k++)
+            known = filter->bigram_first[k] == a && filter->bigram_second[k] == b;
+        if (known)
+            continue;
+
+        if (filter->bigram_count == WF_MAX_PREFILTER_BIGRAMS)
+        {
+            filter->bigram_count = -1;
+            return;
+        }
+        filter->bigram_first[filter->bigram_count] = a;
+        filter->bigram_second[filter->bigram_count] = b;
+        filter->bigram_count++;
+    }
+}
+
+WordFilter *word_filter_create(const char *const *words, int count)
+{
+    if (!words || count < 0)
+        return NULL;
+
+    pthread_once(&simd_once, select_simd);
+
+    WordFilter *filter = calloc(1, sizeof(WordFilter));
+    if (!filter)
+        return NULL;
+
+    // Classe 0 agrupa todos os bytes que não aparecem em nenhuma palavra
+    int classes = 1;
+    for (int w = 0; w < count; w++)
+    {
+        for (const unsigned char *p = (const unsigned char *)words[w]; p && *p; p++)
+        {
+            unsigned char lower = to_lower_ascii(*p);
+            if (filter->byte_class[lower] == 0)
+            {
+                if (classes == 256)
+                    break;
+                filter->byte_class[lower] = (uint8_t)classes++;
+            }
+        }
+    }
+    for (int c = 'A'; c <= 'Z'; c++)
+        filter->byte_class[c] = filter->byte_class[c + 32];
+
+    filter->class_count = classes;
+    build_prefilter(filter, words, count);
+
+    if (build_trie(filter, words, count) != 0 || build_failure_links(filter) != 0)
+    {
+        word_filter_destroy(filter);
+        return NULL;
+    }
+
+    return filter;
+}
+
+int word_filter_contains(const WordFilter *filter, const char *text, size_t length)
+{
+    if (!filter || !text || filter->word_count == 0)
+        return 0;
+
+    const unsigned char *p = (const unsigned char *)text;
+    const uint32_t *delta = filter->delta;
+    const uint8_t *byte_class = filter->byte_class;
+    size_t row = (size_t)filter->class_count;
+    uint32_t state = 0;
+
+    if (filter->bigram_count < 0 || find_candidate == NULL)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            state = delta[state * row + byte_class[p[i]]];
+            if (filter->accept[state])
+                return 1;
+        }
+        return 0;
+    }
+
+    // O autômato só roda a partir de posições candidatas e volta ao
+    // pré-filtro assim que retorna à raiz (nenhum casamento parcial em curso)
+    size_t i = 0;
+    while ((i = find_candidate(filter, p, i, length)) < length)
+    {
+        do
+        {
+            state = delta[state * row + byte_class[p[i++]]];
+            if (filter->accept[state])
+                return 1;
+        } while (state != 0 && i < length);
+    }
+    return 0;
+}
+
+int word_filter_word_count(const WordFilter *filter)
+{
+    return filter ? filter->word_count : 0;
+}
+
+void word_filter_destroy(WordFilter *filter)
+{
+    if (!filter)
+        return;
+
+    free(filter->delta);
+    free(filter->accept);
+    free(filter);
+}
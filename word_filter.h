@@ -0,0 +1,22 @@
+#ifndef WORD_FILTER_H
+#define WORD_FILTER_H
+
+#include <stddef.h>
+
+// Autômato Aho-Corasick (DFA completo) sobre classes de bytes, insensível a
+// maiúsculas/minúsculas ASCII. Imutável depois de criado: pode ser consultado
+// por várias threads ao mesmo tempo sem sincronização.
+typedef struct WordFilter WordFilter;
+
+WordFilter *word_filter_create(const char *const *words, int count);
+
+int word_filter_contains(const WordFilter *filter, const char *text, size_t length);
+
+int word_filter_word_count(const WordFilter *filter);
+
+// Implementação do pré-filtro escolhida em tempo de execução ("avx2", "sse2", "scalar")
+const char *word_filter_simd_level(void);
+
+void word_filter_destroy(WordFilter *filter);
+
+#endif